@@ -0,0 +1,228 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/*! Subsystem owning an allocation */
+enum class AllocationTag : uint8_t
+{
+    engine,         /*! Engine core. */
+    input,          /*! Input manager. */
+    vulkan,         /*! Vulkan manager. */
+    logging,        /*! Logging. */
+    application,    /*! Application code. */
+    count
+};
+
+
+/**
+ * \brief Allocation counters.
+ */
+struct AllocationStats
+{
+    /*! Number of allocations */
+    uint64_t allocations {0};
+
+    /*! Number of frees */
+    uint64_t frees {0};
+
+    /*! Allocated bytes */
+    uint64_t allocated_bytes {0};
+
+    /*! Freed bytes */
+    uint64_t freed_bytes {0};
+};
+
+
+/**
+ * \class AllocationTracker
+ * \brief Heap allocation tracker.
+ *
+ * When the engine is built with UGLY_ENABLE_ALLOCATION_TRACKING, the global operator new
+ * and delete are replaced to count every allocation, tagged with the subsystem of the
+ * calling thread (see UGLY_ALLOCATION_SCOPE). Without it, all counters stay at zero.
+ * After a warm up, any allocation in a frame is flagged: the steady state loop should not
+ * allocate.
+ */
+class AllocationTracker
+{
+public:
+
+    /**
+     * \brief Get the instance of the tracker.
+     */
+    static AllocationTracker *const getInstance()
+    {
+        static AllocationTracker tracker;
+        return &tracker;
+    }
+
+    /**
+     * \brief Check if the tracking is compiled in.
+     *
+     * \return True if allocations are tracked
+     */
+    static constexpr bool isEnabled()
+    {
+#ifdef UGLY_ALLOCATION_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * \brief Get the tag of the calling thread.
+     *
+     * \return Current tag
+     */
+    static AllocationTag getCurrentTag();
+
+    /**
+     * \brief Set the tag of the calling thread.
+     *
+     * \param _tag  New tag
+     * \return Previous tag
+     */
+    static AllocationTag setCurrentTag(AllocationTag _tag);
+
+    /**
+     * \brief Get a tag name.
+     *
+     * \param _tag  Tag
+     * \return Tag name
+     */
+    static const char* getTagName(AllocationTag _tag);
+
+    /**
+     * \brief Set the number of frames before the steady state.
+     *
+     * \param _frames   Warm up frame count
+     */
+    void setWarmUpFrames(uint64_t _frames);
+
+    /**
+     * \brief End the current frame and snapshot its counters.
+     */
+    void endFrame();
+
+    /**
+     * \brief Get the counters since the program start.
+     *
+     * \param _tag  Tag
+     * \return Counters
+     */
+    AllocationStats getTotalStats(AllocationTag _tag) const;
+
+    /**
+     * \brief Get the counters of the last ended frame.
+     *
+     * \param _tag  Tag
+     * \return Counters
+     */
+    AllocationStats getFrameStats(AllocationTag _tag) const;
+
+    /**
+     * \brief Get the live bytes of a tag.
+     *
+     * \param _tag  Tag
+     * \return Allocated bytes not freed yet
+     */
+    int64_t getLiveBytes(AllocationTag _tag) const;
+
+    /**
+     * \brief Get the highest live bytes of all tags together.
+     *
+     * \return High-water mark in bytes
+     */
+    int64_t getPeakLiveBytes() const;
+
+    /**
+     * \brief Get the number of ended frames.
+     *
+     * \return Frame count
+     */
+    uint64_t getFrameCount() const;
+
+    /**
+     * \brief Get the number of steady state frames which allocated.
+     *
+     * \return Flagged frame count
+     */
+    uint64_t getFlaggedFrameCount() const;
+
+private:
+
+    /**
+     * \brief Constructor.
+     */
+    AllocationTracker();
+
+private:
+
+    /*! Counters at the start of the current frame */
+    AllocationStats m_frame_start[static_cast<size_t>(AllocationTag::count)];
+
+    /*! Counters of the last ended frame */
+    AllocationStats m_last_frame[static_cast<size_t>(AllocationTag::count)];
+
+    /*! Number of warm up frames */
+    uint64_t m_warm_up_frames {60};
+
+    /*! Number of ended frames */
+    uint64_t m_frame_count {0};
+
+    /*! Number of flagged frames */
+    uint64_t m_flagged_frame_count {0};
+};
+
+
+/**
+ * \class AllocationScope
+ * \brief Scoped allocation tag of the calling thread.
+ */
+class AllocationScope
+{
+public:
+
+    /**
+     * \brief Constructor, set the tag.
+     *
+     * \param _tag  Tag
+     */
+    explicit AllocationScope(AllocationTag _tag) :
+        m_previous(AllocationTracker::setCurrentTag(_tag))
+    {
+    }
+
+    /**
+     * \brief Destructor, restore the previous tag.
+     */
+    ~AllocationScope()
+    {
+        AllocationTracker::setCurrentTag(m_previous);
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+
+    /*! Previous tag */
+    AllocationTag m_previous;
+};
+
+}//namespace ugly
+
+
+// Allocation tracking macros
+#define UGLY_ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define UGLY_ALLOCATION_CONCAT(a, b) UGLY_ALLOCATION_CONCAT_IMPL(a, b)
+
+#ifdef UGLY_ALLOCATION_TRACKING
+#define UGLY_ALLOCATION_SCOPE(tag) ugly::AllocationScope UGLY_ALLOCATION_CONCAT(ugly_allocation_scope_, __LINE__)(tag)
+#else
+#define UGLY_ALLOCATION_SCOPE(tag)
+#endif
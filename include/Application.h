@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core.h"
+#include "InputStats.h"
 
 namespace ugly
 {
@@ -38,6 +39,14 @@ namespace ugly
              */
             virtual void update();
 
+            /**
+             * \brief Render application.
+             * Called once per frame, after the simulation ticks of the frame.
+             * 
+             * \param _alpha  Interpolation factor in [0, 1) between previous and current simulation state
+             */
+            virtual void render(float _alpha);
+
             /**
              * \brief Get application name.
              * 
@@ -49,6 +58,9 @@ namespace ugly
 
             /*! Application name */
             std::string m_name {"UglyBaseApplication"};
+
+            /*! Quit button */
+            InputButtonHandle m_quit_button;
     };
 
 }//namespace ugly
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \brief Behavior of a logging thread when the log ring is full.
+ */
+enum class LogOverflowPolicy : uint8_t
+{
+    block,      /*! Wait for a free slot, no record is lost. */
+    drop,       /*! Discard the record. */
+    count       /*! Discard the record and log the number of discarded records once the ring drains. */
+};
+
+
+/**
+ * \class AsyncLogAppender
+ * \brief plog appender writing the records from a background thread.
+ *
+ * Logging threads copy the records into a bounded multi producer single consumer ring of
+ * fixed size slots. The writer thread formats them with plog::LogFormatter and writes them
+ * in batches to the log file and the console, so a LOG_* call never waits for the disk.
+ * Messages longer than a slot are truncated.
+ */
+class AsyncLogAppender : public plog::IAppender
+{
+public:
+
+    /*! Number of slots, must be a power of two */
+    static constexpr uint32_t CAPACITY = 2048;
+
+    /*! Maximum function name length, including the terminator */
+    static constexpr size_t FUNC_SIZE = 64;
+
+    /*! Maximum message length, including the terminator */
+    static constexpr size_t MESSAGE_SIZE = 432;
+
+    /**
+     * \brief Constructor.
+     */
+    AsyncLogAppender();
+
+    /**
+     * \brief Destructor.
+     * Stop the writer thread.
+     */
+    virtual ~AsyncLogAppender();
+
+    /**
+     * \brief Open the log file and start the writer thread.
+     *
+     * \param _filename     Log file, truncated
+     * \param _console      Also write the records to the standard output
+     * \return false if the log file cannot be opened, the writer thread still runs for the console
+     */
+    bool start(const std::string& _filename, bool _console);
+
+    /**
+     * \brief Write the pending records and stop the writer thread.
+     * Records written afterwards are dropped.
+     */
+    void stop();
+
+    /**
+     * \brief Queue a record, called by plog.
+     * A fatal record is flushed before returning.
+     *
+     * \param _record   Record
+     */
+    virtual void write(const plog::Record& _record) override;
+
+    /**
+     * \brief Wait until the records queued before the call are written.
+     */
+    void flush();
+
+    /**
+     * \brief Set the behavior when the ring is full.
+     *
+     * \param _policy   Overflow policy
+     */
+    void setOverflowPolicy(LogOverflowPolicy _policy);
+
+    /**
+     * \brief Get the behavior when the ring is full.
+     *
+     * \return Overflow policy
+     */
+    LogOverflowPolicy getOverflowPolicy() const;
+
+    /**
+     * \brief Get the number of records discarded because the ring was full.
+     *
+     * \return Dropped record count
+     */
+    uint64_t getDroppedCount() const;
+
+private:
+
+    /**
+     * \brief Record copy.
+     */
+    struct Slot
+    {
+        /*! Ring position the slot is ready for, position + 1 once written */
+        std::atomic<uint64_t> sequence {0};
+
+        /*! Severity */
+        plog::Severity severity {plog::none};
+
+        /*! Function name */
+        char func[FUNC_SIZE];
+
+        /*! Message */
+        plog::util::nchar message[MESSAGE_SIZE];
+    };
+
+    /**
+     * \brief Claim a slot to write a record.
+     * The returned slot sequence is the claimed position.
+     *
+     * \return Slot, nullptr if the ring is full
+     */
+    Slot* tryClaim();
+
+    /**
+     * \brief Writer thread function.
+     */
+    void writerThread();
+
+    /**
+     * \brief Format the written slots into the batch.
+     *
+     * \return Number of formatted records
+     */
+    uint32_t drain();
+
+    /**
+     * \brief Write the batch to the outputs.
+     */
+    void writeBatch();
+
+private:
+
+    /*! Slots */
+    std::unique_ptr<Slot[]> m_slots;
+
+    /*! Next position to claim, shared by the producers */
+    alignas(64) std::atomic<uint64_t> m_enqueue_pos {0};
+
+    /*! Dropped record count */
+    std::atomic<uint64_t> m_dropped {0};
+
+    /*! Overflow policy */
+    std::atomic<LogOverflowPolicy> m_policy {LogOverflowPolicy::count};
+
+    /*! Position of the next record to format, owned by the writer thread */
+    alignas(64) uint64_t m_dequeue_pos {0};
+
+    /*! Position up to which the records are written to the outputs */
+    std::atomic<uint64_t> m_written_pos {0};
+
+    /*! Dropped record count already reported */
+    uint64_t m_reported_dropped {0};
+
+    /*! Formatted records waiting to be written */
+    plog::util::nstring m_batch;
+
+    /*! Log file */
+    FILE* m_file {nullptr};
+
+    /*! Console flag */
+    bool m_console {false};
+
+    /*! Running flag, cleared to stop the writer thread */
+    std::atomic<bool> m_running {false};
+
+    /*! Stopped flag, set when the records are no longer written */
+    std::atomic<bool> m_stopped {false};
+
+    /*! Writer thread */
+    std::thread m_thread;
+};
+
+}//namespace ugly
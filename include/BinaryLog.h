@@ -0,0 +1,397 @@
+#pragma once
+
+#include "Core.h"
+#include "BinaryLogFormat.h"
+
+#include <type_traits>
+
+namespace ugly
+{
+
+/**
+ * \class BinaryLog
+ * \brief Structured log written as binary records to a memory mapped file.
+ *
+ * A call site registers its severity, location and format string once and gets a site id.
+ * Each entry then only copies the site id, a timestamp and the raw argument bytes into the
+ * mapping, the text is built offline by the UglyLogDecoder tool. Writers reserve their
+ * record with an atomic add, so logging threads never wait for each other.
+ * When the file is full, entries are dropped and counted.
+ *
+ * Use the UGLY_BLOG_* macros. When the binary log is not open, they format the message and
+ * forward it to plog.
+ */
+class BinaryLog
+{
+public:
+
+    /*! Maximum size of an entry, longer arguments are truncated */
+    static constexpr size_t MAX_RECORD_SIZE = 1024;
+
+    /*! Default file size */
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+    /**
+     * \brief Get the instance of the binary log.
+     */
+    static BinaryLog *const getInstance()
+    {
+        static BinaryLog binary_log;
+        return &binary_log;
+    }
+
+    /**
+     * \brief Create the log file and map it.
+     *
+     * \param _filename     Log file, truncated
+     * \param _capacity     File size
+     * \return false if error
+     */
+    bool open(const std::string& _filename, size_t _capacity = DEFAULT_CAPACITY);
+
+    /**
+     * \brief Unmap the log file and shrink it to the written records.
+     * It must not run concurrently with writes.
+     */
+    void close();
+
+    /**
+     * \brief Check if the log file is open.
+     *
+     * \return True if open
+     */
+    bool isOpen() const
+    {
+        return m_open.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief Set the maximum severity written to the file.
+     *
+     * \param _severity     Maximum severity
+     */
+    void setMaxSeverity(plog::Severity _severity);
+
+    /**
+     * \brief Check if a severity is written to the file.
+     *
+     * \param _severity     Severity
+     * \return True if written
+     */
+    bool checkSeverity(plog::Severity _severity) const
+    {
+        return _severity <= m_max_severity.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Register a call site.
+     * The site definition is written to the file now, or when it is opened.
+     *
+     * \param _severity     Severity
+     * \param _func         Function name, static string
+     * \param _file         Source file, static string
+     * \param _line         Source line
+     * \param _format       Format string, static string, each {} is replaced by an argument
+     * \return Site id
+     */
+    uint32_t registerSite(plog::Severity _severity, const char* _func, const char* _file, uint32_t _line, const char* _format);
+
+    /**
+     * \brief Write an entry.
+     *
+     * \param _site     Site id
+     * \param _args     Arguments
+     */
+    template<typename... Args>
+    void write(uint32_t _site, const Args&... _args);
+
+    /**
+     * \brief Expand a format string with arguments, as the decoder does.
+     *
+     * \param _format   Format string
+     * \param _args     Arguments
+     * \return Message
+     */
+    template<typename... Args>
+    static std::string format(const char* _format, const Args&... _args);
+
+    /**
+     * \brief Get the number of entries dropped because the file was full.
+     *
+     * \return Dropped entry count
+     */
+    uint64_t getDroppedCount() const;
+
+    /**
+     * \brief Get the number of bytes written to the file.
+     *
+     * \return Written size
+     */
+    size_t getSize() const;
+
+private:
+
+    /**
+     * \brief Registered call site.
+     */
+    struct Site
+    {
+        /*! Severity */
+        plog::Severity severity;
+
+        /*! Function name */
+        const char* func;
+
+        /*! Source file */
+        const char* file;
+
+        /*! Source line */
+        uint32_t line;
+
+        /*! Format string */
+        const char* format;
+    };
+
+    /**
+     * \brief Argument encoder writing into a fixed buffer.
+     */
+    class Encoder
+    {
+    public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param _data     Buffer
+         * \param _capacity Buffer size
+         * \param _offset   Offset of the first argument
+         */
+        Encoder(uint8_t* _data, size_t _capacity, size_t _offset) :
+            m_data(_data), m_capacity(_capacity), m_size(_offset)
+        {
+        }
+
+        /**
+         * \brief Encode an argument.
+         *
+         * \param _value    Argument
+         */
+        template<typename T>
+        void add(const T& _value)
+        {
+            if constexpr(std::is_same_v<T, bool>)
+                addValue(BinaryLogArgType::boolean, static_cast<uint8_t>(_value ? 1 : 0));
+            else if constexpr(std::is_enum_v<T>)
+                add(static_cast<std::underlying_type_t<T>>(_value));
+            else if constexpr(std::is_integral_v<T> && std::is_signed_v<T>)
+                addValue(BinaryLogArgType::int64, static_cast<int64_t>(_value));
+            else if constexpr(std::is_integral_v<T>)
+                addValue(BinaryLogArgType::uint64, static_cast<uint64_t>(_value));
+            else if constexpr(std::is_floating_point_v<T>)
+                addValue(BinaryLogArgType::float64, static_cast<double>(_value));
+            else if constexpr(std::is_convertible_v<const T&, std::string_view>)
+                addString(std::string_view(_value));
+            else if constexpr(std::is_pointer_v<T>)
+                addValue(BinaryLogArgType::uint64, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(_value)));
+            else
+                static_assert(std::is_void_v<T>, "Unsupported binary log argument type");
+        }
+
+        /**
+         * \brief Get the encoded size.
+         *
+         * \return Size, offset included
+         */
+        size_t getSize() const
+        {
+            return m_size;
+        }
+
+    private:
+
+        /**
+         * \brief Encode a fixed size argument, skipped if it does not fit.
+         */
+        template<typename T>
+        void addValue(BinaryLogArgType _type, T _value)
+        {
+            if(m_size + 1 + sizeof(T) > m_capacity)
+                return;
+            m_data[m_size] = static_cast<uint8_t>(_type);
+            memcpy(m_data + m_size + 1, &_value, sizeof(T));
+            m_size += 1 + sizeof(T);
+        }
+
+        /**
+         * \brief Encode a string argument, truncated if it does not fit.
+         */
+        void addString(std::string_view _value)
+        {
+            if(m_size + 1 + sizeof(uint16_t) > m_capacity)
+                return;
+            uint16_t length = static_cast<uint16_t>(std::min<size_t>(_value.size(), m_capacity - m_size - 1 - sizeof(uint16_t)));
+            m_data[m_size] = static_cast<uint8_t>(BinaryLogArgType::string);
+            memcpy(m_data + m_size + 1, &length, sizeof(length));
+            memcpy(m_data + m_size + 1 + sizeof(length), _value.data(), length);
+            m_size += 1 + sizeof(length) + length;
+        }
+
+        /*! Buffer */
+        uint8_t* m_data;
+
+        /*! Buffer size */
+        size_t m_capacity;
+
+        /*! Encoded size */
+        size_t m_size;
+    };
+
+    /**
+     * \brief Constructor.
+     */
+    BinaryLog();
+
+    /**
+     * \brief Destructor.
+     */
+    ~BinaryLog();
+
+    /**
+     * \brief Copy a record to the mapping.
+     *
+     * \param _record   Record, header included
+     * \param _size     Record size
+     * \return false if the file is full
+     */
+    bool commit(const uint8_t* _record, size_t _size);
+
+    /**
+     * \brief Write a site definition record.
+     *
+     * \param _id       Site id
+     */
+    void writeSiteDefinition(uint32_t _id);
+
+    /**
+     * \brief Release the mapping and the file handles.
+     *
+     * \param _size     Final file size
+     */
+    void unmap(size_t _size);
+
+    /**
+     * \brief Get current time in the entry time base.
+     *
+     * \return Steady clock time in nanoseconds
+     */
+    static uint64_t now();
+
+private:
+
+    /*! Mapped file */
+    uint8_t* m_data {nullptr};
+
+    /*! Mapped size */
+    size_t m_capacity {0};
+
+#ifdef _WIN32
+    /*! File handle */
+    void* m_file {nullptr};
+
+    /*! File mapping handle */
+    void* m_mapping {nullptr};
+#else
+    /*! File descriptor */
+    int m_file {-1};
+#endif
+
+    /*! Open flag */
+    std::atomic<bool> m_open {false};
+
+    /*! Maximum severity */
+    std::atomic<plog::Severity> m_max_severity {plog::debug};
+
+    /*! Offset of the next record, may go past the capacity when the file is full */
+    alignas(64) std::atomic<size_t> m_write_offset {0};
+
+    /*! Dropped entry count */
+    std::atomic<uint64_t> m_dropped {0};
+
+    /*! Registered sites */
+    std::vector<Site> m_sites;
+
+    /*! Sites mutex */
+    std::mutex m_sites_mutex;
+};
+
+
+/**
+ * \brief Write an entry.
+ *
+ * \param _site     Site id
+ * \param _args     Arguments
+ */
+template<typename... Args>
+void BinaryLog::write(uint32_t _site, const Args&... _args)
+{
+    uint8_t record[MAX_RECORD_SIZE];
+    Encoder encoder(record, sizeof(record), sizeof(BinaryLogRecordHeader) + sizeof(uint64_t));
+    (encoder.add(_args), ...);
+
+    BinaryLogRecordHeader header;
+    header.size = static_cast<uint32_t>(encoder.getSize());
+    header.site = _site;
+    uint64_t timestamp = now();
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), &timestamp, sizeof(timestamp));
+
+    if(!commit(record, header.size))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Expand a format string with arguments, as the decoder does.
+ *
+ * \param _format   Format string
+ * \param _args     Arguments
+ * \return Message
+ */
+template<typename... Args>
+std::string BinaryLog::format(const char* _format, const Args&... _args)
+{
+    uint8_t args[MAX_RECORD_SIZE];
+    Encoder encoder(args, sizeof(args), 0);
+    (encoder.add(_args), ...);
+
+    std::string message;
+    decodeBinaryLogMessage(_format, args, encoder.getSize(), message);
+    return message;
+}
+
+}//namespace ugly
+
+
+// Binary logging macros, the site is registered the first time the line runs
+// When the binary log is not open, the message is formatted and written to plog
+#define UGLY_BLOG(severity_, format_, ...) \
+    do \
+    { \
+        static const uint32_t ugly_blog_site = ugly::BinaryLog::getInstance()->registerSite(severity_, __FUNCTION__, __FILE__, __LINE__, format_); \
+        ugly::BinaryLog* ugly_blog = ugly::BinaryLog::getInstance(); \
+        if(ugly_blog->isOpen()) \
+        { \
+            if(ugly_blog->checkSeverity(severity_)) \
+                ugly_blog->write(ugly_blog_site, ##__VA_ARGS__); \
+        } \
+        else \
+        { \
+            PLOG(severity_) << ugly::BinaryLog::format(format_, ##__VA_ARGS__); \
+        } \
+    } while(0)
+
+#define UGLY_BLOG_VERBOSE(format_, ...) UGLY_BLOG(plog::verbose, format_, ##__VA_ARGS__)
+#define UGLY_BLOG_DEBUG(format_, ...) UGLY_BLOG(plog::debug, format_, ##__VA_ARGS__)
+#define UGLY_BLOG_INFO(format_, ...) UGLY_BLOG(plog::info, format_, ##__VA_ARGS__)
+#define UGLY_BLOG_WARNING(format_, ...) UGLY_BLOG(plog::warning, format_, ##__VA_ARGS__)
+#define UGLY_BLOG_ERROR(format_, ...) UGLY_BLOG(plog::error, format_, ##__VA_ARGS__)
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// This header does not depend on the engine so that the log decoder can use it alone
+
+namespace ugly
+{
+
+/**
+ * \brief Header of a binary log file.
+ */
+struct BinaryLogHeader
+{
+    /*! File magic */
+    static constexpr char MAGIC[4] = {'U', 'G', 'B', 'L'};
+
+    /*! Current format version */
+    static constexpr uint32_t VERSION = 1;
+
+    /*! Magic */
+    char magic[4];
+
+    /*! Format version */
+    uint32_t version;
+
+    /*! Steady clock time of the file creation in nanoseconds */
+    uint64_t origin;
+};
+
+
+/**
+ * \brief Header of a binary log record.
+ * The file is a BinaryLogHeader followed by records, it ends at the first record of size 0.
+ * A site definition record is a BinaryLogSiteDefinition followed by the function, file and
+ * format strings, each null terminated. An entry record is a steady clock time in nanoseconds
+ * followed by the arguments, each one is a BinaryLogArgType then its value.
+ */
+struct BinaryLogRecordHeader
+{
+    /*! Site id of the site definition records */
+    static constexpr uint32_t SITE_DEFINITION = UINT32_MAX;
+
+    /*! Record size, header included */
+    uint32_t size;
+
+    /*! Site id of an entry, SITE_DEFINITION for a site definition */
+    uint32_t site;
+};
+
+
+/**
+ * \brief Fixed part of a site definition record.
+ */
+struct BinaryLogSiteDefinition
+{
+    /*! Site id */
+    uint32_t id;
+
+    /*! Source line */
+    uint32_t line;
+
+    /*! plog severity */
+    uint32_t severity;
+};
+
+
+/**
+ * \brief Type of an entry argument.
+ */
+enum class BinaryLogArgType : uint8_t
+{
+    int64 = 1,      /*! int64_t. */
+    uint64,         /*! uint64_t. */
+    float64,        /*! double. */
+    boolean,        /*! uint8_t, 0 or 1. */
+    string          /*! uint16_t length then the characters. */
+};
+
+
+/**
+ * \brief Expand a format string with encoded arguments.
+ * Each {} of the format is replaced by the next argument.
+ *
+ * \param _format   Format string
+ * \param _args     Encoded arguments
+ * \param _size     Size of the encoded arguments
+ * \param _message  Expanded message
+ * \return false if the arguments are malformed
+ */
+inline bool decodeBinaryLogMessage(const char* _format, const uint8_t* _args, size_t _size, std::string& _message)
+{
+    size_t offset = 0;
+    bool valid = true;
+
+    auto read = [&](void* _value, size_t _value_size) -> bool
+    {
+        if(offset + _value_size > _size)
+            return false;
+        memcpy(_value, _args + offset, _value_size);
+        offset += _value_size;
+        return true;
+    };
+
+    _message.clear();
+    for(const char* c = _format; *c != 0; ++c)
+    {
+        if(c[0] != '{' || c[1] != '}' || offset >= _size || !valid)
+        {
+            _message += *c;
+            continue;
+        }
+        ++c;
+
+        char text[32];
+        uint8_t type = _args[offset++];
+        switch(static_cast<BinaryLogArgType>(type))
+        {
+        case BinaryLogArgType::int64:
+        {
+            int64_t value = 0;
+            valid = read(&value, sizeof(value));
+            snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+            break;
+        }
+        case BinaryLogArgType::uint64:
+        {
+            uint64_t value = 0;
+            valid = read(&value, sizeof(value));
+            snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+            break;
+        }
+        case BinaryLogArgType::float64:
+        {
+            double value = 0.0;
+            valid = read(&value, sizeof(value));
+            snprintf(text, sizeof(text), "%g", value);
+            break;
+        }
+        case BinaryLogArgType::boolean:
+        {
+            uint8_t value = 0;
+            valid = read(&value, sizeof(value));
+            snprintf(text, sizeof(text), "%s", value != 0 ? "true" : "false");
+            break;
+        }
+        case BinaryLogArgType::string:
+        {
+            uint16_t length = 0;
+            valid = read(&length, sizeof(length)) && offset + length <= _size;
+            if(valid)
+            {
+                _message.append(reinterpret_cast<const char*>(_args + offset), length);
+                offset += length;
+            }
+            continue;
+        }
+        default:
+            valid = false;
+            continue;
+        }
+
+        if(valid)
+            _message += text;
+    }
+
+    return valid;
+}
+
+}//namespace ugly
@@ -2,10 +2,22 @@
 
 //STL
 #include <string>
+#include <string_view>
+#include <array>
+#include <cmath>
 #include <map>
 #include <set>
 #include <optional>
 #include <fstream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 // Include configuration header
 #include "config.h"
@@ -27,5 +39,7 @@ namespace ugly
 {
 	static const std::string ENGINE_NAME = "UglyEngine";
 	static const std::string LOG_FILENAME = "UglyEngine.log";
+	static const std::string BINARY_LOG_FILENAME = "UglyEngine.blog";
+	static const std::string PIPELINE_CACHE_FILENAME = "UglyEngine.pipeline_cache";
 
 }//namespace ugly
\ No newline at end of file
@@ -4,6 +4,15 @@
 #include "Application.h"
 #include "InputManager.h"
 #include "VulkanManager.h"
+#include "FramePacer.h"
+#include "JobSystem.h"
+#include "SystemScheduler.h"
+#include "World.h"
+#include "FrameArena.h"
+#include "StartupTimeline.h"
+#include "InputLatencyTracker.h"
+#include "AsyncLogAppender.h"
+#include "BinaryLog.h"
 
 namespace ugly
 {
@@ -47,6 +56,13 @@ public:
      */
     InputManager* getInputManager() const;
 
+    /**
+     * \brief Get Vulkan manager.
+     *
+     * \return Vulkan manager, nullptr if Vulkan is not available in headless mode
+     */
+    VulkanManager* getVulkanManager() const;
+
     /**
      * \brief Get GLFW window.
      *
@@ -54,6 +70,150 @@ public:
      */
     GLFWwindow* getWindow() const;
 
+    /**
+     * \brief Enable headless mode.
+     * In headless mode no window is created, the main loop runs on a synthetic clock
+     * advancing one simulation tick per frame, and inputs come from InputManager::injectKeyChange().
+     * It must be called before run().
+     *
+     * \param _headless    Headless flag
+     */
+    void setHeadless(bool _headless);
+
+    /**
+     * \brief Check if the engine runs in headless mode.
+     *
+     * \return True if headless
+     */
+    bool isHeadless() const;
+
+    /**
+     * \brief Set the behavior of the logging threads when the log ring is full.
+     * It can be called before run().
+     *
+     * \param _policy   Overflow policy
+     */
+    void setLogOverflowPolicy(LogOverflowPolicy _policy);
+
+    /**
+     * \brief Enable the binary log.
+     * The UGLY_BLOG_* entries are written to BINARY_LOG_FILENAME instead of the text log.
+     * It must be called before run().
+     *
+     * \param _enabled    Binary log flag
+     */
+    void setBinaryLog(bool _enabled);
+
+    /**
+     * \brief Get log appender.
+     *
+     * \return Log appender
+     */
+    AsyncLogAppender* getLogAppender() const;
+
+    /**
+     * \brief Get frame pacer.
+     *
+     * \return Frame pacer
+     */
+    FramePacer* getFramePacer() const;
+
+    /**
+     * \brief Get job system.
+     *
+     * \return Job system
+     */
+    JobSystem* getJobSystem() const;
+
+    /**
+     * \brief Get system scheduler.
+     *
+     * \return System scheduler
+     */
+    SystemScheduler* getSystemScheduler() const;
+
+    /**
+     * \brief Get entity world.
+     *
+     * \return World
+     */
+    World* getWorld() const;
+
+    /**
+     * \brief Get frame arena.
+     *
+     * \return Frame arena
+     */
+    FrameArena* getFrameArena() const;
+
+    /**
+     * \brief Get startup timeline.
+     * Call StartupTimeline::dump() to log the duration of each initialization phase.
+     *
+     * \return Startup timeline
+     */
+    StartupTimeline* getStartupTimeline() const;
+
+    /**
+     * \brief Get input latency tracker.
+     * It holds the time from the oldest input processed by a frame to the present of this frame.
+     *
+     * \return Input latency tracker
+     */
+    InputLatencyTracker* getInputLatency() const;
+
+    /**
+     * \brief Record each input latency sample as a zone of the profiler trace.
+     *
+     * \param _enabled    Marker flag
+     */
+    void setInputLatencyMarker(bool _enabled);
+
+    /**
+     * \brief Set simulation tick rate.
+     * Application::update() is called at this fixed rate, independently of the frame rate.
+     *
+     * \param _tick_rate   Number of simulation ticks per second
+     */
+    void setTickRate(unsigned int _tick_rate);
+
+    /**
+     * \brief Get simulation tick rate.
+     *
+     * \return Number of simulation ticks per second
+     */
+    unsigned int getTickRate() const;
+
+    /**
+     * \brief Get the duration of a simulation tick.
+     *
+     * \return Tick duration in seconds
+     */
+    double getFixedDeltaTime() const;
+
+    /**
+     * \brief Set the maximum number of simulation ticks run in a single frame.
+     * When a frame is too slow, the remaining time is dropped instead of being caught up later.
+     *
+     * \param _max_ticks   Maximum number of ticks per frame
+     */
+    void setMaxCatchUpTicks(unsigned int _max_ticks);
+
+    /**
+     * \brief Set the number of frames in flight, before initialize().
+     * The CPU records a frame while the GPU executes the previous ones.
+     *
+     * \param _count   Number of frames in flight
+     */
+    void setFramesInFlight(unsigned int _count);
+
+    /**
+     * \brief Get the number of simulation ticks since the start of the main loop.
+     *
+     * \return Tick count
+     */
+    uint64_t getTickCount() const;
+
 private:
 
     /**
@@ -73,16 +233,30 @@ private:
 
     /**
      * \brief Initialize engine.
+     * Vulkan is initialized on a worker thread, concurrently with initializeMainThread().
      * 
      * \return false if error
      */
     bool initialize();
 
+    /**
+     * \brief Initialize the parts of the engine bound to the main thread.
+     * It runs while Vulkan is initialized on a worker thread.
+     *
+     * \return false if error
+     */
+    bool initializeMainThread();
+
     /**
      * \brief Shutdown engine.
      */
     void shutdown();
 
+    /**
+     * \brief Add an input latency sample if the presented frame processed new inputs.
+     */
+    void sampleInputLatency();
+
     /**
      * \brief Execute main loop.
      * 
@@ -103,12 +277,60 @@ private:
 
     /*! Quit flag */
     bool m_quit {false};
+
+    /*! Headless flag */
+    bool m_headless {false};
+
+    /*! Simulation tick rate */
+    unsigned int m_tick_rate {60};
+
+    /*! Simulation tick duration */
+    std::chrono::nanoseconds m_tick_duration {std::chrono::nanoseconds(std::chrono::seconds(1)) / 60};
+
+    /*! Maximum number of simulation ticks in a frame */
+    unsigned int m_max_catch_up_ticks {5};
+
+    /*! Number of frames in flight */
+    unsigned int m_frames_in_flight {2};
+
+    /*! Binary log flag */
+    bool m_binary_log {false};
+
+    /*! Input latency marker flag */
+    bool m_input_latency_marker {false};
+
+    /*! Simulation tick counter */
+    uint64_t m_tick_count {0};
     
     /*! Input manager */
     std::unique_ptr<InputManager> m_input_manager {nullptr};
 
     /*! Vulkan manager */
     std::unique_ptr<VulkanManager> m_vulkan_manager {nullptr};
+
+    /*! Job system */
+    std::unique_ptr<JobSystem> m_job_system {nullptr};
+
+    /*! System scheduler */
+    std::unique_ptr<SystemScheduler> m_system_scheduler {nullptr};
+
+    /*! Entity world */
+    std::unique_ptr<World> m_world {nullptr};
+
+    /*! Frame arena */
+    std::unique_ptr<FrameArena> m_frame_arena {nullptr};
+
+    /*! Log appender */
+    std::unique_ptr<AsyncLogAppender> m_log_appender {std::make_unique<AsyncLogAppender>()};
+
+    /*! Frame pacer */
+    std::unique_ptr<FramePacer> m_frame_pacer {std::make_unique<FramePacer>()};
+
+    /*! Startup timeline */
+    std::unique_ptr<StartupTimeline> m_startup_timeline {std::make_unique<StartupTimeline>()};
+
+    /*! Input latency tracker */
+    std::unique_ptr<InputLatencyTracker> m_input_latency {std::make_unique<InputLatencyTracker>()};
 };
 
 }//namespace ugly
\ No newline at end of file
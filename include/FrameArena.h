@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \class FrameArena
+ * \brief Double buffered per-frame linear allocator.
+ *
+ * Each thread bumps a pointer in its own block, a lock is only taken to get a new block.
+ * Memory allocated during a frame stays valid during the next frame, so it can be handed
+ * over to the render of the next frame, and is recycled at the end of that one.
+ * Nothing is ever freed individually and destructors are not called.
+ */
+class FrameArena
+{
+public:
+
+    /*! Default block size */
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * \brief Constructor.
+     */
+    FrameArena();
+
+    /**
+     * \brief Destructor.
+     */
+    virtual ~FrameArena();
+
+    /**
+     * \brief Allocate memory for the current frame.
+     *
+     * \param _size         Size in bytes
+     * \param _alignment    Alignment, power of two
+     * \return Memory, valid until the end of the next frame
+     */
+    void* allocate(size_t _size, size_t _alignment = alignof(std::max_align_t));
+
+    /**
+     * \brief End the current frame.
+     * The memory of the previous frame is recycled. It must be called while no other
+     * thread allocates.
+     */
+    void endFrame();
+
+    /**
+     * \brief Get the number of bytes allocated during the current frame.
+     *
+     * \return Allocated bytes
+     */
+    size_t getAllocatedBytes() const;
+
+    /**
+     * \brief Get the number of bytes reserved from the system.
+     *
+     * \return Reserved bytes
+     */
+    size_t getReservedBytes() const;
+
+private:
+
+    /**
+     * \brief Memory block, its data follows the header.
+     */
+    struct Block
+    {
+        /*! Next block in the list */
+        Block* next;
+
+        /*! Data size */
+        size_t size;
+    };
+
+    /**
+     * \brief Blocks used during a frame.
+     */
+    struct Buffer
+    {
+        /*! First block */
+        Block* head {nullptr};
+
+        /*! Last block */
+        Block* tail {nullptr};
+
+        /*! Allocated bytes */
+        std::atomic<size_t> allocated_bytes {0};
+    };
+
+    /**
+     * \brief Get a block for the current frame.
+     *
+     * \param _size     Minimal data size
+     * \return Block
+     */
+    Block* acquireBlock(size_t _size);
+
+    /**
+     * \brief Get the data of a block.
+     */
+    static char* getData(Block* _block);
+
+private:
+
+    /*! Frame buffers, current and previous */
+    Buffer m_buffers[2];
+
+    /*! Index of the current buffer */
+    uint32_t m_current {0};
+
+    /*! Epoch of the current frame, unique across arenas */
+    std::atomic<uint64_t> m_epoch {0};
+
+    /*! Recycled blocks */
+    Block* m_free_blocks {nullptr};
+
+    /*! Reserved bytes */
+    std::atomic<size_t> m_reserved_bytes {0};
+
+    /*! Block list mutex */
+    std::mutex m_mutex;
+};
+
+
+/**
+ * \class FrameAllocator
+ * \brief STL allocator adapter allocating from a frame arena.
+ *
+ * Deallocation does nothing, a container using it must not outlive the next frame.
+ */
+template<class T>
+class FrameAllocator
+{
+public:
+
+    using value_type = T;
+
+    explicit FrameAllocator(FrameArena* _arena) noexcept : m_arena(_arena) {}
+
+    template<class U>
+    FrameAllocator(const FrameAllocator<U>& _other) noexcept : m_arena(_other.getArena()) {}
+
+    T* allocate(size_t _count)
+    {
+        return static_cast<T*>(m_arena->allocate(_count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept
+    {
+    }
+
+    FrameArena* getArena() const
+    {
+        return m_arena;
+    }
+
+    template<class U>
+    bool operator==(const FrameAllocator<U>& _other) const { return m_arena == _other.getArena(); }
+
+    template<class U>
+    bool operator!=(const FrameAllocator<U>& _other) const { return m_arena != _other.getArena(); }
+
+private:
+
+    /*! Arena */
+    FrameArena* m_arena;
+};
+
+/*! Vector allocated from a frame arena */
+template<class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+}//namespace ugly
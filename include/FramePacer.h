@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \class FramePacer
+ * \brief Frame limiter.
+ *
+ * The pacer waits until the deadline of the current frame. It sleeps for most of
+ * the remaining time and spins for the last part to wake up precisely.
+ * Deadlines are absolute so that sleep inaccuracies do not accumulate.
+ */
+class FramePacer
+{
+public:
+
+    /**
+     * \brief Constructor.
+     */
+    FramePacer();
+
+    /**
+     * \brief Set target frame time.
+     *
+     * \param _frame_time   Target frame time, 0 to disable the limiter
+     */
+    void setTargetFrameTime(std::chrono::nanoseconds _frame_time);
+
+    /**
+     * \brief Set target frame rate.
+     *
+     * \param _frame_rate   Target frames per second, 0 to disable the limiter
+     */
+    void setTargetFrameRate(unsigned int _frame_rate);
+
+    /**
+     * \brief Get target frame time.
+     *
+     * \return Target frame time, 0 if the limiter is disabled
+     */
+    std::chrono::nanoseconds getTargetFrameTime() const;
+
+    /**
+     * \brief Set the duration spent spinning before the deadline.
+     * It must be larger than the scheduler wake up latency.
+     *
+     * \param _spin_time    Spin duration
+     */
+    void setSpinTime(std::chrono::nanoseconds _spin_time);
+
+    /**
+     * \brief Restart pacing from now and clear statistics.
+     */
+    void reset();
+
+    /**
+     * \brief Wait for the end of the current frame.
+     */
+    void wait();
+
+    /**
+     * \brief Get the jitter of the last frame.
+     * The jitter is the difference between the wake up time and the deadline.
+     *
+     * \return Last jitter
+     */
+    std::chrono::nanoseconds getLastJitter() const;
+
+    /**
+     * \brief Get the mean jitter since the last reset.
+     *
+     * \return Mean jitter
+     */
+    std::chrono::nanoseconds getMeanJitter() const;
+
+    /**
+     * \brief Get the maximum jitter since the last reset.
+     *
+     * \return Maximum jitter
+     */
+    std::chrono::nanoseconds getMaxJitter() const;
+
+    /**
+     * \brief Get the number of frames which missed their deadline since the last reset.
+     *
+     * \return Missed frame count
+     */
+    uint64_t getMissedFrameCount() const;
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    /*! Target frame time */
+    std::chrono::nanoseconds m_target_frame_time {std::chrono::nanoseconds(std::chrono::seconds(1)) / 60};
+
+    /*! Spin duration before the deadline */
+    std::chrono::nanoseconds m_spin_time {std::chrono::microseconds(500)};
+
+    /*! Deadline of the current frame */
+    Clock::time_point m_deadline;
+
+    /*! Deadline validity flag */
+    bool m_started {false};
+
+    /*! Last jitter */
+    std::chrono::nanoseconds m_last_jitter {0};
+
+    /*! Sum of jitters */
+    std::chrono::nanoseconds m_total_jitter {0};
+
+    /*! Maximum jitter */
+    std::chrono::nanoseconds m_max_jitter {0};
+
+    /*! Number of paced frames */
+    uint64_t m_frame_count {0};
+
+    /*! Number of frames which missed their deadline */
+    uint64_t m_missed_frame_count {0};
+};
+
+}//namespace ugly
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \brief Timestamped key event.
+ */
+struct InputEvent
+{
+    /*! Steady clock time in nanoseconds of the push */
+    uint64_t timestamp;
+
+    /*! GLFW key name */
+    int16_t key_name;
+
+    /*! GLFW action */
+    uint8_t action;
+
+    /*! GLFW modifier bits */
+    uint8_t mods;
+};
+
+
+/**
+ * \class InputEventQueue
+ * \brief Wait-free single producer single consumer ring of input events.
+ *
+ * The producer is the thread polling the window events, the consumer is the simulation thread.
+ * Each side owns its index and only reads the other one, so push and pop never wait.
+ * When the ring is full, new events are dropped and counted.
+ */
+class InputEventQueue
+{
+public:
+
+    /*! Number of events, must be a power of two */
+    static constexpr uint32_t CAPACITY = 1024;
+
+    /**
+     * \brief Push an event, producer side.
+     *
+     * \param _event    Event
+     * \return False if the queue is full and the event dropped
+     */
+    bool push(const InputEvent& _event);
+
+    /**
+     * \brief Get the oldest event without removing it, consumer side.
+     *
+     * \return Event, nullptr if the queue is empty
+     */
+    const InputEvent* front();
+
+    /**
+     * \brief Remove the oldest event, consumer side.
+     * It must follow a front() call which returned an event.
+     */
+    void pop();
+
+    /**
+     * \brief Get the number of dropped events since the creation.
+     *
+     * \return Dropped event count
+     */
+    uint64_t getDroppedCount() const;
+
+    /**
+     * \brief Get current time in the event time base.
+     *
+     * \return Steady clock time in nanoseconds
+     */
+    static uint64_t now();
+
+private:
+
+    /*! Events */
+    InputEvent m_events[CAPACITY];
+
+    /*! Next slot to write, written by the producer */
+    alignas(64) std::atomic<uint32_t> m_tail {0};
+
+    /*! Consumer index cached by the producer */
+    uint32_t m_cached_head {0};
+
+    /*! Dropped event count, written by the producer */
+    std::atomic<uint64_t> m_dropped {0};
+
+    /*! Next slot to read, written by the consumer */
+    alignas(64) std::atomic<uint32_t> m_head {0};
+
+    /*! Producer index cached by the consumer */
+    uint32_t m_cached_tail {0};
+};
+
+}//namespace ugly
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \class InputLatencyTracker
+ * \brief Distribution of the input to present latency.
+ *
+ * The engine adds a sample for each presented frame which reflects new inputs, measured
+ * from the oldest input processed by the frame. The most recent samples are kept.
+ */
+class InputLatencyTracker
+{
+public:
+
+    /*! Number of kept samples */
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    /**
+     * \brief Constructor.
+     */
+    InputLatencyTracker();
+
+    /**
+     * \brief Add a latency sample.
+     *
+     * \param _latency  Latency
+     */
+    void addSample(std::chrono::nanoseconds _latency);
+
+    /**
+     * \brief Discard the samples.
+     */
+    void reset();
+
+    /**
+     * \brief Get the number of samples since the last reset.
+     *
+     * \return Sample count
+     */
+    uint64_t getSampleCount() const;
+
+    /**
+     * \brief Get a latency percentile of the kept samples.
+     *
+     * \param _percentile   Percentile in [0, 100]
+     * \return Latency, 0 if there is no sample
+     */
+    std::chrono::nanoseconds getPercentile(double _percentile) const;
+
+    /**
+     * \brief Log the p50 and p99 latencies.
+     */
+    void logReport() const;
+
+private:
+
+    /*! Samples in microseconds */
+    std::vector<uint32_t> m_samples;
+
+    /*! Sample count since the last reset */
+    uint64_t m_sample_count {0};
+};
+
+}//namespace ugly
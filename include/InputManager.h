@@ -3,6 +3,9 @@
 #include "Core.h"
 #include "InputStats.h"
 #include "InputButton.h"
+#include "InputEventQueue.h"
+#include "InputRecorder.h"
+#include "InputReplay.h"
 
 namespace ugly
 {
@@ -10,11 +13,104 @@ namespace ugly
 /**
  * \class InputManager
  * \brief Input manager
+ *
+ * Buttons are bound to keys, chords of keys and modifiers, in binding contexts.
+ * Bindings are compiled into key bitsets, so evaluating all of them is a few passes
+ * of bitwise operations over contiguous arrays.
+ * Mouse and gamepad buttons are input codes after the keyboard keys, so they bind like keys.
+ * Axes read the mouse, the scroll and the gamepad sticks and triggers, they are polled
+ * once per frame, processed once per tick and stored in contiguous buffers. Mouse and
+ * scroll moves accumulate until a tick uses them.
  */
 class InputManager
 {
 public:
 
+    /*! First input code of the mouse buttons */
+    static constexpr int MOUSE_BUTTON_BASE = GLFW_KEY_LAST + 1;
+
+    /*! First input code of the gamepad buttons, pressed on any connected gamepad */
+    static constexpr int GAMEPAD_BUTTON_BASE = MOUSE_BUTTON_BASE + GLFW_MOUSE_BUTTON_LAST + 1;
+
+    /*! Number of input codes */
+    static constexpr int INPUT_CODE_COUNT = GAMEPAD_BUTTON_BASE + GLFW_GAMEPAD_BUTTON_LAST + 1;
+
+    /*! Number of 64 bits words of a key bitset */
+    static constexpr size_t KEY_WORDS = (INPUT_CODE_COUNT + 63) / 64;
+
+    /*! Axis source of the horizontal mouse move since the last tick, in pixels */
+    static constexpr int AXIS_MOUSE_X = 0;
+
+    /*! Axis source of the vertical mouse move since the last tick, in pixels */
+    static constexpr int AXIS_MOUSE_Y = 1;
+
+    /*! Axis source of the horizontal scroll since the last tick */
+    static constexpr int AXIS_SCROLL_X = 2;
+
+    /*! Axis source of the vertical scroll since the last tick */
+    static constexpr int AXIS_SCROLL_Y = 3;
+
+    /*! First axis source of the gamepads */
+    static constexpr int AXIS_GAMEPAD_BASE = 4;
+
+    /*! Number of gamepads */
+    static constexpr int GAMEPAD_COUNT = GLFW_JOYSTICK_LAST + 1;
+
+    /*! Number of axes of a gamepad */
+    static constexpr int GAMEPAD_AXIS_COUNT = GLFW_GAMEPAD_AXIS_LAST + 1;
+
+    /*! Number of axis sources */
+    static constexpr int AXIS_SOURCE_COUNT = AXIS_GAMEPAD_BASE + GAMEPAD_COUNT * GAMEPAD_AXIS_COUNT;
+
+    /**
+     * \brief Get the input code of a mouse button.
+     *
+     * \param _button   GLFW mouse button
+     * \return Input code
+     */
+    static constexpr int mouseButton(int _button)
+    {
+        return MOUSE_BUTTON_BASE + _button;
+    }
+
+    /**
+     * \brief Get the input code of a gamepad button.
+     *
+     * \param _button   GLFW gamepad button
+     * \return Input code
+     */
+    static constexpr int gamepadButton(int _button)
+    {
+        return GAMEPAD_BUTTON_BASE + _button;
+    }
+
+    /**
+     * \brief Get the axis source of a gamepad axis.
+     *
+     * \param _gamepad  GLFW joystick
+     * \param _axis     GLFW gamepad axis
+     * \return Axis source
+     */
+    static constexpr int gamepadAxis(int _gamepad, int _axis)
+    {
+        return AXIS_GAMEPAD_BASE + _gamepad * GAMEPAD_AXIS_COUNT + _axis;
+    }
+
+    /*! Key bitset, bit k is the input code k */
+    using KeySet = std::array<uint64_t, KEY_WORDS>;
+
+    /*! Default binding context, always enabled */
+    static constexpr uint32_t DEFAULT_CONTEXT = 0;
+
+    /*! Maximum number of binding contexts */
+    static constexpr uint32_t MAX_CONTEXTS = 32;
+
+    /*! Invalid binding context */
+    static constexpr uint32_t INVALID_CONTEXT = UINT32_MAX;
+
+    /*! Modifiers matched by bindings */
+    static constexpr int BINDING_MODS = GLFW_MOD_SHIFT | GLFW_MOD_CONTROL | GLFW_MOD_ALT | GLFW_MOD_SUPER;
+
     /**
      *  \brief Constructor.
      */
@@ -36,57 +132,563 @@ public:
      *
      * This function updates state(for exemple pass key state from released to none).
      * It must be call after event processing and before polling events.
+     * Only the buttons changed since the last update are visited, then the current state
+     * bitset is copied to the previous state snapshot.
      */
     void update();
 
     /**
      * \brief Process a key change.
      * 
-     * This method is mainly used by GLFW key callback.
-     * If key is not bind, nothing happens.
+     * This method is mainly used by processEvents().
+     * The key state is updated and the bindings are evaluated.
+     * \param key_name  GLFW key name
+     * \param action    GLFW action
+     * \param mods      GLFW modifier bits, only the lock bits are used, the others come from the key state
+     */
+    void processKeyChange(int key_name, int action, int mods = 0);
+
+    /**
+     * \brief Queue a timestamped key change.
+     *
+     * This method is used by GLFW key callback, it only writes the event queue.
+     * It must always be called from the same thread, the one polling the events.
      * \param key_name  GLFW key name
      * \param action    GLFW action
+     * \param mods      GLFW modifier bits
+     */
+    void pushKeyEvent(int key_name, int action, int mods);
+
+    /**
+     * \brief Queue a scroll offset.
+     *
+     * This method is used by GLFW scroll callback, it only writes a counter of the polling thread
+     * which pollDevices() moves to the scroll sources.
+     * \param xoffset   Horizontal scroll offset
+     * \param yoffset   Vertical scroll offset
+     */
+    void pushScroll(double xoffset, double yoffset);
+
+    /**
+     * \brief Inject a key change.
+     *
+     * The change is queued like a GLFW event, timestamped now, and processed by the first tick ending
+     * after it: the next tick when headless, possibly a later one when the simulation is ahead of the clock.
+     * It must be called from the thread polling the events, the main thread.
+     * \param key_name  GLFW key name
+     * \param action    GLFW action
+     */
+    void injectKeyChange(int key_name, int action);
+
+    /**
+     * \brief Poll the mouse, the scroll and the gamepads.
+     *
+     * The engine calls it once per frame after the window events. Gamepad button changes are
+     * queued like key changes. Mouse and scroll moves accumulate until a tick uses them, the
+     * axes are processed at the start of each tick by processEvents().
+     */
+    void pollDevices();
+
+    /**
+     * \brief Inject an axis source value, used instead of the devices when headless.
+     * Mouse and scroll sources accumulate until the end of the next tick.
+     * It must be called from the thread polling the events, the main thread.
+     *
+     * \param source    Axis source
+     * \param value     Value
+     */
+    void injectAxisValue(int source, float value);
+
+    /**
+     * \brief Process the queued key changes which happened before a time, then the axes.
+     *
+     * The engine calls it at the start of each simulation tick with the end time of the tick,
+     * so events keep their sub-frame position when several ticks run in the same frame.
+     * \param until     Steady clock time in nanoseconds, see InputEventQueue::now()
+     */
+    void processEvents(uint64_t until);
+
+    /**
+     * \brief Get and clear the time of the oldest key change processed since the last call.
+     * The engine calls it after each present to measure the input latency.
+     *
+     * \return Steady clock time in nanoseconds, 0 if no key change was processed
+     */
+    uint64_t consumeInputTime();
+
+    /**
+     * \brief Start recording the processed key changes.
+     * Each change is written with its tick, counted from the first tick after this call.
+     *
+     * \param filename  Recording file name
+     * \return False if error
      */
-    void processKeyChange(int key_name, int action);
+    bool startRecording(const std::string& filename);
+
+    /**
+     * \brief Stop recording and close the file.
+     */
+    void stopRecording();
+
+    /**
+     * \brief Start replaying a recording.
+     * Recorded changes go through processKeyChange() at their tick, counted from the first
+     * tick after this call. Key changes from the window are ignored during the replay.
+     *
+     * \param filename  Recording file name
+     * \return False if error
+     */
+    bool startReplay(const std::string& filename);
+
+    /**
+     * \brief Stop replaying.
+     */
+    void stopReplay();
+
+    /**
+     * \brief Check if a replay is running.
+     *
+     * \return True if replaying
+     */
+    bool isReplaying() const;
 
     /**
      * \brief Create a button.
      * 
      * \param button_name   InputButton name
+     * \return Button handle, invalid if error
      */
-    void createButton(const std::string& button_name);
+    InputButtonHandle createButton(const std::string& button_name);
 
     /**
      * \brief Bind a key to a button.
+     * A key may be bound to several buttons, and a button to several keys.
+     * 
+     * \param key_name      GFLW key name
+     * \param button        Button handle
+     * \param mods          Modifiers which must be held, GLFW_MOD_SHIFT, GLFW_MOD_CONTROL, GLFW_MOD_ALT or GLFW_MOD_SUPER
+     * \param context       Binding context
+     */
+    void bindKeyToButton(int key_name, InputButtonHandle button, int mods = 0, uint32_t context = DEFAULT_CONTEXT);
+
+    /**
+     * \brief Bind a chord of keys to a button.
+     * The button is pressed while all the keys and the modifiers are held. A binding with
+     * modifiers hides the bindings without modifiers of the same keys while it is held.
+     * 
+     * \param key_names     GFLW key names
+     * \param button        Button handle
+     * \param mods          Modifiers which must be held
+     * \param context       Binding context
+     */
+    void bindChordToButton(const std::vector<int>& key_names, InputButtonHandle button, int mods = 0, uint32_t context = DEFAULT_CONTEXT);
+
+    /**
+     * \brief Remove all the bindings of a button.
+     *
+     * \param button        Button handle
+     */
+    void unbindButton(InputButtonHandle button);
+
+    /**
+     * \brief Bind a key to a button.
+     * The button is created if it does not exist.
      * 
      * \param key_name      GFLW key name
      * \param button_name   Button name
      */
     void bindKeyToButton(int key_name, const std::string& button_name);
 
+    /**
+     * \brief Create an axis.
+     * The source value is remapped outside of the dead zone and shaped by the response curve:
+     * v = sign(x) * max(|x| - dead_zone, 0) / (1 - dead_zone), value = (1 - curve) * v + curve * v^3.
+     *
+     * \param axis_name     Axis name
+     * \param source        Axis source, AXIS_MOUSE_X, AXIS_MOUSE_Y, AXIS_SCROLL_X, AXIS_SCROLL_Y or gamepadAxis()
+     * \param dead_zone     Dead zone in [0, 1)
+     * \param curve         Cubic blend factor in [0, 1], 0 for a linear response
+     * \return Axis handle, invalid if error
+     */
+    InputAxisHandle createAxis(const std::string& axis_name, int source, float dead_zone = 0.0f, float curve = 0.0f);
+
+    /**
+     * \brief Get an axis handle.
+     *
+     * \param action_id     Axis identifier, see makeInputActionId()
+     * \return Axis handle, invalid if not found
+     */
+    InputAxisHandle getAxisHandle(InputActionId action_id) const;
+
+    /**
+     * \brief Get an axis value.
+     *
+     * \param axis          Axis handle
+     * \return Processed value of the current tick, 0 if invalid
+     */
+    float getAxisValue(InputAxisHandle axis) const;
+
+    /**
+     * \brief Get the values of all the axes, indexed by handle.
+     *
+     * \return getAxisCount() values
+     */
+    const float* getAxisValues() const;
+
+    /**
+     * \brief Get the number of axes.
+     *
+     * \return Axis count
+     */
+    size_t getAxisCount() const;
+
+    /**
+     * \brief Get the connected gamepads.
+     *
+     * \return Bit j is set if the joystick j is a connected gamepad
+     */
+    uint32_t getConnectedGamepads() const;
+
+    /**
+     * \brief Create a binding context.
+     * Contexts are layers: a key bound in an enabled context hides the bindings of this key
+     * in the contexts created before it. New contexts are disabled.
+     *
+     * \param context_name  Context name
+     * \return Context index, INVALID_CONTEXT if error
+     */
+    uint32_t createContext(const std::string& context_name);
+
+    /**
+     * \brief Enable or disable a binding context.
+     * Buttons bound only in a disabled context are released.
+     *
+     * \param context       Context index
+     * \param enabled       Enable flag
+     */
+    void setContextEnabled(uint32_t context, bool enabled);
+
+    /**
+     * \brief Check if a binding context is enabled.
+     *
+     * \param context       Context index
+     * \return True if enabled
+     */
+    bool isContextEnabled(uint32_t context) const;
+
+    /**
+     * \brief Check if a key is held.
+     *
+     * \param key_name      GLFW key name
+     * \return True if held
+     */
+    bool isKeyDown(int key_name) const;
+
+    /**
+     * \brief Get a button handle.
+     * Gameplay code should resolve handles once and poll with them.
+     *
+     * \param action_id     Action identifier, see makeInputActionId()
+     * \return Button handle, invalid if not found
+     */
+    InputButtonHandle getButtonHandle(InputActionId action_id) const;
+
+    /**
+     * \brief Get a button handle.
+     *
+     * \param button_name   InputButton name
+     * \return Button handle, invalid if not found
+     */
+    InputButtonHandle getButtonHandle(const std::string& button_name) const;
+
+    /**
+     * \brief Get a button name.
+     *
+     * \param button        Button handle
+     * \return Button name, empty if invalid
+     */
+    const std::string& getButtonName(InputButtonHandle button) const;
+
+    /**
+     * \brief Get the number of buttons.
+     *
+     * \return Button count
+     */
+    size_t getButtonCount() const;
+
+    /**
+     * \brief Get a button state.
+     * 
+     * \param button        Button handle
+     * \return InputButton state, release if invalid
+     */
+    InputState getButtonState(InputButtonHandle button) const;
+
+    /**
+     * \brief Get a button action.
+     * 
+     * \param button        Button handle
+     * \return InputButton last action, none if invalid
+     */
+    InputAction getButtonAction(InputButtonHandle button) const;
+
+    /**
+     * \brief Check if a button went from release to press since the last update.
+     * A press and a release between two updates cancel out, use the action to catch it.
+     *
+     * \param button        Button handle
+     * \return True if pressed
+     */
+    bool wasButtonPressed(InputButtonHandle button) const;
+
+    /**
+     * \brief Check if a button went from press to release since the last update.
+     *
+     * \param button        Button handle
+     * \return True if released
+     */
+    bool wasButtonReleased(InputButtonHandle button) const;
+
+    /**
+     * \brief Get the number of 64 bits words of the state bitsets.
+     *
+     * \return Word count
+     */
+    size_t getStateWordCount() const;
+
+    /**
+     * \brief Get the current state bitset, bit i is set if the button of index i is pressed.
+     *
+     * \return getStateWordCount() words
+     */
+    const uint64_t* getCurrentState() const;
+
+    /**
+     * \brief Get the state bitset snapshot taken by the last update.
+     *
+     * \return getStateWordCount() words
+     */
+    const uint64_t* getPreviousState() const;
+
+    /**
+     * \brief Compute the pressed and released edges of all buttons since the last update.
+     *
+     * \param _pressed      getStateWordCount() words receiving the buttons which went from release to press
+     * \param _released     getStateWordCount() words receiving the buttons which went from press to release
+     */
+    void computeEdges(uint64_t* _pressed, uint64_t* _released) const;
+
+    /**
+     * \brief Get a button state.
+     * 
+     * \param action_id     Action identifier
+     * \return InputButton state, release if not found
+     */
+    InputState getButtonState(InputActionId action_id);
+
+    /**
+     * \brief Get a button action.
+     * 
+     * \param action_id     Action identifier
+     * \return InputButton last action, none if not found
+     */
+    InputAction getButtonAction(InputActionId action_id);
+
     /**
      * \brief Get a button state.
+     * Slow path, the name is hashed on each call.
      * 
      * \param button_name   InputButton name
-     * \return InputButton state
+     * \return InputButton state, release if not found
      */
-    const InputState& getButtonState(const std::string& button_name);
+    InputState getButtonState(const std::string& button_name);
 
     /**
      * \brief Get a button action.
+     * Slow path, the name is hashed on each call.
      * 
      * \param button_name   InputButton name
-     * \return InputButton last action
+     * \return InputButton last action, none if not found
      */
-    const InputAction& getButtonAction(const std::string& button_name);
+    InputAction getButtonAction(const std::string& button_name);
 
 private:
 
-    /*! InputButton list. */
-    std::map<std::string, std::unique_ptr<InputButton>> m_buttons;
+    /**
+     * \brief Apply the dead zones and the response curves to all the axes.
+     */
+    void processAxes();
+
+    /**
+     * \brief Binding of a chord to a button.
+     */
+    struct Binding
+    {
+        /*! Keys to hold */
+        KeySet keys;
+
+        /*! Modifiers to hold */
+        int mods;
+
+        /*! Context index */
+        uint32_t context;
+
+        /*! Button index */
+        uint32_t button;
+    };
+
+    /**
+     * \brief Compile the bindings of the enabled contexts and evaluate them.
+     */
+    void compileBindings();
+
+    /**
+     * \brief Evaluate the compiled bindings and update the button states and actions.
+     */
+    void evaluateBindings();
+
+    /**
+     * \brief Set a button action and mark it changed.
+     *
+     * \param index     Button index
+     * \param action    Action
+     */
+    void setButtonAction(uint32_t index, InputAction action);
+
+    /**
+     * \brief Insert a button in the identifier table.
+     *
+     * \param index     Button index
+     */
+    void insertButtonId(uint32_t index);
+
+    /**
+     * \brief Report a lookup of an unknown button, once per identifier.
+     *
+     * \param action_id     Action identifier
+     * \param button_name   Button name if known
+     */
+    void reportMissingButton(InputActionId action_id, const std::string& button_name = std::string());
+
+    /*! Button actions, by handle */
+    std::vector<InputAction> m_actions;
+
+    /*! Buttons with an action to reset at the next update */
+    std::vector<uint32_t> m_dirty_buttons;
+
+    /*! Pressed buttons bitset */
+    std::vector<uint64_t> m_current_state;
+
+    /*! Pressed buttons bitset at the last update */
+    std::vector<uint64_t> m_previous_state;
+
+    /*! Button names, by handle */
+    std::vector<std::string> m_button_names;
+
+    /*! Button action identifiers, by handle */
+    std::vector<InputActionId> m_button_ids;
+
+    /*! Open addressing table of button index + 1 by action identifier, 0 if empty */
+    std::vector<uint32_t> m_id_table;
+
+    /*! Bindings */
+    std::vector<Binding> m_bindings;
+
+    /*! Context names */
+    std::vector<std::string> m_context_names;
+
+    /*! Enabled contexts, bit c for the context c */
+    uint32_t m_enabled_contexts {1u << DEFAULT_CONTEXT};
+
+    /*! Compiled binding keys, by compiled binding */
+    std::vector<KeySet> m_compiled_keys;
+
+    /*! Compiled binding modifiers */
+    std::vector<int> m_compiled_mods;
+
+    /*! Compiled binding button indices */
+    std::vector<uint32_t> m_compiled_buttons;
+
+    /*! Compiled binding match flags, evaluation scratch */
+    std::vector<uint8_t> m_compiled_matches;
+
+    /*! Pressed buttons bitset, evaluation scratch */
+    std::vector<uint64_t> m_evaluated_state;
+
+    /*! Held keys */
+    KeySet m_key_state {};
+
+    /*! Held modifiers */
+    int m_mods {0};
+
+    /*! Raw axis source values, mouse and scroll moves since the last tick */
+    std::array<float, AXIS_SOURCE_COUNT> m_axis_sources {};
+
+    /*! Scroll offset since the last poll, written by the polling thread only */
+    glm::dvec2 m_scroll_offset {0.0, 0.0};
+
+    /*! Axis names, by handle */
+    std::vector<std::string> m_axis_names;
+
+    /*! Axis identifiers, by handle */
+    std::vector<InputActionId> m_axis_ids;
+
+    /*! Axis sources, by handle */
+    std::vector<int> m_axis_source_indices;
+
+    /*! Axis dead zones, by handle */
+    std::vector<float> m_axis_dead_zones;
+
+    /*! Axis scales remapping the range out of the dead zone to [0, 1], by handle */
+    std::vector<float> m_axis_scales;
+
+    /*! Axis response curves, by handle */
+    std::vector<float> m_axis_curves;
+
+    /*! Axis raw values gathered from the sources, by handle */
+    std::vector<float> m_axis_raw_values;
+
+    /*! Axis processed values, by handle */
+    std::vector<float> m_axis_values;
+
+    /*! Connected gamepads */
+    uint32_t m_connected_gamepads {0};
+
+    /*! Gamepad buttons pressed on any gamepad at the last poll */
+    uint32_t m_gamepad_buttons {0};
+
+    /*! Last cursor position */
+    glm::dvec2 m_cursor_position {0.0, 0.0};
+
+    /*! True once the cursor position is known */
+    bool m_cursor_position_valid {false};
+
+    /*! Unknown action identifiers already reported */
+    std::set<InputActionId> m_reported_missing_buttons;
+
+    /*! Key changes waiting for processing */
+    InputEventQueue m_event_queue;
+
+    /*! Time of the oldest key change processed since the last consumeInputTime() call */
+    uint64_t m_input_time {0};
+
+    /*! Dropped key changes already reported */
+    uint64_t m_reported_dropped_events {0};
+
+    /*! Tick not known yet */
+    static constexpr uint64_t UNKNOWN_TICK = UINT64_MAX;
+
+    /*! Input recorder, nullptr if not recording */
+    std::unique_ptr<InputRecorder> m_recorder {nullptr};
+
+    /*! First recorded tick */
+    uint64_t m_recording_start_tick {UNKNOWN_TICK};
+
+    /*! Input replay, nullptr if not replaying */
+    std::unique_ptr<InputReplay> m_replay {nullptr};
 
-    /*! Key to button mapping*/
-    std::map<int, std::string> m_key_button_mapping;
+    /*! First replayed tick */
+    uint64_t m_replay_start_tick {UNKNOWN_TICK};
 };
 
 }//namespace ugly
\ No newline at end of file
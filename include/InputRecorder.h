@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \brief Header of an input recording file.
+ */
+struct InputRecordingHeader
+{
+    /*! File magic */
+    static constexpr char MAGIC[4] = {'U', 'G', 'I', 'R'};
+
+    /*! Current format version */
+    static constexpr uint32_t VERSION = 1;
+
+    /*! Magic */
+    char magic[4];
+
+    /*! Format version */
+    uint32_t version;
+
+    /*! Simulation tick rate of the recorded session */
+    uint32_t tick_rate;
+
+    /*! Reserved, 0 */
+    uint32_t reserved;
+};
+
+
+/**
+ * \brief Recorded key change.
+ */
+struct InputRecord
+{
+    /*! Tick since the start of the recording */
+    uint32_t tick;
+
+    /*! GLFW key name */
+    int16_t key_name;
+
+    /*! GLFW action */
+    uint8_t action;
+
+    /*! GLFW modifier bits */
+    uint8_t mods;
+};
+
+static_assert(sizeof(InputRecord) == 8, "Input records are written as is");
+
+
+/**
+ * \class InputRecorder
+ * \brief Write key changes to a compact binary stream.
+ *
+ * Records are buffered and written by blocks, the file is a InputRecordingHeader
+ * followed by InputRecord entries in tick order.
+ */
+class InputRecorder
+{
+public:
+
+    /*! Number of records buffered before a write */
+    static constexpr size_t BUFFER_SIZE = 4096;
+
+    /**
+     * \brief Destructor, close the file.
+     */
+    ~InputRecorder();
+
+    /**
+     * \brief Open the recording file.
+     *
+     * \param _filename     File name
+     * \param _tick_rate    Simulation tick rate
+     * \return False if error
+     */
+    bool open(const std::string& _filename, uint32_t _tick_rate);
+
+    /**
+     * \brief Record a key change.
+     *
+     * \param _tick         Tick since the start of the recording
+     * \param _key_name     GLFW key name
+     * \param _action       GLFW action
+     * \param _mods         GLFW modifier bits
+     */
+    void record(uint32_t _tick, int _key_name, int _action, int _mods);
+
+    /**
+     * \brief Write the buffered records and close the file.
+     */
+    void close();
+
+    /**
+     * \brief Get the number of recorded key changes.
+     *
+     * \return Record count
+     */
+    uint64_t getRecordCount() const;
+
+private:
+
+    /**
+     * \brief Write the buffered records.
+     */
+    void flush();
+
+    /*! Output file */
+    std::ofstream m_file;
+
+    /*! Records waiting to be written */
+    std::vector<InputRecord> m_buffer;
+
+    /*! Record count */
+    uint64_t m_record_count {0};
+};
+
+}//namespace ugly
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Core.h"
+#include "InputRecorder.h"
+
+namespace ugly
+{
+
+/**
+ * \class InputReplay
+ * \brief Replay source reading a recording written by InputRecorder.
+ */
+class InputReplay
+{
+public:
+
+    /**
+     * \brief Load a recording.
+     *
+     * \param _filename     File name
+     * \return False if error
+     */
+    bool load(const std::string& _filename);
+
+    /**
+     * \brief Get the next record due at a tick.
+     *
+     * \param _tick     Tick since the start of the replay
+     * \return Record, nullptr if no record is due
+     */
+    const InputRecord* next(uint32_t _tick);
+
+    /**
+     * \brief Check if every record was replayed.
+     *
+     * \return True if finished
+     */
+    bool isFinished() const;
+
+    /**
+     * \brief Get the simulation tick rate of the recorded session.
+     *
+     * \return Ticks per second
+     */
+    uint32_t getTickRate() const;
+
+    /**
+     * \brief Get the number of records.
+     *
+     * \return Record count
+     */
+    size_t getRecordCount() const;
+
+private:
+
+    /*! Records */
+    std::vector<InputRecord> m_records;
+
+    /*! Next record to replay */
+    size_t m_next {0};
+
+    /*! Recorded tick rate */
+    uint32_t m_tick_rate {0};
+};
+
+}//namespace ugly
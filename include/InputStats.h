@@ -22,4 +22,85 @@ namespace ugly
         released    /*! The button was released. */
     };
 
+
+    /*! Action identifier, hash of the button name */
+    using InputActionId = uint32_t;
+
+
+    /**
+     * \brief Hash a button name to its action identifier.
+     * The hash is computed at compile time for literal names (32 bits FNV-1a).
+     *
+     * \param _name     Button name
+     * \return Action identifier
+     */
+    constexpr InputActionId makeInputActionId(std::string_view _name)
+    {
+        uint32_t hash = 2166136261u;
+        for(char c : _name)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+
+    namespace input_literals
+    {
+        /**
+         * \brief Action identifier literal, "quit"_action.
+         */
+        constexpr InputActionId operator""_action(const char* _name, size_t _length)
+        {
+            return makeInputActionId(std::string_view(_name, _length));
+        }
+    }
+
+
+    /**
+     * \brief Handle of a button, index in the dense button array of the input manager.
+     */
+    struct InputButtonHandle
+    {
+        /*! Invalid index */
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        /*! Button index */
+        uint32_t index {INVALID_INDEX};
+
+        /**
+         * \brief Check if the handle refers to a button.
+         *
+         * \return True if valid
+         */
+        constexpr bool isValid() const
+        {
+            return index != INVALID_INDEX;
+        }
+    };
+
+
+    /**
+     * \brief Handle of an axis, index in the axis buffers of the input manager.
+     */
+    struct InputAxisHandle
+    {
+        /*! Invalid index */
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        /*! Axis index */
+        uint32_t index {INVALID_INDEX};
+
+        /**
+         * \brief Check if the handle refers to an axis.
+         *
+         * \return True if valid
+         */
+        constexpr bool isValid() const
+        {
+            return index != INVALID_INDEX;
+        }
+    };
+
 }//namespace ugly
\ No newline at end of file
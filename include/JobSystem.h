@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \class JobCounter
+ * \brief Counter of unfinished jobs.
+ *
+ * A counter is incremented when a job is scheduled with it and decremented when the job is done.
+ * Waiting on a counter with JobSystem::wait() executes other jobs instead of blocking.
+ */
+class JobCounter
+{
+public:
+
+    /**
+     * \brief Constructor.
+     */
+    JobCounter();
+
+    /**
+     * \brief Check if all the jobs are done.
+     *
+     * \return True if there is no unfinished job
+     */
+    bool isDone() const;
+
+private:
+
+    friend class JobSystem;
+
+    /*! Number of unfinished jobs */
+    std::atomic<uint32_t> m_value {0};
+};
+
+
+/**
+ * \class JobSystem
+ * \brief Work stealing job system.
+ *
+ * Each worker thread, and the thread which initialized the system, owns a lock-free job queue.
+ * A thread pushes and pops jobs at the bottom of its own queue and steals jobs from the top
+ * of the other queues when its queue is empty.
+ */
+class JobSystem
+{
+public:
+
+    /*! Job function */
+    using JobFunction = std::function<void()>;
+
+    /*! Range function, called with [begin, end) */
+    using RangeFunction = std::function<void(uint32_t, uint32_t)>;
+
+    /**
+     * \brief Constructor.
+     */
+    JobSystem();
+
+    /**
+     * \brief Destructor.
+     */
+    virtual ~JobSystem();
+
+    /**
+     * \brief Initialize the job system and start worker threads.
+     * The calling thread becomes a member of the job system.
+     *
+     * \param _worker_count Number of worker threads, 0 for one per core minus the calling thread
+     * \return False if error
+     */
+    bool initialize(unsigned int _worker_count = 0);
+
+    /**
+     * \brief Shutdown, stop worker threads.
+     */
+    void shutdown();
+
+    /**
+     * \brief Get the number of worker threads.
+     *
+     * \return Worker thread count
+     */
+    unsigned int getWorkerCount() const;
+
+    /**
+     * \brief Schedule a job.
+     * Jobs scheduled from a thread that is not part of the job system are executed immediately.
+     *
+     * \param _job      Job function
+     * \param _counter  Counter incremented until the job is done, can be null
+     */
+    void run(JobFunction _job, JobCounter* _counter = nullptr);
+
+    /**
+     * \brief Split a range in batches executed in parallel and wait for them.
+     *
+     * \param _count        Number of elements
+     * \param _batch_size   Number of elements per job
+     * \param _function     Function called for each batch
+     */
+    void parallelFor(uint32_t _count, uint32_t _batch_size, const RangeFunction& _function);
+
+    /**
+     * \brief Wait for the jobs of a counter.
+     * The calling thread executes pending jobs while waiting.
+     *
+     * \param _counter  Counter to wait
+     */
+    void wait(const JobCounter& _counter);
+
+private:
+
+    /**
+     * \brief Job.
+     */
+    struct Job
+    {
+        /*! Function */
+        JobFunction function;
+
+        /*! Counter, can be null */
+        JobCounter* counter {nullptr};
+    };
+
+    class JobQueue;
+
+    /**
+     * \brief Get a job from the queue of the calling thread or steal it from another queue.
+     *
+     * \return Job, null if no job is available
+     */
+    Job* getJob();
+
+    /**
+     * \brief Execute a pending job.
+     *
+     * \return False if no job was available
+     */
+    bool executeNextJob();
+
+    /**
+     * \brief Worker thread loop.
+     *
+     * \param _index    Queue index of the worker
+     */
+    void workerLoop(unsigned int _index);
+
+private:
+
+    /*! Job queues, index 0 belongs to the initializing thread */
+    std::vector<std::unique_ptr<JobQueue>> m_queues;
+
+    /*! Worker threads */
+    std::vector<std::thread> m_workers;
+
+    /*! Running flag */
+    std::atomic<bool> m_running {false};
+
+    /*! Number of jobs waiting in queues */
+    std::atomic<uint32_t> m_pending_jobs {0};
+
+    /*! Number of sleeping workers */
+    std::atomic<uint32_t> m_sleeping_workers {0};
+
+    /*! Sleep mutex */
+    std::mutex m_sleep_mutex;
+
+    /*! Sleep condition */
+    std::condition_variable m_sleep_condition;
+};
+
+}//namespace ugly
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \class StartupTimeline
+ * \brief Timeline of the engine startup phases.
+ *
+ * Phases may be recorded concurrently from several threads. Each phase is also
+ * recorded as a profiler zone, so it shows up in Chrome traces.
+ */
+class StartupTimeline
+{
+public:
+
+    /**
+     * \brief Recorded phase.
+     */
+    struct Phase
+    {
+        /*! Phase name, must be a literal or stay valid */
+        const char* name;
+
+        /*! Start time in nanoseconds since the timeline start */
+        uint64_t start;
+
+        /*! End time in nanoseconds since the timeline start, 0 while running */
+        uint64_t end;
+
+        /*! True if run by the thread which started the timeline */
+        bool main_thread;
+    };
+
+    /**
+     * \brief Constructor.
+     */
+    StartupTimeline();
+
+    /**
+     * \brief Discard the phases and restart the timeline from the calling thread.
+     */
+    void reset();
+
+    /**
+     * \brief Begin a phase.
+     *
+     * \param _name     Phase name, must be a literal or stay valid
+     * \return Phase index
+     */
+    size_t beginPhase(const char* _name);
+
+    /**
+     * \brief End a phase.
+     *
+     * \param _index    Phase index returned by beginPhase()
+     */
+    void endPhase(size_t _index);
+
+    /**
+     * \brief Mark the end of the startup.
+     */
+    void finish();
+
+    /**
+     * \brief Get a copy of the recorded phases.
+     *
+     * \return Phases in begin order
+     */
+    std::vector<Phase> getPhases() const;
+
+    /**
+     * \brief Get the startup duration.
+     *
+     * \return Nanoseconds from reset() to finish()
+     */
+    uint64_t getTotalTime() const;
+
+    /**
+     * \brief Log the timeline.
+     */
+    void dump() const;
+
+private:
+
+    /**
+     * \brief Get current time.
+     *
+     * \return Nanoseconds since the timeline start
+     */
+    uint64_t now() const;
+
+    /*! Timeline start */
+    std::chrono::steady_clock::time_point m_origin;
+
+    /*! Thread which started the timeline */
+    std::thread::id m_main_thread;
+
+    /*! Recorded phases */
+    std::vector<Phase> m_phases;
+
+    /*! Startup duration */
+    uint64_t m_total_time {0};
+
+    /*! Phases access */
+    mutable std::mutex m_mutex;
+};
+
+
+/**
+ * \class StartupPhase
+ * \brief Record a startup phase for the lifetime of the object.
+ */
+class StartupPhase
+{
+public:
+
+    /**
+     * \brief Constructor, begin the phase.
+     *
+     * \param _timeline     Timeline
+     * \param _name         Phase name, must be a literal or stay valid
+     */
+    StartupPhase(StartupTimeline* _timeline, const char* _name) :
+        m_timeline(_timeline),
+        m_index(_timeline->beginPhase(_name))
+    {
+    }
+
+    /**
+     * \brief Destructor, end the phase.
+     */
+    ~StartupPhase()
+    {
+        m_timeline->endPhase(m_index);
+    }
+
+    StartupPhase(const StartupPhase&) = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+
+    /*! Timeline */
+    StartupTimeline* m_timeline;
+
+    /*! Phase index */
+    size_t m_index;
+};
+
+}//namespace ugly
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Core.h"
+#include "JobSystem.h"
+
+namespace ugly
+{
+
+/**
+ * \class SystemScheduler
+ * \brief Per-frame task graph of application systems.
+ *
+ * Each system declares the shared data it reads and writes. Systems are ordered by
+ * registration: a system runs after every previously registered system it conflicts with
+ * (write/write or read/write on the same data). Independent systems run in parallel
+ * on the job system.
+ */
+class SystemScheduler
+{
+public:
+
+    /*! System function */
+    using SystemFunction = std::function<void()>;
+
+    /**
+     * \brief Constructor.
+     */
+    SystemScheduler();
+
+    /**
+     * \brief Register a system.
+     *
+     * \param _name     System name, must be unique
+     * \param _reads    Names of the data read by the system
+     * \param _writes   Names of the data written by the system
+     * \param _function System function
+     */
+    void addSystem(const std::string& _name, const std::vector<std::string>& _reads, const std::vector<std::string>& _writes, SystemFunction _function);
+
+    /**
+     * \brief Unregister a system.
+     *
+     * \param _name     System name
+     */
+    void removeSystem(const std::string& _name);
+
+    /**
+     * \brief Unregister all systems.
+     */
+    void clear();
+
+    /**
+     * \brief Run all systems and wait for them.
+     */
+    void update();
+
+    /**
+     * \brief Get the wall time of the last update.
+     *
+     * \return Update duration
+     */
+    std::chrono::nanoseconds getFrameTime() const;
+
+    /**
+     * \brief Get the sum of the system durations of the last update.
+     *
+     * \return Total work duration
+     */
+    std::chrono::nanoseconds getWorkTime() const;
+
+    /**
+     * \brief Get the length of the critical path of the last update.
+     * It is the minimal frame time with infinite parallelism.
+     *
+     * \return Critical path duration
+     */
+    std::chrono::nanoseconds getCriticalPathTime() const;
+
+    /**
+     * \brief Get the systems on the critical path of the last update, in execution order.
+     *
+     * \return System names
+     */
+    std::vector<std::string> getCriticalPath() const;
+
+    /**
+     * \brief Get the longest system on the critical path of the last update.
+     *
+     * \return System name, empty if there is no system
+     */
+    std::string getBottleneck() const;
+
+private:
+
+    /**
+     * \brief Registered system.
+     */
+    struct System
+    {
+        /*! Name */
+        std::string name;
+
+        /*! Name used by profiler zones */
+        const char* profile_name {nullptr};
+
+        /*! Read data ids, sorted */
+        std::vector<uint32_t> reads;
+
+        /*! Written data ids, sorted */
+        std::vector<uint32_t> writes;
+
+        /*! Function */
+        SystemFunction function;
+
+        /*! Systems which must run before this one */
+        std::vector<uint32_t> predecessors;
+
+        /*! Systems which must run after this one */
+        std::vector<uint32_t> successors;
+
+        /*! Start time of the last update, relative to the update start */
+        std::chrono::nanoseconds start {0};
+
+        /*! Duration of the last update */
+        std::chrono::nanoseconds duration {0};
+    };
+
+    /**
+     * \brief Get the id of a data name.
+     *
+     * \param _name     Data name
+     * \return Data id
+     */
+    uint32_t getDataId(const std::string& _name);
+
+    /**
+     * \brief Build the dependency graph.
+     */
+    void buildGraph();
+
+    /**
+     * \brief Execute a system and schedule its ready successors.
+     *
+     * \param _index    System index
+     */
+    void runSystem(uint32_t _index);
+
+    /**
+     * \brief Compute the critical path of the last update.
+     */
+    void computeCriticalPath();
+
+private:
+
+    /*! Systems in registration order */
+    std::vector<System> m_systems;
+
+    /*! Data name to id */
+    std::map<std::string, uint32_t> m_data_ids;
+
+    /*! Graph validity flag */
+    bool m_graph_dirty {true};
+
+    /*! Number of unfinished predecessors, per system */
+    std::unique_ptr<std::atomic<uint32_t>[]> m_remaining_predecessors;
+
+    /*! Counter of the running systems */
+    JobCounter m_counter;
+
+    /*! Start time of the current update */
+    std::chrono::steady_clock::time_point m_update_start;
+
+    /*! Wall time of the last update */
+    std::chrono::nanoseconds m_frame_time {0};
+
+    /*! Sum of the system durations of the last update */
+    std::chrono::nanoseconds m_work_time {0};
+
+    /*! Critical path duration of the last update */
+    std::chrono::nanoseconds m_critical_path_time {0};
+
+    /*! Critical path of the last update */
+    std::vector<uint32_t> m_critical_path;
+};
+
+}//namespace ugly
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+
+/**
+ * \class TlsfAllocator
+ * \brief Two level segregated fit allocator of ranges inside a memory block.
+ *
+ * It only manages offsets, the memory itself is owned by the caller. Free ranges are
+ * binned by size class, a first level per power of two and SL_COUNT linear subdivisions,
+ * with a bitmap per level so a fitting bin is found in constant time. Freed ranges are
+ * merged with their free neighbors.
+ *
+ * Allocations have a kind. When the granularity is larger than 1, allocations of
+ * different kinds never share a granularity page, as required by Vulkan between linear
+ * and optimal resources (bufferImageGranularity).
+ */
+class TlsfAllocator
+{
+public:
+
+    /*! Invalid node index */
+    static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+    /*! Number of bits of the second level index */
+    static constexpr uint32_t SL_BITS = 4;
+
+    /*! Number of second level bins per first level bin */
+    static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+
+    /*! Number of first level bins */
+    static constexpr uint32_t FL_COUNT = 64;
+
+    /**
+     * \brief Constructor.
+     *
+     * \param _size         Managed size
+     * \param _granularity  Page size separating allocations of different kinds, power of two
+     */
+    TlsfAllocator(uint64_t _size, uint64_t _granularity);
+
+    /**
+     * \brief Allocate a range.
+     *
+     * \param _size         Size
+     * \param _alignment    Alignment, power of two
+     * \param _kind         Allocation kind
+     * \param _offset       Allocated offset
+     * \return Node of the allocation, INVALID_NODE if no free range fits
+     */
+    uint32_t allocate(uint64_t _size, uint64_t _alignment, uint8_t _kind, uint64_t& _offset);
+
+    /**
+     * \brief Free a range.
+     *
+     * \param _node     Node returned by allocate()
+     */
+    void free(uint32_t _node);
+
+    /**
+     * \brief Get the managed size.
+     *
+     * \return Size
+     */
+    uint64_t getSize() const;
+
+    /**
+     * \brief Get the free size, padding excluded.
+     *
+     * \return Free size
+     */
+    uint64_t getFreeSize() const;
+
+    /**
+     * \brief Get the size of the largest free range.
+     *
+     * \return Largest free range size
+     */
+    uint64_t getLargestFreeRange() const;
+
+    /**
+     * \brief Get the number of free ranges.
+     *
+     * \return Free range count
+     */
+    uint32_t getFreeRangeCount() const;
+
+    /**
+     * \brief Get the number of allocations.
+     *
+     * \return Allocation count
+     */
+    uint32_t getAllocationCount() const;
+
+    /**
+     * \brief Check that there is no allocation.
+     *
+     * \return True if empty
+     */
+    bool isEmpty() const;
+
+private:
+
+    /**
+     * \brief Range of the block, free or allocated.
+     */
+    struct Node
+    {
+        /*! Offset */
+        uint64_t offset {0};
+
+        /*! Size */
+        uint64_t size {0};
+
+        /*! Previous range in address order */
+        uint32_t prev_physical {INVALID_NODE};
+
+        /*! Next range in address order */
+        uint32_t next_physical {INVALID_NODE};
+
+        /*! Previous range of the same bin, free ranges only */
+        uint32_t prev_free {INVALID_NODE};
+
+        /*! Next range of the same bin, free ranges only */
+        uint32_t next_free {INVALID_NODE};
+
+        /*! Free flag */
+        bool free {true};
+
+        /*! Allocation kind */
+        uint8_t kind {0};
+    };
+
+    /**
+     * \brief Get the bin of a size.
+     */
+    static void mapping(uint64_t _size, uint32_t& _fl, uint32_t& _sl);
+
+    /**
+     * \brief Find the first non empty bin at or after a bin.
+     *
+     * \return false if there is none
+     */
+    bool findBin(uint32_t& _fl, uint32_t& _sl) const;
+
+    /**
+     * \brief Check if an allocation fits in a free range.
+     *
+     * \param _node     Free range
+     * \param _begin    Allocation offset
+     * \param _end      End of the range used by the allocation, granularity padding included
+     * \return True if it fits
+     */
+    bool fit(uint32_t _node, uint64_t _size, uint64_t _alignment, uint8_t _kind, uint64_t& _begin, uint64_t& _end) const;
+
+    /**
+     * \brief Check if two offsets are on the same granularity page.
+     */
+    bool samePage(uint64_t _a, uint64_t _b) const;
+
+    /**
+     * \brief Get a node from the recycled ones or a new one.
+     */
+    uint32_t createNode();
+
+    /**
+     * \brief Insert a free range into its bin.
+     */
+    void insertFree(uint32_t _node);
+
+    /**
+     * \brief Remove a free range from its bin.
+     */
+    void removeFree(uint32_t _node);
+
+    /**
+     * \brief Split the beginning of a range into a new free range.
+     */
+    void splitFront(uint32_t _node, uint64_t _offset);
+
+    /**
+     * \brief Split the end of a range into a new free range.
+     */
+    void splitBack(uint32_t _node, uint64_t _end);
+
+    /**
+     * \brief Merge a range into its previous range and recycle it.
+     */
+    uint32_t mergeIntoPrevious(uint32_t _node);
+
+private:
+
+    /*! Managed size */
+    uint64_t m_size;
+
+    /*! Page size separating allocations of different kinds */
+    uint64_t m_granularity;
+
+    /*! Nodes */
+    std::vector<Node> m_nodes;
+
+    /*! Recycled nodes */
+    std::vector<uint32_t> m_recycled_nodes;
+
+    /*! First free range of each bin */
+    uint32_t m_bins[FL_COUNT][SL_COUNT];
+
+    /*! Bitmap of the first levels with a non empty bin */
+    uint64_t m_fl_bitmap {0};
+
+    /*! Bitmap of the non empty bins of each first level */
+    uint32_t m_sl_bitmap[FL_COUNT] {};
+
+    /*! Free size */
+    uint64_t m_free_size {0};
+
+    /*! Free range count */
+    uint32_t m_free_range_count {0};
+
+    /*! Allocation count */
+    uint32_t m_allocation_count {0};
+};
+
+}//namespace ugly
@@ -5,4 +5,24 @@
 #include "InputButton.h"
 #include "InputManager.h"
 #include "Application.h"
-#include "VulkanManager.h"
\ No newline at end of file
+#include "VulkanManager.h"
+#include "FramePacer.h"
+#include "JobSystem.h"
+#include "SystemScheduler.h"
+#include "Profiler.h"
+#include "World.h"
+#include "FrameArena.h"
+#include "AllocationTracker.h"
+#include "StartupTimeline.h"
+#include "InputEventQueue.h"
+#include "InputRecorder.h"
+#include "InputReplay.h"
+#include "InputLatencyTracker.h"
+#include "AsyncLogAppender.h"
+#include "BinaryLog.h"
+#include "ValidationMessageSink.h"
+#include "TlsfAllocator.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanOwnershipTransfer.h"
+#include "VulkanFrameRing.h"
\ No newline at end of file
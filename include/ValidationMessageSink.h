@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Core.h"
+
+#include <unordered_map>
+
+namespace ugly
+{
+    /**
+     * @brief Validation messages received during a frame.
+     */
+    struct ValidationFrameStats
+    {
+        /*! Error messages */
+        uint32_t errors {0};
+
+        /*! Warning messages */
+        uint32_t warnings {0};
+
+        /*! Info messages */
+        uint32_t infos {0};
+
+        /*! Messages not logged because of the rate limit */
+        uint32_t suppressed {0};
+    };
+
+
+    /**
+     * @brief Receiver of the Vulkan debug messenger messages.
+     *
+     * Messages are grouped by message id. The first occurrences of an id are logged, then
+     * at most one summary per interval reports the number of repeats, so a message emitted
+     * every draw call costs a map lookup instead of a log write.
+     * Vulkan errors are logged as errors, warnings as warnings and info as debug.
+     */
+    class ValidationMessageSink
+    {
+    public:
+
+        /**
+         * @brief Constructor.
+         */
+        ValidationMessageSink();
+
+        /**
+         * @brief Debug messenger callback, the user data is the sink.
+         */
+        static VKAPI_ATTR VkBool32 VKAPI_CALL callback(
+            VkDebugUtilsMessageSeverityFlagBitsEXT _severity,
+            VkDebugUtilsMessageTypeFlagsEXT _type,
+            const VkDebugUtilsMessengerCallbackDataEXT* _data,
+            void* _user_data);
+
+        /**
+         * @brief Handle a message.
+         *
+         * @param _severity Vulkan severity
+         * @param _data Message data
+         */
+        void receive(VkDebugUtilsMessageSeverityFlagBitsEXT _severity, const VkDebugUtilsMessengerCallbackDataEXT* _data);
+
+        /**
+         * @brief Set the rate limit of each message id.
+         *
+         * @param _burst Number of occurrences logged in full
+         * @param _interval Minimal time between two summaries of the repeats
+         */
+        void setRateLimit(uint32_t _burst, std::chrono::milliseconds _interval);
+
+        /**
+         * @brief Close the frame statistics.
+         */
+        void endFrame();
+
+        /**
+         * @brief Get the statistics of the last frame.
+         *
+         * @return Frame statistics
+         */
+        ValidationFrameStats getFrameStats() const;
+
+        /**
+         * @brief Get the total number of messages.
+         *
+         * @return Message count
+         */
+        uint64_t getMessageCount() const;
+
+        /**
+         * @brief Log the message ids with their counts.
+         */
+        void logReport();
+
+    private:
+
+        /**
+         * @brief Occurrences of a message id.
+         */
+        struct Message
+        {
+            /*! Message id name */
+            std::string name;
+
+            /*! Log severity */
+            plog::Severity severity {plog::none};
+
+            /*! Occurrence count */
+            uint64_t count {0};
+
+            /*! Occurrences since the last log */
+            uint64_t repeats {0};
+
+            /*! Time of the last log */
+            std::chrono::steady_clock::time_point last_log;
+        };
+
+        /**
+         * @brief Get the key of a message.
+         *
+         * @param _data Message data
+         * @return Message id, or a hash of the name when the layer does not provide one
+         */
+        static int64_t getKey(const VkDebugUtilsMessengerCallbackDataEXT* _data);
+
+    private:
+
+        /*! Messages by key */
+        std::unordered_map<int64_t, Message> m_messages;
+
+        /*! Messages mutex, the callback runs on any thread calling Vulkan */
+        std::mutex m_mutex;
+
+        /*! Occurrences logged in full per id */
+        uint32_t m_burst {5};
+
+        /*! Minimal time between two summaries */
+        std::chrono::milliseconds m_interval {1000};
+
+        /*! Counters of the current frame */
+        std::atomic<uint32_t> m_errors {0};
+        std::atomic<uint32_t> m_warnings {0};
+        std::atomic<uint32_t> m_infos {0};
+        std::atomic<uint32_t> m_suppressed {0};
+
+        /*! Total message count */
+        std::atomic<uint64_t> m_message_count {0};
+
+        /*! Statistics of the last frame */
+        ValidationFrameStats m_frame_stats;
+    };
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+    /**
+     * @brief GPU resources of a frame in flight.
+     */
+    struct VulkanFrame
+    {
+        /*! Command pool, reset at once when the slot is reused */
+        VkCommandPool command_pool {VK_NULL_HANDLE};
+
+        /*! Primary command buffer, recording between beginFrame() and endFrame() */
+        VkCommandBuffer command_buffer {VK_NULL_HANDLE};
+
+        /*! Signaled when the GPU finished the frame */
+        VkFence fence {VK_NULL_HANDLE};
+
+        /*! Signaled when the swapchain image is acquired */
+        VkSemaphore acquire_semaphore {VK_NULL_HANDLE};
+
+        /*! Signaled when the frame is rendered, waited by the present */
+        VkSemaphore present_semaphore {VK_NULL_HANDLE};
+
+        /*! Frame number using the slot */
+        uint64_t frame_number {0};
+    };
+
+
+    /**
+     * @brief Ring of frames in flight.
+     *
+     * Each slot owns a command pool, a fence and the acquire and present semaphores. The CPU
+     * records frame N + 1 while the GPU executes frame N, it only waits when it is a full ring
+     * ahead of the GPU, at the fence of the slot it reuses. The command pool of the slot is
+     * then reset wholesale, which is cheaper than resetting each command buffer.
+     */
+    class VulkanFrameRing
+    {
+    public:
+
+        /*! Default number of frames in flight */
+        static constexpr uint32_t DEFAULT_FRAME_COUNT = 2;
+
+        /**
+         * @brief Constructor.
+         */
+        VulkanFrameRing();
+
+        /**
+         * @brief Destructor.
+         */
+        virtual ~VulkanFrameRing();
+
+        /**
+         * @brief Create the frame slots.
+         *
+         * @param _device Logical device
+         * @param _queue Queue of the submissions
+         * @param _queue_family Family of the queue
+         * @param _frame_count Number of frames in flight
+         * @return false if error
+         */
+        bool initialize(VkDevice _device, VkQueue _queue, uint32_t _queue_family, uint32_t _frame_count);
+
+        /**
+         * @brief Wait for the frames in flight and destroy the slots.
+         */
+        void shutdown();
+
+        /**
+         * @brief Wait for the next slot to be free, reset it and begin its command buffer.
+         *
+         * @return false if error
+         */
+        bool beginFrame();
+
+        /**
+         * @brief End the command buffer of the current frame and submit it.
+         *
+         * @return false if error
+         */
+        bool endFrame();
+
+        /**
+         * @brief Get the current frame, valid between beginFrame() and endFrame().
+         *
+         * @return Current frame
+         */
+        VulkanFrame* getCurrentFrame();
+
+        /**
+         * @brief Get the number of frames in flight.
+         *
+         * @return Frame count
+         */
+        uint32_t getFrameCount() const;
+
+        /**
+         * @brief Get the time the last beginFrame() waited for the GPU.
+         *
+         * @return Wait duration
+         */
+        std::chrono::nanoseconds getLastWait() const;
+
+    private:
+
+        /*! Logical device */
+        VkDevice m_device {VK_NULL_HANDLE};
+
+        /*! Queue of the submissions */
+        VkQueue m_queue {VK_NULL_HANDLE};
+
+        /*! Frame slots */
+        std::vector<VulkanFrame> m_frames;
+
+        /*! Current slot */
+        uint32_t m_current {0};
+
+        /*! Number of the next frame */
+        uint64_t m_frame_number {0};
+
+        /*! A frame is recording */
+        bool m_recording {false};
+
+        /*! Last fence wait duration */
+        std::chrono::nanoseconds m_last_wait {0};
+    };
+}
@@ -1,9 +1,25 @@
 #pragma once
 
 #include "Core.h"
+#include "ValidationMessageSink.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanOwnershipTransfer.h"
+#include "VulkanFrameRing.h"
 
 namespace ugly
 {
+    /**
+     * @brief Queue types.
+     */
+    enum class VulkanQueueType
+    {
+        graphics,       /*! Graphics queue. */
+        compute,        /*! Async compute queue, the graphics queue without a compute family. */
+        transfer        /*! Transfer queue, the graphics queue without a transfer family. */
+    };
+
+
     /**
      * @brief Vulkan manager.
      */
@@ -21,6 +37,13 @@ namespace ugly
          */
         virtual ~VulkanManager();
 
+        /**
+         * @brief Set the number of frames in flight, before the initialization.
+         * 
+         * @param _count Number of frames in flight
+         */
+        void setFramesInFlight(uint32_t _count);
+
         /**
          * @brief Initialize.
          * 
@@ -33,6 +56,68 @@ namespace ugly
          */
         void shutdown();
 
+        /**
+         * @brief Get the validation message sink.
+         * 
+         * @return Validation message sink
+         */
+        ValidationMessageSink* getValidationSink();
+
+        /**
+         * @brief Get the device memory allocator.
+         * 
+         * @return Device memory allocator
+         */
+        VulkanMemoryAllocator* getMemoryAllocator();
+
+        /**
+         * @brief Get the pipeline cache.
+         * 
+         * @return Pipeline cache
+         */
+        VulkanPipelineCache* getPipelineCache();
+
+        /**
+         * @brief Get the frames in flight ring.
+         * 
+         * @return Frame ring
+         */
+        VulkanFrameRing* getFrameRing();
+
+        /**
+         * @brief Get a queue.
+         * Several types may return the same queue, submissions must then be serialized.
+         * 
+         * @param _type Queue type
+         * @return Queue
+         */
+        VkQueue getQueue(VulkanQueueType _type) const;
+
+        /**
+         * @brief Get the family of a queue.
+         * 
+         * @param _type Queue type
+         * @return Queue family index
+         */
+        uint32_t getQueueFamily(VulkanQueueType _type) const;
+
+        /**
+         * @brief Check if a queue is not the graphics queue.
+         * 
+         * @param _type Queue type
+         * @return true if the queue runs in parallel with the graphics queue
+         */
+        bool hasDedicatedQueue(VulkanQueueType _type) const;
+
+        /**
+         * @brief Get the ownership transfer of an exclusive resource between two queues.
+         * 
+         * @param _src Queue releasing the resource
+         * @param _dst Queue acquiring the resource
+         * @return Ownership transfer
+         */
+        VulkanOwnershipTransfer getOwnershipTransfer(VulkanQueueType _src, VulkanQueueType _dst) const;
+
     private:
 
         /**
@@ -92,6 +177,12 @@ namespace ugly
         {
             std::optional<uint32_t> graphicsFamily;
 
+            /*! Compute family without graphics */
+            std::optional<uint32_t> computeFamily;
+
+            /*! Transfer family without graphics, the compute family if there is no transfer only family */
+            std::optional<uint32_t> transferFamily;
+
             bool isComplete() 
             {
                 return graphicsFamily.has_value();
@@ -126,18 +217,44 @@ namespace ugly
         #endif
 
         /*! Vulkan instance */
-        VkInstance m_instance;
+        VkInstance m_instance {VK_NULL_HANDLE};
 
         /*! Debug callback */
-        VkDebugUtilsMessengerEXT m_callback;
+        VkDebugUtilsMessengerEXT m_callback {VK_NULL_HANDLE};
+
+        /*! Validation message sink, user data of the debug callback */
+        ValidationMessageSink m_validation_sink;
 
         /*! Physical device */
         VkPhysicalDevice m_physical_device {VK_NULL_HANDLE};
 
         /*! Logical device */ 
-        VkDevice m_device;
+        VkDevice m_device {VK_NULL_HANDLE};
 
         /*! Graphic queue */
-        VkQueue m_graphics_queue;
+        VkQueue m_graphics_queue {VK_NULL_HANDLE};
+
+        /*! Compute queue */
+        VkQueue m_compute_queue {VK_NULL_HANDLE};
+
+        /*! Transfer queue */
+        VkQueue m_transfer_queue {VK_NULL_HANDLE};
+
+        /*! Queue families, with the fallbacks to the graphics family */
+        uint32_t m_graphics_family {VK_QUEUE_FAMILY_IGNORED};
+        uint32_t m_compute_family {VK_QUEUE_FAMILY_IGNORED};
+        uint32_t m_transfer_family {VK_QUEUE_FAMILY_IGNORED};
+
+        /*! Device memory allocator */
+        VulkanMemoryAllocator m_memory_allocator;
+
+        /*! Pipeline cache, persisted in PIPELINE_CACHE_FILENAME */
+        VulkanPipelineCache m_pipeline_cache;
+
+        /*! Number of frames in flight */
+        uint32_t m_frames_in_flight {VulkanFrameRing::DEFAULT_FRAME_COUNT};
+
+        /*! Frames in flight, submitted on the graphics queue */
+        VulkanFrameRing m_frame_ring;
     };
 }
\ No newline at end of file
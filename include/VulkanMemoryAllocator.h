@@ -0,0 +1,471 @@
+#pragma once
+
+#include "Core.h"
+#include "TlsfAllocator.h"
+
+namespace ugly
+{
+    /**
+     * @brief Intended usage of an allocation, it selects the memory type.
+     */
+    enum class VulkanMemoryUsage
+    {
+        gpu_only,       /*! Device local, not host visible when possible. */
+        upload,         /*! Host visible and coherent, written by the CPU. */
+        readback        /*! Host visible, cached when possible, read by the CPU. */
+    };
+
+
+    /**
+     * @brief Kind of resource bound to an allocation.
+     * Linear and optimal resources must not share a bufferImageGranularity page.
+     */
+    enum class VulkanResourceKind : uint8_t
+    {
+        linear,         /*! Buffers and linear images. */
+        optimal         /*! Optimal tiling images. */
+    };
+
+
+    /**
+     * @brief Strategy used for an allocation.
+     */
+    enum class VulkanAllocationStrategy : uint8_t
+    {
+        general,        /*! TLSF range of a shared block. */
+        dedicated,      /*! Own device memory, for large resources. */
+        linear,         /*! Bump allocation released by VulkanMemoryAllocator::resetLinear(). */
+        pool            /*! Slot of a pool of same size resources. */
+    };
+
+
+    /**
+     * @brief Sub-allocated device memory range.
+     */
+    struct VulkanAllocation
+    {
+        /*! Device memory */
+        VkDeviceMemory memory {VK_NULL_HANDLE};
+
+        /*! Offset in the device memory */
+        VkDeviceSize offset {0};
+
+        /*! Size */
+        VkDeviceSize size {0};
+
+        /*! Host pointer of the range, nullptr if the memory is not host visible */
+        void* mapped {nullptr};
+
+        /*! Memory type index */
+        uint32_t memory_type {UINT32_MAX};
+
+        /*! Strategy */
+        VulkanAllocationStrategy strategy {VulkanAllocationStrategy::general};
+
+        /*! Block index, internal */
+        uint32_t block {UINT32_MAX};
+
+        /*! TLSF node or pool slot, internal */
+        uint32_t node {UINT32_MAX};
+
+        /*! Pool index, internal */
+        uint32_t pool {UINT32_MAX};
+
+        /**
+         * @brief Check if the allocation is valid.
+         *
+         * @return true if valid
+         */
+        bool isValid() const
+        {
+            return memory != VK_NULL_HANDLE;
+        }
+    };
+
+
+    /**
+     * @brief Memory statistics.
+     */
+    struct VulkanMemoryStats
+    {
+        /*! Number of device memory blocks */
+        uint32_t block_count {0};
+
+        /*! Number of vkAllocateMemory allocations alive */
+        uint32_t device_allocation_count {0};
+
+        /*! Number of sub-allocations alive */
+        uint32_t allocation_count {0};
+
+        /*! Size of the device memory blocks */
+        VkDeviceSize block_bytes {0};
+
+        /*! Size of the sub-allocations */
+        VkDeviceSize used_bytes {0};
+
+        /*! Free size of the TLSF blocks */
+        VkDeviceSize free_bytes {0};
+
+        /*! Free ranges of the TLSF blocks */
+        uint32_t free_range_count {0};
+
+        /*! Largest free range of the TLSF blocks */
+        VkDeviceSize largest_free_range {0};
+
+        /*! 1 - largest free range / free size, 0 when the free memory is contiguous */
+        float fragmentation {0.f};
+    };
+
+
+    /**
+     * @brief Device memory sub-allocator.
+     *
+     * Memory types are chosen from the memory properties of the physical device according to
+     * the usage. Allocations are sub-allocated with a TLSF allocator in large blocks, one
+     * vkAllocateMemory per block, which keeps the device allocation count far below
+     * maxMemoryAllocationCount. Resources larger than half a block get their own memory.
+     * Host visible blocks are persistently mapped.
+     *
+     * Transient resources can use the linear strategy: a bump allocator per memory type
+     * released all at once by resetLinear(). Resources of a single size can use a pool.
+     *
+     * Alignments are respected, nonCoherentAtomSize included for non coherent types, and
+     * linear and optimal resources never share a bufferImageGranularity page.
+     * All the methods are thread safe.
+     */
+    class VulkanMemoryAllocator
+    {
+    public:
+
+        /*! Default block size */
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+        /**
+         * @brief Constructor.
+         */
+        VulkanMemoryAllocator();
+
+        /**
+         * @brief Destructor.
+         */
+        virtual ~VulkanMemoryAllocator();
+
+        /**
+         * @brief Initialize.
+         *
+         * @param _physical_device Physical device
+         * @param _device Logical device
+         * @param _block_size Size of the blocks
+         * @return false if error
+         */
+        bool initialize(VkPhysicalDevice _physical_device, VkDevice _device, VkDeviceSize _block_size = DEFAULT_BLOCK_SIZE);
+
+        /**
+         * @brief Shutdown, free all the device memory.
+         */
+        void shutdown();
+
+        /**
+         * @brief Find the best memory type for a usage.
+         *
+         * @param _type_bits Allowed memory types, from VkMemoryRequirements
+         * @param _usage Usage
+         * @return Memory type index, UINT32_MAX if none is allowed
+         */
+        uint32_t findMemoryType(uint32_t _type_bits, VulkanMemoryUsage _usage) const;
+
+        /**
+         * @brief Allocate memory in a block, or dedicated memory for large resources.
+         *
+         * @param _requirements Memory requirements
+         * @param _usage Usage
+         * @param _kind Resource kind
+         * @param _allocation Allocation
+         * @return false if error
+         */
+        bool allocate(const VkMemoryRequirements& _requirements, VulkanMemoryUsage _usage, VulkanResourceKind _kind, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Allocate transient memory, released by resetLinear().
+         *
+         * @param _requirements Memory requirements
+         * @param _usage Usage
+         * @param _kind Resource kind
+         * @param _allocation Allocation
+         * @return false if error
+         */
+        bool allocateLinear(const VkMemoryRequirements& _requirements, VulkanMemoryUsage _usage, VulkanResourceKind _kind, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Release all the linear allocations, their memory is kept for the next ones.
+         */
+        void resetLinear();
+
+        /**
+         * @brief Create a pool of same size resources.
+         *
+         * @param _requirements Memory requirements of one resource
+         * @param _usage Usage
+         * @param _chunk_count Resources per device memory chunk
+         * @return Pool index, UINT32_MAX if error
+         */
+        uint32_t createPool(const VkMemoryRequirements& _requirements, VulkanMemoryUsage _usage, uint32_t _chunk_count);
+
+        /**
+         * @brief Destroy a pool and its memory, its allocations must be freed.
+         *
+         * @param _pool Pool index
+         */
+        void destroyPool(uint32_t _pool);
+
+        /**
+         * @brief Allocate a slot of a pool.
+         *
+         * @param _pool Pool index
+         * @param _allocation Allocation
+         * @return false if error
+         */
+        bool allocateFromPool(uint32_t _pool, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Free an allocation, linear allocations are only released by resetLinear().
+         *
+         * @param _allocation Allocation, reset
+         */
+        void free(VulkanAllocation& _allocation);
+
+        /**
+         * @brief Flush host writes of a non coherent allocation.
+         *
+         * @param _allocation Allocation
+         */
+        void flush(const VulkanAllocation& _allocation);
+
+        /**
+         * @brief Invalidate a non coherent allocation before host reads.
+         *
+         * @param _allocation Allocation
+         */
+        void invalidate(const VulkanAllocation& _allocation);
+
+        /**
+         * @brief Create a buffer and bind it to a new allocation.
+         *
+         * @param _create_info Buffer create info
+         * @param _usage Usage
+         * @param _buffer Buffer
+         * @param _allocation Allocation
+         * @return false if error
+         */
+        bool createBuffer(const VkBufferCreateInfo& _create_info, VulkanMemoryUsage _usage, VkBuffer& _buffer, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Destroy a buffer and free its allocation.
+         *
+         * @param _buffer Buffer
+         * @param _allocation Allocation
+         */
+        void destroyBuffer(VkBuffer& _buffer, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Create an image and bind it to a new allocation.
+         *
+         * @param _create_info Image create info
+         * @param _usage Usage
+         * @param _image Image
+         * @param _allocation Allocation
+         * @return false if error
+         */
+        bool createImage(const VkImageCreateInfo& _create_info, VulkanMemoryUsage _usage, VkImage& _image, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Destroy an image and free its allocation.
+         *
+         * @param _image Image
+         * @param _allocation Allocation
+         */
+        void destroyImage(VkImage& _image, VulkanAllocation& _allocation);
+
+        /**
+         * @brief Get the memory statistics.
+         *
+         * @return Statistics
+         */
+        VulkanMemoryStats getStats();
+
+        /**
+         * @brief Log the memory statistics.
+         */
+        void logStats();
+
+        /**
+         * @brief Get the page size separating linear and optimal resources.
+         *
+         * @return bufferImageGranularity
+         */
+        VkDeviceSize getGranularity() const;
+
+    private:
+
+        /**
+         * @brief Device memory allocation.
+         */
+        struct Block
+        {
+            /*! Device memory */
+            VkDeviceMemory memory {VK_NULL_HANDLE};
+
+            /*! Size */
+            VkDeviceSize size {0};
+
+            /*! Memory type index */
+            uint32_t memory_type {UINT32_MAX};
+
+            /*! Persistent mapping, nullptr if not host visible */
+            uint8_t* mapped {nullptr};
+
+            /*! Range allocator of the general blocks */
+            std::unique_ptr<TlsfAllocator> tlsf;
+        };
+
+        /**
+         * @brief Bump allocator of a memory type.
+         */
+        struct LinearArena
+        {
+            /*! Chunk blocks */
+            std::vector<uint32_t> chunks;
+
+            /*! Current chunk */
+            size_t current {0};
+
+            /*! Offset in the current chunk */
+            VkDeviceSize offset {0};
+
+            /*! Kind of the last allocation of the current chunk */
+            VulkanResourceKind last_kind {VulkanResourceKind::linear};
+
+            /*! Allocated size since the last reset */
+            VkDeviceSize used {0};
+        };
+
+        /**
+         * @brief Pool of same size resources.
+         */
+        struct Pool
+        {
+            /*! Memory type index */
+            uint32_t memory_type {UINT32_MAX};
+
+            /*! Size of a slot */
+            VkDeviceSize size {0};
+
+            /*! Distance between two slots */
+            VkDeviceSize stride {0};
+
+            /*! Slots per chunk */
+            uint32_t chunk_count {0};
+
+            /*! Chunk blocks */
+            std::vector<uint32_t> chunks;
+
+            /*! Free slots, chunk index * chunk_count + slot in the chunk */
+            std::vector<uint32_t> free_slots;
+
+            /*! Allocated slots */
+            uint32_t allocation_count {0};
+        };
+
+        /**
+         * @brief Allocate a device memory block.
+         *
+         * @param _memory_type Memory type index
+         * @param _size Size
+         * @param _general Create a TLSF allocator for the block
+         * @return Block index, UINT32_MAX if error
+         */
+        uint32_t createBlock(uint32_t _memory_type, VkDeviceSize _size, bool _general);
+
+        /**
+         * @brief Free a device memory block.
+         *
+         * @param _block Block index
+         */
+        void destroyBlock(uint32_t _block);
+
+        /**
+         * @brief Get the alignment and size of an allocation in a memory type.
+         *
+         * @param _memory_type Memory type index
+         * @param _requirements Memory requirements
+         * @param _alignment Alignment
+         * @param _size Size
+         */
+        void getAlignedSize(uint32_t _memory_type, const VkMemoryRequirements& _requirements, VkDeviceSize& _alignment, VkDeviceSize& _size) const;
+
+        /**
+         * @brief Fill an allocation from a block range.
+         */
+        void setAllocation(VulkanAllocation& _allocation, VulkanAllocationStrategy _strategy, uint32_t _block, VkDeviceSize _offset, VkDeviceSize _size);
+
+        /**
+         * @brief Get the non coherent atom range of an allocation.
+         */
+        VkMappedMemoryRange getMappedRange(const VulkanAllocation& _allocation) const;
+
+        /**
+         * @brief Check if a memory type is host visible but not coherent.
+         */
+        bool isNonCoherent(uint32_t _memory_type) const;
+
+    private:
+
+        /*! Physical device */
+        VkPhysicalDevice m_physical_device {VK_NULL_HANDLE};
+
+        /*! Logical device */
+        VkDevice m_device {VK_NULL_HANDLE};
+
+        /*! Memory properties */
+        VkPhysicalDeviceMemoryProperties m_memory_properties {};
+
+        /*! Block size */
+        VkDeviceSize m_block_size {DEFAULT_BLOCK_SIZE};
+
+        /*! bufferImageGranularity limit */
+        VkDeviceSize m_granularity {1};
+
+        /*! nonCoherentAtomSize limit */
+        VkDeviceSize m_non_coherent_atom_size {1};
+
+        /*! maxMemoryAllocationCount limit */
+        uint32_t m_max_allocation_count {UINT32_MAX};
+
+        /*! Blocks, destroyed blocks have no memory */
+        std::vector<Block> m_blocks;
+
+        /*! Indices of the destroyed blocks */
+        std::vector<uint32_t> m_free_blocks;
+
+        /*! General blocks of each memory type */
+        std::vector<uint32_t> m_general_blocks[VK_MAX_MEMORY_TYPES];
+
+        /*! Linear arena of each memory type */
+        LinearArena m_linear_arenas[VK_MAX_MEMORY_TYPES];
+
+        /*! Pools, destroyed pools have no memory type */
+        std::vector<Pool> m_pools;
+
+        /*! Number of device memory allocations */
+        uint32_t m_device_allocation_count {0};
+
+        /*! Number of sub-allocations, linear ones excluded */
+        uint32_t m_allocation_count {0};
+
+        /*! Size of the sub-allocations, linear ones excluded */
+        VkDeviceSize m_used_bytes {0};
+
+        /*! Mutex */
+        std::mutex m_mutex;
+    };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+    /**
+     * @brief Pipeline stages and accesses of one side of a barrier.
+     */
+    struct VulkanAccess
+    {
+        /*! Pipeline stages */
+        VkPipelineStageFlags stage {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+
+        /*! Memory accesses */
+        VkAccessFlags access {0};
+    };
+
+
+    /**
+     * @brief Transfer of an exclusive resource between two queue families.
+     *
+     * A resource created with VK_SHARING_MODE_EXCLUSIVE must be released by a barrier on
+     * the source queue then acquired by a matching barrier on the destination queue, the
+     * acquiring submission waiting on a semaphore signaled by the releasing one. Both sides
+     * are given the same arguments. When the families are the same, the release records a
+     * regular barrier and the acquire records nothing, so callers do not need to care
+     * whether the queues fell back to the graphics queue.
+     */
+    class VulkanOwnershipTransfer
+    {
+    public:
+
+        /**
+         * @brief Constructor.
+         *
+         * @param _src_family Queue family releasing the resource
+         * @param _dst_family Queue family acquiring the resource
+         */
+        VulkanOwnershipTransfer(uint32_t _src_family, uint32_t _dst_family);
+
+        /**
+         * @brief Check if the families differ, a release and an acquire are needed.
+         *
+         * @return true if the ownership changes
+         */
+        bool isRequired() const;
+
+        /**
+         * @brief Record the release of a buffer range on the source queue.
+         *
+         * @param _command_buffer Command buffer of the source queue
+         * @param _buffer Buffer
+         * @param _offset Range offset
+         * @param _size Range size, VK_WHOLE_SIZE for the end of the buffer
+         * @param _src Last use on the source queue
+         * @param _dst First use on the destination queue
+         */
+        void releaseBuffer(VkCommandBuffer _command_buffer, VkBuffer _buffer, VkDeviceSize _offset, VkDeviceSize _size, const VulkanAccess& _src, const VulkanAccess& _dst) const;
+
+        /**
+         * @brief Record the acquire of a buffer range on the destination queue.
+         *
+         * @param _command_buffer Command buffer of the destination queue
+         * @param _buffer Buffer
+         * @param _offset Range offset
+         * @param _size Range size, VK_WHOLE_SIZE for the end of the buffer
+         * @param _src Last use on the source queue
+         * @param _dst First use on the destination queue
+         */
+        void acquireBuffer(VkCommandBuffer _command_buffer, VkBuffer _buffer, VkDeviceSize _offset, VkDeviceSize _size, const VulkanAccess& _src, const VulkanAccess& _dst) const;
+
+        /**
+         * @brief Record the release of an image on the source queue.
+         *
+         * @param _command_buffer Command buffer of the source queue
+         * @param _image Image
+         * @param _range Subresource range
+         * @param _old_layout Layout on the source queue
+         * @param _new_layout Layout on the destination queue
+         * @param _src Last use on the source queue
+         * @param _dst First use on the destination queue
+         */
+        void releaseImage(VkCommandBuffer _command_buffer, VkImage _image, const VkImageSubresourceRange& _range, VkImageLayout _old_layout, VkImageLayout _new_layout, const VulkanAccess& _src, const VulkanAccess& _dst) const;
+
+        /**
+         * @brief Record the acquire of an image on the destination queue.
+         *
+         * @param _command_buffer Command buffer of the destination queue
+         * @param _image Image
+         * @param _range Subresource range
+         * @param _old_layout Layout on the source queue
+         * @param _new_layout Layout on the destination queue
+         * @param _src Last use on the source queue
+         * @param _dst First use on the destination queue
+         */
+        void acquireImage(VkCommandBuffer _command_buffer, VkImage _image, const VkImageSubresourceRange& _range, VkImageLayout _old_layout, VkImageLayout _new_layout, const VulkanAccess& _src, const VulkanAccess& _dst) const;
+
+    private:
+
+        /*! Queue family releasing the resource */
+        uint32_t m_src_family;
+
+        /*! Queue family acquiring the resource */
+        uint32_t m_dst_family;
+    };
+}
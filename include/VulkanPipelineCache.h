@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Core.h"
+
+namespace ugly
+{
+    /**
+     * @brief Pipeline cache persisted on disk between runs.
+     *
+     * The file is the data returned by vkGetPipelineCacheData. At load its header is checked
+     * against the vendor id, device id and pipelineCacheUUID of the physical device, a file
+     * written by another device or driver is ignored and the cache starts empty. The file is
+     * written to a temporary file then renamed, so a crash never leaves a truncated cache.
+     */
+    class VulkanPipelineCache
+    {
+    public:
+
+        /**
+         * @brief Constructor.
+         */
+        VulkanPipelineCache();
+
+        /**
+         * @brief Destructor.
+         */
+        virtual ~VulkanPipelineCache();
+
+        /**
+         * @brief Create the pipeline cache from the file if it is valid for the device.
+         *
+         * @param _physical_device Physical device
+         * @param _device Logical device
+         * @param _filename Cache file
+         * @return false if the pipeline cache cannot be created
+         */
+        bool load(VkPhysicalDevice _physical_device, VkDevice _device, const std::string& _filename);
+
+        /**
+         * @brief Write the pipeline cache to the file if it changed since the load.
+         *
+         * @return false if error
+         */
+        bool save();
+
+        /**
+         * @brief Destroy the pipeline cache.
+         */
+        void destroy();
+
+        /**
+         * @brief Get the pipeline cache, to pass to the pipeline creations.
+         *
+         * @return Pipeline cache
+         */
+        VkPipelineCache getCache() const;
+
+        /**
+         * @brief Check if the cache was loaded from a valid file.
+         *
+         * @return true on a cache hit
+         */
+        bool isWarm() const;
+
+        /**
+         * @brief Record the duration of a pipeline creation using the cache.
+         *
+         * @param _duration Creation duration
+         */
+        void recordPipelineCreation(std::chrono::nanoseconds _duration);
+
+        /**
+         * @brief Log the load and pipeline creation timings.
+         */
+        void logReport();
+
+    private:
+
+        /**
+         * @brief Check that cache data was written by the device.
+         *
+         * @param _data Cache data
+         * @param _properties Physical device properties
+         * @param _reason Reason of the rejection
+         * @return true if valid
+         */
+        static bool validateHeader(const std::vector<uint8_t>& _data, const VkPhysicalDeviceProperties& _properties, std::string& _reason);
+
+        /**
+         * @brief Write a file through a temporary file and a rename.
+         *
+         * @param _filename File
+         * @param _data Content
+         * @return false if error
+         */
+        static bool writeFileAtomically(const std::string& _filename, const std::vector<uint8_t>& _data);
+
+    private:
+
+        /*! Logical device */
+        VkDevice m_device {VK_NULL_HANDLE};
+
+        /*! Pipeline cache */
+        VkPipelineCache m_cache {VK_NULL_HANDLE};
+
+        /*! Cache file */
+        std::string m_filename;
+
+        /*! Cache loaded from a valid file */
+        bool m_warm {false};
+
+        /*! Size of the loaded data */
+        size_t m_loaded_size {0};
+
+        /*! Hash of the loaded data, the file is not rewritten if the data did not change */
+        size_t m_loaded_hash {0};
+
+        /*! Load duration */
+        std::chrono::nanoseconds m_load_time {0};
+
+        /*! Pipelines created with the cache */
+        std::atomic<uint32_t> m_pipeline_count {0};
+
+        /*! Total pipeline creation duration in nanoseconds */
+        std::atomic<int64_t> m_creation_time {0};
+    };
+}
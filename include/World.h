@@ -0,0 +1,501 @@
+#pragma once
+
+#include "Core.h"
+#include "JobSystem.h"
+
+namespace ugly
+{
+
+/**
+ * \brief Entity handle.
+ *
+ * The generation changes when the entity slot is reused, so a handle to a destroyed
+ * entity never aliases a new one.
+ */
+struct Entity
+{
+    /*! Slot index */
+    uint32_t index {0xFFFFFFFF};
+
+    /*! Slot generation */
+    uint32_t generation {0};
+
+    bool operator==(const Entity& _other) const { return index == _other.index && generation == _other.generation; }
+    bool operator!=(const Entity& _other) const { return !(*this == _other); }
+};
+
+
+/**
+ * \class World
+ * \brief Archetype based entity component system.
+ *
+ * Entities with the same set of components share an archetype. An archetype stores its
+ * entities in fixed size chunks, each chunk holding one contiguous array per component
+ * (structure of arrays). Queries walk the chunks of the matching archetypes linearly.
+ * Components must be trivially copyable, they are moved between archetypes with memcpy.
+ * Entities and components must not be added or removed while a query runs.
+ */
+class World
+{
+public:
+
+    /*! Maximum number of component types */
+    static constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+
+    /*! Chunk size in bytes */
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    /**
+     * \brief Constructor.
+     *
+     * \param _job_system  Job system used by parallel queries, null to run them on the calling thread
+     */
+    explicit World(JobSystem* _job_system = nullptr);
+
+    /**
+     * \brief Destructor.
+     */
+    virtual ~World();
+
+    /**
+     * \brief Create an entity without component.
+     *
+     * \return Entity
+     */
+    Entity createEntity();
+
+    /**
+     * \brief Create an entity with components.
+     *
+     * \param _components   Component values
+     * \return Entity
+     */
+    template<class... Ts>
+    Entity createEntity(const Ts&... _components);
+
+    /**
+     * \brief Destroy an entity and its components.
+     *
+     * \param _entity   Entity
+     */
+    void destroyEntity(Entity _entity);
+
+    /**
+     * \brief Check if an entity is alive.
+     *
+     * \param _entity   Entity
+     * \return True if alive
+     */
+    bool isAlive(Entity _entity) const;
+
+    /**
+     * \brief Get the number of alive entities.
+     *
+     * \return Entity count
+     */
+    uint32_t getEntityCount() const;
+
+    /**
+     * \brief Add a component to an entity, or replace its value.
+     *
+     * \param _entity       Entity
+     * \param _component    Component value
+     */
+    template<class T>
+    void addComponent(Entity _entity, const T& _component);
+
+    /**
+     * \brief Remove a component from an entity.
+     *
+     * \param _entity   Entity
+     */
+    template<class T>
+    void removeComponent(Entity _entity);
+
+    /**
+     * \brief Check if an entity has a component.
+     *
+     * \param _entity   Entity
+     * \return True if the entity has the component
+     */
+    template<class T>
+    bool hasComponent(Entity _entity) const;
+
+    /**
+     * \brief Get a component of an entity.
+     * The pointer is invalidated by any structural change of the world.
+     *
+     * \param _entity   Entity
+     * \return Component, null if the entity is not alive or has no such component
+     */
+    template<class T>
+    T* getComponent(Entity _entity);
+
+    /**
+     * \brief Call a function for each chunk of the entities having all the components.
+     *
+     * \param _function Function called with (count, entities, Ts* arrays...)
+     */
+    template<class... Ts, class F>
+    void eachChunk(F&& _function);
+
+    /**
+     * \brief Call a function for each entity having all the components.
+     *
+     * \param _function Function called with (Ts&...)
+     */
+    template<class... Ts, class F>
+    void each(F&& _function);
+
+    /**
+     * \brief Call a function for each entity having all the components, chunks are processed in parallel.
+     *
+     * \param _function Function called with (Ts&...), from several threads
+     */
+    template<class... Ts, class F>
+    void parallelEach(F&& _function);
+
+    /**
+     * \brief Destroy all entities.
+     */
+    void clear();
+
+    /**
+     * \brief Get the id of a component type.
+     *
+     * \return Component type id
+     */
+    template<class T>
+    static uint32_t getComponentTypeId();
+
+private:
+
+    /**
+     * \brief Chunk of entities of an archetype.
+     */
+    struct Chunk
+    {
+        /*! Storage: entity array followed by one array per component */
+        alignas(64) unsigned char data[CHUNK_SIZE];
+
+        /*! Number of entities */
+        uint32_t count {0};
+    };
+
+    /**
+     * \brief Set of entities sharing the same components.
+     */
+    struct Archetype
+    {
+        /*! Component mask */
+        uint64_t mask {0};
+
+        /*! Component type ids, sorted */
+        std::vector<uint32_t> types;
+
+        /*! Array offset in a chunk, per component type id */
+        uint32_t offsets[MAX_COMPONENT_TYPES] {};
+
+        /*! Component size, per component type id */
+        uint32_t sizes[MAX_COMPONENT_TYPES] {};
+
+        /*! Number of entities per chunk */
+        uint32_t chunk_capacity {0};
+
+        /*! Chunks, only the last one can be partially filled */
+        std::vector<std::unique_ptr<Chunk>> chunks;
+
+        /**
+         * \brief Get the entity array of a chunk.
+         */
+        Entity* getEntities(Chunk& _chunk) const
+        {
+            return reinterpret_cast<Entity*>(_chunk.data);
+        }
+
+        /**
+         * \brief Get a component array of a chunk.
+         */
+        template<class T>
+        T* getArray(Chunk& _chunk) const
+        {
+            return reinterpret_cast<T*>(_chunk.data + offsets[getComponentTypeId<T>()]);
+        }
+    };
+
+    /**
+     * \brief Location of an entity.
+     */
+    struct EntityRecord
+    {
+        /*! Archetype, null if the slot is free */
+        Archetype* archetype {nullptr};
+
+        /*! Chunk index */
+        uint32_t chunk {0};
+
+        /*! Row in the chunk */
+        uint32_t row {0};
+
+        /*! Slot generation */
+        uint32_t generation {0};
+    };
+
+    /**
+     * \brief Register a component type.
+     *
+     * \param _size         Component size
+     * \param _alignment    Component alignment
+     * \return Component type id
+     */
+    static uint32_t registerComponentType(size_t _size, size_t _alignment);
+
+    /**
+     * \brief Get the size of a component type.
+     *
+     * \param _type Component type id
+     * \return Component size
+     */
+    static size_t getComponentSize(uint32_t _type);
+
+    /**
+     * \brief Get the alignment of a component type.
+     *
+     * \param _type Component type id
+     * \return Component alignment
+     */
+    static size_t getComponentAlignment(uint32_t _type);
+
+    /**
+     * \brief Get or create the archetype of a component mask.
+     *
+     * \param _mask Component mask
+     * \return Archetype
+     */
+    Archetype* getArchetype(uint64_t _mask);
+
+    /**
+     * \brief Get the record of an alive entity.
+     *
+     * \param _entity   Entity
+     * \return Record, null if the entity is not alive
+     */
+    EntityRecord* getRecord(Entity _entity);
+
+    /**
+     * \brief Get the record of an alive entity.
+     *
+     * \param _entity   Entity
+     * \return Record, null if the entity is not alive
+     */
+    const EntityRecord* getRecord(Entity _entity) const;
+
+    /**
+     * \brief Append an entity to an archetype, components are left uninitialized.
+     *
+     * \param _archetype    Archetype
+     * \param _entity       Entity
+     */
+    void insertEntity(Archetype* _archetype, Entity _entity);
+
+    /**
+     * \brief Remove the row of an entity, the last row of the archetype takes its place.
+     *
+     * \param _record   Record of the entity
+     */
+    void removeRow(EntityRecord& _record);
+
+    /**
+     * \brief Move an entity to another archetype, keeping the shared components.
+     *
+     * \param _entity       Entity
+     * \param _archetype    Destination archetype
+     */
+    void moveEntity(Entity _entity, Archetype* _archetype);
+
+    /**
+     * \brief Get the address of a component of the entity of a record.
+     *
+     * \param _record   Record
+     * \param _type     Component type id
+     * \return Component address
+     */
+    unsigned char* getComponentData(const EntityRecord& _record, uint32_t _type) const;
+
+private:
+
+    /*! Job system, can be null */
+    JobSystem* m_job_system {nullptr};
+
+    /*! Archetypes by component mask */
+    std::map<uint64_t, std::unique_ptr<Archetype>> m_archetypes;
+
+    /*! Archetypes in creation order, for queries */
+    std::vector<Archetype*> m_archetype_list;
+
+    /*! Entity records, by slot index */
+    std::vector<EntityRecord> m_records;
+
+    /*! Free slot indices */
+    std::vector<uint32_t> m_free_slots;
+
+    /*! Number of alive entities */
+    uint32_t m_entity_count {0};
+};
+
+
+template<class T>
+uint32_t World::getComponentTypeId()
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Components must be trivially copyable");
+    static const uint32_t id = registerComponentType(sizeof(T), alignof(T));
+    return id;
+}
+
+
+template<class... Ts>
+Entity World::createEntity(const Ts&... _components)
+{
+    Entity entity = createEntity();
+    if constexpr(sizeof...(Ts) > 0)
+    {
+        uint64_t mask = 0;
+        ((mask |= uint64_t(1) << getComponentTypeId<Ts>()), ...);
+        moveEntity(entity, getArchetype(mask));
+
+        const EntityRecord& record = *getRecord(entity);
+        ((std::memcpy(getComponentData(record, getComponentTypeId<Ts>()), &_components, sizeof(Ts))), ...);
+    }
+    return entity;
+}
+
+
+template<class T>
+void World::addComponent(Entity _entity, const T& _component)
+{
+    EntityRecord* record = getRecord(_entity);
+    if(record == nullptr)
+        return;
+
+    uint32_t type = getComponentTypeId<T>();
+    uint64_t bit = uint64_t(1) << type;
+    if((record->archetype->mask & bit) == 0)
+    {
+        moveEntity(_entity, getArchetype(record->archetype->mask | bit));
+        record = getRecord(_entity);
+    }
+
+    std::memcpy(getComponentData(*record, type), &_component, sizeof(T));
+}
+
+
+template<class T>
+void World::removeComponent(Entity _entity)
+{
+    EntityRecord* record = getRecord(_entity);
+    if(record == nullptr)
+        return;
+
+    uint64_t bit = uint64_t(1) << getComponentTypeId<T>();
+    if((record->archetype->mask & bit) != 0)
+        moveEntity(_entity, getArchetype(record->archetype->mask & ~bit));
+}
+
+
+template<class T>
+bool World::hasComponent(Entity _entity) const
+{
+    const EntityRecord* record = getRecord(_entity);
+    return record != nullptr && (record->archetype->mask & (uint64_t(1) << getComponentTypeId<T>())) != 0;
+}
+
+
+template<class T>
+T* World::getComponent(Entity _entity)
+{
+    EntityRecord* record = getRecord(_entity);
+    uint32_t type = getComponentTypeId<T>();
+    if(record == nullptr || (record->archetype->mask & (uint64_t(1) << type)) == 0)
+        return nullptr;
+
+    return reinterpret_cast<T*>(getComponentData(*record, type));
+}
+
+
+template<class... Ts, class F>
+void World::eachChunk(F&& _function)
+{
+    uint64_t mask = 0;
+    ((mask |= uint64_t(1) << getComponentTypeId<Ts>()), ...);
+
+    for(Archetype* archetype : m_archetype_list)
+    {
+        if((archetype->mask & mask) != mask)
+            continue;
+
+        for(auto& chunk : archetype->chunks)
+        {
+            if(chunk->count > 0)
+                _function(chunk->count, archetype->getEntities(*chunk), archetype->template getArray<Ts>(*chunk)...);
+        }
+    }
+}
+
+
+template<class... Ts, class F>
+void World::each(F&& _function)
+{
+    eachChunk<Ts...>([&_function](uint32_t _count, const Entity*, Ts*... _arrays)
+    {
+        for(uint32_t i = 0; i < _count; ++i)
+            _function(_arrays[i]...);
+    });
+}
+
+
+template<class... Ts, class F>
+void World::parallelEach(F&& _function)
+{
+    // Gather the chunks first, each job then walks whole chunks
+    struct ChunkRef
+    {
+        Archetype* archetype;
+        Chunk* chunk;
+    };
+
+    uint64_t mask = 0;
+    ((mask |= uint64_t(1) << getComponentTypeId<Ts>()), ...);
+
+    std::vector<ChunkRef> chunks;
+    for(Archetype* archetype : m_archetype_list)
+    {
+        if((archetype->mask & mask) != mask)
+            continue;
+
+        for(auto& chunk : archetype->chunks)
+        {
+            if(chunk->count > 0)
+                chunks.push_back({archetype, chunk.get()});
+        }
+    }
+
+    auto process = [&chunks, &_function](uint32_t _begin, uint32_t _end)
+    {
+        for(uint32_t c = _begin; c < _end; ++c)
+        {
+            Archetype* archetype = chunks[c].archetype;
+            Chunk& chunk = *chunks[c].chunk;
+            auto arrays = std::make_tuple(archetype->template getArray<Ts>(chunk)...);
+            for(uint32_t i = 0; i < chunk.count; ++i)
+                _function(std::get<Ts*>(arrays)[i]...);
+        }
+    };
+
+    uint32_t chunk_count = static_cast<uint32_t>(chunks.size());
+    if(m_job_system != nullptr)
+        m_job_system->parallelFor(chunk_count, 1, process);
+    else
+        process(0, chunk_count);
+}
+
+}//namespace ugly
@@ -0,0 +1,311 @@
+#include "AllocationTracker.h"
+
+#include <new>
+#include <cstdlib>
+
+
+namespace
+{
+    /**
+     * \brief Atomic counters of a tag.
+     */
+    struct TagCounters
+    {
+        std::atomic<uint64_t> allocations;
+        std::atomic<uint64_t> frees;
+        std::atomic<uint64_t> allocated_bytes;
+        std::atomic<uint64_t> freed_bytes;
+    };
+
+    /*! Counters, zero initialized before any dynamic initialization */
+    TagCounters g_counters[static_cast<size_t>(ugly::AllocationTag::count)];
+
+    /*! Live bytes of all tags */
+    std::atomic<int64_t> g_live_bytes {0};
+
+    /*! High-water mark of the live bytes */
+    std::atomic<int64_t> g_peak_live_bytes {0};
+
+    /*! Tag of the calling thread */
+    thread_local ugly::AllocationTag t_current_tag = ugly::AllocationTag::engine;
+
+    /*! Tag names */
+    const char* TAG_NAMES[] = {"engine", "input", "vulkan", "logging", "application"};
+}
+
+
+#ifdef UGLY_ALLOCATION_TRACKING
+
+namespace
+{
+    /**
+     * \brief Header stored before each tracked allocation.
+     */
+    struct AllocationHeader
+    {
+        /*! User size */
+        uint64_t size;
+
+        /*! Offset from the malloc pointer to the user pointer */
+        uint32_t offset;
+
+        /*! Tag */
+        uint32_t tag;
+    };
+
+    static_assert(sizeof(AllocationHeader) == 16, "Allocation header must keep the default alignment");
+
+    /**
+     * \brief Allocate and count.
+     */
+    void* trackedAllocate(std::size_t _size, std::size_t _alignment)
+    {
+        _alignment = std::max<std::size_t>(_alignment, sizeof(AllocationHeader));
+        std::size_t padding = _alignment > sizeof(AllocationHeader) ? _alignment : 0;
+        char* raw = static_cast<char*>(std::malloc(_size + sizeof(AllocationHeader) + padding));
+        if(raw == nullptr)
+            return nullptr;
+
+        uintptr_t address = (reinterpret_cast<uintptr_t>(raw) + sizeof(AllocationHeader) + _alignment - 1) & ~(uintptr_t(_alignment) - 1);
+        char* pointer = reinterpret_cast<char*>(address);
+
+        uint32_t tag = static_cast<uint32_t>(t_current_tag);
+        AllocationHeader* header = reinterpret_cast<AllocationHeader*>(pointer) - 1;
+        header->size = _size;
+        header->offset = static_cast<uint32_t>(pointer - raw);
+        header->tag = tag;
+
+        g_counters[tag].allocations.fetch_add(1, std::memory_order_relaxed);
+        g_counters[tag].allocated_bytes.fetch_add(_size, std::memory_order_relaxed);
+        int64_t live = g_live_bytes.fetch_add(static_cast<int64_t>(_size), std::memory_order_relaxed) + static_cast<int64_t>(_size);
+        int64_t peak = g_peak_live_bytes.load(std::memory_order_relaxed);
+        while(live > peak && !g_peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+
+        return pointer;
+    }
+
+    /**
+     * \brief Allocate and count, throw on failure.
+     */
+    void* trackedAllocateOrThrow(std::size_t _size, std::size_t _alignment)
+    {
+        void* pointer = trackedAllocate(_size == 0 ? 1 : _size, _alignment);
+        if(pointer == nullptr)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    /**
+     * \brief Free and count.
+     */
+    void trackedFree(void* _pointer)
+    {
+        if(_pointer == nullptr)
+            return;
+
+        AllocationHeader* header = static_cast<AllocationHeader*>(_pointer) - 1;
+        g_counters[header->tag].frees.fetch_add(1, std::memory_order_relaxed);
+        g_counters[header->tag].freed_bytes.fetch_add(header->size, std::memory_order_relaxed);
+        g_live_bytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+
+        std::free(static_cast<char*>(_pointer) - header->offset);
+    }
+}
+
+// Replace global allocation functions
+void* operator new(std::size_t _size) { return trackedAllocateOrThrow(_size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](std::size_t _size) { return trackedAllocateOrThrow(_size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(std::size_t _size, const std::nothrow_t&) noexcept { return trackedAllocate(_size == 0 ? 1 : _size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](std::size_t _size, const std::nothrow_t&) noexcept { return trackedAllocate(_size == 0 ? 1 : _size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(std::size_t _size, std::align_val_t _alignment) { return trackedAllocateOrThrow(_size, static_cast<std::size_t>(_alignment)); }
+void* operator new[](std::size_t _size, std::align_val_t _alignment) { return trackedAllocateOrThrow(_size, static_cast<std::size_t>(_alignment)); }
+void* operator new(std::size_t _size, std::align_val_t _alignment, const std::nothrow_t&) noexcept { return trackedAllocate(_size == 0 ? 1 : _size, static_cast<std::size_t>(_alignment)); }
+void* operator new[](std::size_t _size, std::align_val_t _alignment, const std::nothrow_t&) noexcept { return trackedAllocate(_size == 0 ? 1 : _size, static_cast<std::size_t>(_alignment)); }
+
+void operator delete(void* _pointer) noexcept { trackedFree(_pointer); }
+void operator delete[](void* _pointer) noexcept { trackedFree(_pointer); }
+void operator delete(void* _pointer, std::size_t) noexcept { trackedFree(_pointer); }
+void operator delete[](void* _pointer, std::size_t) noexcept { trackedFree(_pointer); }
+void operator delete(void* _pointer, const std::nothrow_t&) noexcept { trackedFree(_pointer); }
+void operator delete[](void* _pointer, const std::nothrow_t&) noexcept { trackedFree(_pointer); }
+void operator delete(void* _pointer, std::align_val_t) noexcept { trackedFree(_pointer); }
+void operator delete[](void* _pointer, std::align_val_t) noexcept { trackedFree(_pointer); }
+void operator delete(void* _pointer, std::size_t, std::align_val_t) noexcept { trackedFree(_pointer); }
+void operator delete[](void* _pointer, std::size_t, std::align_val_t) noexcept { trackedFree(_pointer); }
+void operator delete(void* _pointer, std::align_val_t, const std::nothrow_t&) noexcept { trackedFree(_pointer); }
+void operator delete[](void* _pointer, std::align_val_t, const std::nothrow_t&) noexcept { trackedFree(_pointer); }
+
+#endif
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::AllocationTracker::AllocationTracker()
+{
+}
+
+
+/**
+ * \brief Get the tag of the calling thread.
+ *
+ * \return Current tag
+ */
+ugly::AllocationTag ugly::AllocationTracker::getCurrentTag()
+{
+    return t_current_tag;
+}
+
+
+/**
+ * \brief Set the tag of the calling thread.
+ *
+ * \param _tag  New tag
+ * \return Previous tag
+ */
+ugly::AllocationTag ugly::AllocationTracker::setCurrentTag(AllocationTag _tag)
+{
+    AllocationTag previous = t_current_tag;
+    t_current_tag = _tag;
+    return previous;
+}
+
+
+/**
+ * \brief Get a tag name.
+ *
+ * \param _tag  Tag
+ * \return Tag name
+ */
+const char* ugly::AllocationTracker::getTagName(AllocationTag _tag)
+{
+    if(_tag >= AllocationTag::count)
+        return "unknown";
+
+    return TAG_NAMES[static_cast<size_t>(_tag)];
+}
+
+
+/**
+ * \brief Set the number of frames before the steady state.
+ *
+ * \param _frames   Warm up frame count
+ */
+void ugly::AllocationTracker::setWarmUpFrames(uint64_t _frames)
+{
+    m_warm_up_frames = _frames;
+}
+
+
+/**
+ * \brief End the current frame and snapshot its counters.
+ */
+void ugly::AllocationTracker::endFrame()
+{
+    uint64_t frame_allocations = 0;
+    for(size_t tag = 0; tag < static_cast<size_t>(AllocationTag::count); ++tag)
+    {
+        AllocationStats total = getTotalStats(static_cast<AllocationTag>(tag));
+        m_last_frame[tag].allocations = total.allocations - m_frame_start[tag].allocations;
+        m_last_frame[tag].frees = total.frees - m_frame_start[tag].frees;
+        m_last_frame[tag].allocated_bytes = total.allocated_bytes - m_frame_start[tag].allocated_bytes;
+        m_last_frame[tag].freed_bytes = total.freed_bytes - m_frame_start[tag].freed_bytes;
+        m_frame_start[tag] = total;
+
+        frame_allocations += m_last_frame[tag].allocations;
+    }
+
+    ++m_frame_count;
+    if(m_frame_count > m_warm_up_frames && frame_allocations > 0)
+    {
+        if(m_flagged_frame_count == 0)
+        {
+            LOG_WARNING << "Steady state frame " << m_frame_count << " allocated " << frame_allocations << " times";
+            for(size_t tag = 0; tag < static_cast<size_t>(AllocationTag::count); ++tag)
+            {
+                if(m_last_frame[tag].allocations > 0)
+                    LOG_WARNING << "\t- " << TAG_NAMES[tag] << ": " << m_last_frame[tag].allocations << " allocations, " << m_last_frame[tag].allocated_bytes << " bytes";
+            }
+        }
+        ++m_flagged_frame_count;
+    }
+}
+
+
+/**
+ * \brief Get the counters since the program start.
+ *
+ * \param _tag  Tag
+ * \return Counters
+ */
+ugly::AllocationStats ugly::AllocationTracker::getTotalStats(AllocationTag _tag) const
+{
+    const TagCounters& counters = g_counters[static_cast<size_t>(_tag)];
+
+    AllocationStats stats;
+    stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+    stats.frees = counters.frees.load(std::memory_order_relaxed);
+    stats.allocated_bytes = counters.allocated_bytes.load(std::memory_order_relaxed);
+    stats.freed_bytes = counters.freed_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+/**
+ * \brief Get the counters of the last ended frame.
+ *
+ * \param _tag  Tag
+ * \return Counters
+ */
+ugly::AllocationStats ugly::AllocationTracker::getFrameStats(AllocationTag _tag) const
+{
+    return m_last_frame[static_cast<size_t>(_tag)];
+}
+
+
+/**
+ * \brief Get the live bytes of a tag.
+ *
+ * \param _tag  Tag
+ * \return Allocated bytes not freed yet
+ */
+int64_t ugly::AllocationTracker::getLiveBytes(AllocationTag _tag) const
+{
+    AllocationStats stats = getTotalStats(_tag);
+    return static_cast<int64_t>(stats.allocated_bytes) - static_cast<int64_t>(stats.freed_bytes);
+}
+
+
+/**
+ * \brief Get the highest live bytes of all tags together.
+ *
+ * \return High-water mark in bytes
+ */
+int64_t ugly::AllocationTracker::getPeakLiveBytes() const
+{
+    return g_peak_live_bytes.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get the number of ended frames.
+ *
+ * \return Frame count
+ */
+uint64_t ugly::AllocationTracker::getFrameCount() const
+{
+    return m_frame_count;
+}
+
+
+/**
+ * \brief Get the number of steady state frames which allocated.
+ *
+ * \return Flagged frame count
+ */
+uint64_t ugly::AllocationTracker::getFlaggedFrameCount() const
+{
+    return m_flagged_frame_count;
+}
@@ -24,8 +24,8 @@ ugly::Application::~Application()
  */
 bool ugly::Application::initialize()
 {
-    Engine::getInstance()->getInputManager()->createButton("quit");
-    Engine::getInstance()->getInputManager()->bindKeyToButton(GLFW_KEY_ESCAPE, "quit");
+    m_quit_button = Engine::getInstance()->getInputManager()->createButton("quit");
+    Engine::getInstance()->getInputManager()->bindKeyToButton(GLFW_KEY_ESCAPE, m_quit_button);
 
     return true;
 }
@@ -44,11 +44,22 @@ void ugly::Application::shutdown()
  */
 void ugly::Application::update()
 {
-    if(Engine::getInstance()->getInputManager()->getButtonAction("quit") == InputAction::released)
+    if(Engine::getInstance()->getInputManager()->getButtonAction(m_quit_button) == InputAction::released)
         Engine::getInstance()->quit();
 }
 
 
+/**
+ * \brief Render application.
+ * Called once per frame, after the simulation ticks of the frame.
+ * 
+ * \param _alpha  Interpolation factor in [0, 1) between previous and current simulation state
+ */
+void ugly::Application::render(float _alpha)
+{
+}
+
+
 /**
  * \brief Get application name.
  * 
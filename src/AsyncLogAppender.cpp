@@ -0,0 +1,299 @@
+#include "AsyncLogAppender.h"
+#include "LogFormatter.h"
+#include "AllocationTracker.h"
+#include <plog/Converters/UTF8Converter.h>
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::AsyncLogAppender::AsyncLogAppender() :
+    m_slots(new Slot[CAPACITY])
+{
+    for(uint32_t i = 0; i < CAPACITY; ++i)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Destructor.
+ * Stop the writer thread.
+ */
+ugly::AsyncLogAppender::~AsyncLogAppender()
+{
+    stop();
+}
+
+
+/**
+ * \brief Open the log file and start the writer thread.
+ *
+ * \param _filename     Log file, truncated
+ * \param _console      Also write the records to the standard output
+ * \return false if the log file cannot be opened, the writer thread still runs for the console
+ */
+bool ugly::AsyncLogAppender::start(const std::string& _filename, bool _console)
+{
+    if(m_thread.joinable())
+        return true;
+
+    // There is no logger yet to report the error
+    m_file = fopen(_filename.c_str(), "wb");
+    if(m_file == nullptr)
+    {
+        fprintf(stderr, "Cannot open log file: %s\n", _filename.c_str());
+    }
+    else
+    {
+        const std::string& header = plog::UTF8Converter::header(plog::LogFormatter::header());
+        fwrite(header.data(), 1, header.size(), m_file);
+    }
+
+    // The writer thread runs even without a file, otherwise the ring fills up and the console is lost
+    m_console = _console;
+    m_batch.reserve(64 * 1024);
+    m_stopped.store(false, std::memory_order_relaxed);
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&AsyncLogAppender::writerThread, this);
+    return m_file != nullptr;
+}
+
+
+/**
+ * \brief Write the pending records and stop the writer thread.
+ * Records written afterwards are dropped.
+ */
+void ugly::AsyncLogAppender::stop()
+{
+    m_stopped.store(true, std::memory_order_relaxed);
+
+    if(m_thread.joinable())
+    {
+        m_running.store(false, std::memory_order_release);
+        m_thread.join();
+    }
+
+    if(m_file != nullptr)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+
+/**
+ * \brief Queue a record, called by plog.
+ * A fatal record is flushed before returning.
+ *
+ * \param _record   Record
+ */
+void ugly::AsyncLogAppender::write(const plog::Record& _record)
+{
+    if(m_stopped.load(std::memory_order_relaxed))
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot* slot = tryClaim();
+    while(slot == nullptr)
+    {
+        // Without a writer thread the ring never drains, so blocking would hang
+        if(m_policy.load(std::memory_order_relaxed) != LogOverflowPolicy::block || !m_running.load(std::memory_order_relaxed))
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+        slot = tryClaim();
+    }
+
+    uint64_t position = slot->sequence.load(std::memory_order_relaxed);
+    plog::Severity severity = _record.getSeverity();
+
+    slot->severity = severity;
+
+    const char* func = _record.getFunc();
+    size_t func_length = 0;
+    while(func_length < FUNC_SIZE - 1 && func[func_length] != 0)
+    {
+        slot->func[func_length] = func[func_length];
+        ++func_length;
+    }
+    slot->func[func_length] = 0;
+
+    const plog::util::nchar* message = _record.getMessage();
+    size_t message_length = 0;
+    while(message_length < MESSAGE_SIZE - 1 && message[message_length] != 0)
+    {
+        slot->message[message_length] = message[message_length];
+        ++message_length;
+    }
+    slot->message[message_length] = 0;
+
+    // Publish the slot to the writer thread, it must not be accessed afterwards
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    if(severity == plog::fatal)
+        flush();
+}
+
+
+/**
+ * \brief Wait until the records queued before the call are written.
+ */
+void ugly::AsyncLogAppender::flush()
+{
+    uint64_t target = m_enqueue_pos.load(std::memory_order_acquire);
+    while(m_running.load(std::memory_order_relaxed) && m_written_pos.load(std::memory_order_acquire) < target)
+        std::this_thread::yield();
+}
+
+
+/**
+ * \brief Set the behavior when the ring is full.
+ *
+ * \param _policy   Overflow policy
+ */
+void ugly::AsyncLogAppender::setOverflowPolicy(LogOverflowPolicy _policy)
+{
+    m_policy.store(_policy, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get the behavior when the ring is full.
+ *
+ * \return Overflow policy
+ */
+ugly::LogOverflowPolicy ugly::AsyncLogAppender::getOverflowPolicy() const
+{
+    return m_policy.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get the number of records discarded because the ring was full.
+ *
+ * \return Dropped record count
+ */
+uint64_t ugly::AsyncLogAppender::getDroppedCount() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Claim a slot to write a record.
+ * The returned slot sequence is the claimed position.
+ *
+ * \return Slot, nullptr if the ring is full
+ */
+ugly::AsyncLogAppender::Slot* ugly::AsyncLogAppender::tryClaim()
+{
+    uint64_t position = m_enqueue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        Slot* slot = &m_slots[position & (CAPACITY - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence - position);
+
+        if(difference == 0)
+        {
+            // The slot is free for this position, race the other producers for it
+            if(m_enqueue_pos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                return slot;
+        }
+        else if(difference < 0)
+        {
+            // The slot still holds the record of the previous lap
+            return nullptr;
+        }
+        else
+        {
+            position = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+
+/**
+ * \brief Writer thread function.
+ */
+void ugly::AsyncLogAppender::writerThread()
+{
+    UGLY_ALLOCATION_SCOPE(AllocationTag::logging);
+
+    for(;;)
+    {
+        // Read the flag before draining so the records queued before stop() are written
+        bool running = m_running.load(std::memory_order_acquire);
+
+        if(drain() > 0)
+            writeBatch();
+        else if(!running)
+            break;
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+
+/**
+ * \brief Format the written slots into the batch.
+ *
+ * \return Number of formatted records
+ */
+uint32_t ugly::AsyncLogAppender::drain()
+{
+    uint32_t count = 0;
+    while(count < CAPACITY)
+    {
+        Slot& slot = m_slots[m_dequeue_pos & (CAPACITY - 1)];
+        if(slot.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1)
+            break;
+
+        m_batch += plog::LogFormatter::format(slot.severity, slot.func, slot.message);
+
+        // Give the slot back to the producers for the next lap
+        slot.sequence.store(m_dequeue_pos + CAPACITY, std::memory_order_release);
+        ++m_dequeue_pos;
+        ++count;
+    }
+
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if(dropped != m_reported_dropped && m_policy.load(std::memory_order_relaxed) == LogOverflowPolicy::count)
+    {
+        plog::util::nostringstream ss;
+        ss << (dropped - m_reported_dropped) << " log records dropped";
+        m_batch += plog::LogFormatter::format(plog::warning, __FUNCTION__, ss.str().c_str());
+        ++count;
+    }
+    m_reported_dropped = dropped;
+
+    return count;
+}
+
+
+/**
+ * \brief Write the batch to the outputs.
+ */
+void ugly::AsyncLogAppender::writeBatch()
+{
+    const std::string& text = plog::UTF8Converter::convert(m_batch);
+
+    if(m_file != nullptr)
+    {
+        fwrite(text.data(), 1, text.size(), m_file);
+        fflush(m_file);
+    }
+
+    if(m_console)
+    {
+        fwrite(text.data(), 1, text.size(), stdout);
+        fflush(stdout);
+    }
+
+    m_batch.clear();
+    m_written_pos.store(m_dequeue_pos, std::memory_order_release);
+}
@@ -0,0 +1,293 @@
+#include "BinaryLog.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::BinaryLog::BinaryLog()
+{
+}
+
+
+/**
+ * \brief Destructor.
+ */
+ugly::BinaryLog::~BinaryLog()
+{
+    close();
+}
+
+
+/**
+ * \brief Create the log file and map it.
+ *
+ * \param _filename     Log file, truncated
+ * \param _capacity     File size
+ * \return false if error
+ */
+bool ugly::BinaryLog::open(const std::string& _filename, size_t _capacity)
+{
+    if(isOpen())
+    {
+        LOG_ERROR << "Binary log is already open";
+        return false;
+    }
+
+    LOG_INFO << "Open binary log: " << _filename;
+
+#ifdef _WIN32
+    m_file = CreateFileA(_filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        LOG_ERROR << "Cannot create binary log: " << _filename;
+        return false;
+    }
+
+    // The mapping size sets the file size
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(_capacity) >> 32), static_cast<DWORD>(_capacity & 0xFFFFFFFF), nullptr);
+    if(m_mapping != nullptr)
+        m_data = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, _capacity));
+#else
+    m_file = ::open(_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(m_file < 0)
+    {
+        LOG_ERROR << "Cannot create binary log: " << _filename;
+        return false;
+    }
+
+    // The file is sparse, only the written pages use disk space
+    if(ftruncate(m_file, static_cast<off_t>(_capacity)) == 0)
+    {
+        void* data = mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+        if(data != MAP_FAILED)
+            m_data = static_cast<uint8_t*>(data);
+    }
+#endif
+
+    if(m_data == nullptr)
+    {
+        LOG_ERROR << "Cannot map binary log: " << _filename;
+        unmap(0);
+        return false;
+    }
+
+    m_capacity = _capacity;
+
+    BinaryLogHeader header;
+    memcpy(header.magic, BinaryLogHeader::MAGIC, sizeof(header.magic));
+    header.version = BinaryLogHeader::VERSION;
+    header.origin = now();
+    memcpy(m_data, &header, sizeof(header));
+    m_write_offset.store(sizeof(header), std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+
+    // Sites registered before the opening are defined first
+    std::lock_guard<std::mutex> lock(m_sites_mutex);
+    for(uint32_t id = 0; id < m_sites.size(); ++id)
+        writeSiteDefinition(id);
+    m_open.store(true, std::memory_order_release);
+
+    return true;
+}
+
+
+/**
+ * \brief Unmap the log file and shrink it to the written records.
+ * It must not run concurrently with writes.
+ */
+void ugly::BinaryLog::close()
+{
+    if(!isOpen())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_sites_mutex);
+        m_open.store(false, std::memory_order_release);
+    }
+
+    size_t size = std::min(m_write_offset.load(std::memory_order_acquire), m_capacity);
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    unmap(size);
+
+    LOG_INFO << "Close binary log: " << size << " bytes";
+    if(dropped > 0)
+        LOG_WARNING << "Binary log was full, " << dropped << " entries dropped";
+}
+
+
+/**
+ * \brief Set the maximum severity written to the file.
+ *
+ * \param _severity     Maximum severity
+ */
+void ugly::BinaryLog::setMaxSeverity(plog::Severity _severity)
+{
+    m_max_severity.store(_severity, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Register a call site.
+ * The site definition is written to the file now, or when it is opened.
+ *
+ * \param _severity     Severity
+ * \param _func         Function name, static string
+ * \param _file         Source file, static string
+ * \param _line         Source line
+ * \param _format       Format string, static string, each {} is replaced by an argument
+ * \return Site id
+ */
+uint32_t ugly::BinaryLog::registerSite(plog::Severity _severity, const char* _func, const char* _file, uint32_t _line, const char* _format)
+{
+    std::lock_guard<std::mutex> lock(m_sites_mutex);
+
+    uint32_t id = static_cast<uint32_t>(m_sites.size());
+    m_sites.push_back({_severity, _func, _file, _line, _format});
+
+    // The definition is committed before the site id is returned, so before any of its entries
+    if(m_open.load(std::memory_order_relaxed))
+        writeSiteDefinition(id);
+
+    return id;
+}
+
+
+/**
+ * \brief Get the number of entries dropped because the file was full.
+ *
+ * \return Dropped entry count
+ */
+uint64_t ugly::BinaryLog::getDroppedCount() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get the number of bytes written to the file.
+ *
+ * \return Written size
+ */
+size_t ugly::BinaryLog::getSize() const
+{
+    return std::min(m_write_offset.load(std::memory_order_relaxed), m_capacity);
+}
+
+
+/**
+ * \brief Copy a record to the mapping.
+ *
+ * \param _record   Record, header included
+ * \param _size     Record size
+ * \return false if the file is full
+ */
+bool ugly::BinaryLog::commit(const uint8_t* _record, size_t _size)
+{
+    // Once full the offset keeps growing, so every later record is dropped and the end stays zeroed
+    size_t offset = m_write_offset.fetch_add(_size, std::memory_order_relaxed);
+    if(offset + _size > m_capacity)
+        return false;
+
+    memcpy(m_data + offset, _record, _size);
+    return true;
+}
+
+
+/**
+ * \brief Write a site definition record.
+ *
+ * \param _id       Site id
+ */
+void ugly::BinaryLog::writeSiteDefinition(uint32_t _id)
+{
+    const Site& site = m_sites[_id];
+
+    BinaryLogSiteDefinition definition;
+    definition.id = _id;
+    definition.line = site.line;
+    definition.severity = static_cast<uint32_t>(site.severity);
+
+    size_t func_size = strlen(site.func) + 1;
+    size_t file_size = strlen(site.file) + 1;
+    size_t format_size = strlen(site.format) + 1;
+
+    std::vector<uint8_t> record(sizeof(BinaryLogRecordHeader) + sizeof(definition) + func_size + file_size + format_size);
+    BinaryLogRecordHeader header;
+    header.size = static_cast<uint32_t>(record.size());
+    header.site = BinaryLogRecordHeader::SITE_DEFINITION;
+
+    uint8_t* data = record.data();
+    memcpy(data, &header, sizeof(header));
+    data += sizeof(header);
+    memcpy(data, &definition, sizeof(definition));
+    data += sizeof(definition);
+    memcpy(data, site.func, func_size);
+    data += func_size;
+    memcpy(data, site.file, file_size);
+    data += file_size;
+    memcpy(data, site.format, format_size);
+
+    if(!commit(record.data(), record.size()))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Release the mapping and the file handles.
+ *
+ * \param _size     Final file size
+ */
+void ugly::BinaryLog::unmap(size_t _size)
+{
+#ifdef _WIN32
+    if(m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if(m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if(m_file != nullptr)
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(_size);
+        SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN);
+        SetEndOfFile(m_file);
+        CloseHandle(m_file);
+    }
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if(m_data != nullptr)
+        munmap(m_data, m_capacity);
+    if(m_file >= 0)
+    {
+        if(ftruncate(m_file, static_cast<off_t>(_size)) != 0)
+            LOG_WARNING << "Cannot shrink binary log";
+        ::close(m_file);
+    }
+    m_file = -1;
+#endif
+
+    m_data = nullptr;
+    m_capacity = 0;
+}
+
+
+/**
+ * \brief Get current time in the entry time base.
+ *
+ * \return Steady clock time in nanoseconds
+ */
+uint64_t ugly::BinaryLog::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
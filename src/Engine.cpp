@@ -1,5 +1,7 @@
 #include "Engine.h"
 #include "LogFormatter.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
 
 /**
  * \brief Constructor.
@@ -77,6 +79,17 @@ ugly::InputManager* ugly::Engine::getInputManager() const
 }
 
 
+/**
+ * \brief Get Vulkan manager.
+ *
+ * \return Vulkan manager, nullptr if Vulkan is not available in headless mode
+ */
+ugly::VulkanManager* ugly::Engine::getVulkanManager() const
+{
+    return m_vulkan_manager.get();
+}
+
+
 /**
  * \brief Get GLFW window.
  *
@@ -89,33 +102,270 @@ GLFWwindow* ugly::Engine::getWindow() const
 
 
 /**
- * \brief Initialize plog.
+ * \brief Enable headless mode.
+ * In headless mode no window is created, the main loop runs on a synthetic clock
+ * advancing one simulation tick per frame, and inputs come from InputManager::injectKeyChange().
+ * It must be called before run().
+ *
+ * \param _headless    Headless flag
  */
-void ugly::Engine::initializePLog()
+void ugly::Engine::setHeadless(bool _headless)
+{
+    m_headless = _headless;
+}
+
+
+/**
+ * \brief Check if the engine runs in headless mode.
+ *
+ * \return True if headless
+ */
+bool ugly::Engine::isHeadless() const
+{
+    return m_headless;
+}
+
+
+/**
+ * \brief Set the behavior of the logging threads when the log ring is full.
+ * It can be called before run().
+ *
+ * \param _policy   Overflow policy
+ */
+void ugly::Engine::setLogOverflowPolicy(LogOverflowPolicy _policy)
+{
+    m_log_appender->setOverflowPolicy(_policy);
+}
+
+
+/**
+ * \brief Enable the binary log.
+ * The UGLY_BLOG_* entries are written to BINARY_LOG_FILENAME instead of the text log.
+ * It must be called before run().
+ *
+ * \param _enabled    Binary log flag
+ */
+void ugly::Engine::setBinaryLog(bool _enabled)
+{
+    m_binary_log = _enabled;
+}
+
+
+/**
+ * \brief Get log appender.
+ *
+ * \return Log appender
+ */
+ugly::AsyncLogAppender* ugly::Engine::getLogAppender() const
+{
+    return m_log_appender.get();
+}
+
+
+/**
+ * \brief Get frame pacer.
+ *
+ * \return Frame pacer
+ */
+ugly::FramePacer* ugly::Engine::getFramePacer() const
+{
+    return m_frame_pacer.get();
+}
+
+
+/**
+ * \brief Get job system.
+ *
+ * \return Job system
+ */
+ugly::JobSystem* ugly::Engine::getJobSystem() const
+{
+    return m_job_system.get();
+}
+
+
+/**
+ * \brief Get system scheduler.
+ *
+ * \return System scheduler
+ */
+ugly::SystemScheduler* ugly::Engine::getSystemScheduler() const
+{
+    return m_system_scheduler.get();
+}
+
+
+/**
+ * \brief Get entity world.
+ *
+ * \return World
+ */
+ugly::World* ugly::Engine::getWorld() const
+{
+    return m_world.get();
+}
+
+
+/**
+ * \brief Get frame arena.
+ *
+ * \return Frame arena
+ */
+ugly::FrameArena* ugly::Engine::getFrameArena() const
+{
+    return m_frame_arena.get();
+}
+
+
+/**
+ * \brief Get startup timeline.
+ *
+ * \return Startup timeline
+ */
+ugly::StartupTimeline* ugly::Engine::getStartupTimeline() const
+{
+    return m_startup_timeline.get();
+}
+
+
+/**
+ * \brief Get input latency tracker.
+ * It holds the time from the oldest input processed by a frame to the present of this frame.
+ *
+ * \return Input latency tracker
+ */
+ugly::InputLatencyTracker* ugly::Engine::getInputLatency() const
 {
-    // Remove log file if exists
-    struct stat buffer;
-    if (stat(LOG_FILENAME.c_str(), &buffer) == 0)
+    return m_input_latency.get();
+}
+
+
+/**
+ * \brief Record each input latency sample as a zone of the profiler trace.
+ *
+ * \param _enabled    Marker flag
+ */
+void ugly::Engine::setInputLatencyMarker(bool _enabled)
+{
+    m_input_latency_marker = _enabled;
+}
+
+
+/**
+ * \brief Set simulation tick rate.
+ * Application::update() is called at this fixed rate, independently of the frame rate.
+ *
+ * \param _tick_rate   Number of simulation ticks per second
+ */
+void ugly::Engine::setTickRate(unsigned int _tick_rate)
+{
+    if(_tick_rate == 0)
     {
-        if (remove(LOG_FILENAME.c_str()) != 0)
-        {
-            LOG_ERROR << "Cannnot remove log file";
-        }
+        LOG_ERROR << "Invalid tick rate: " << _tick_rate;
+        return;
+    }
+
+    m_tick_rate = _tick_rate;
+    m_tick_duration = std::chrono::nanoseconds(std::chrono::seconds(1)) / _tick_rate;
+}
+
+
+/**
+ * \brief Get simulation tick rate.
+ *
+ * \return Number of simulation ticks per second
+ */
+unsigned int ugly::Engine::getTickRate() const
+{
+    return m_tick_rate;
+}
+
+
+/**
+ * \brief Get the duration of a simulation tick.
+ *
+ * \return Tick duration in seconds
+ */
+double ugly::Engine::getFixedDeltaTime() const
+{
+    return std::chrono::duration<double>(m_tick_duration).count();
+}
+
+
+/**
+ * \brief Set the maximum number of simulation ticks run in a single frame.
+ * When a frame is too slow, the remaining time is dropped instead of being caught up later.
+ *
+ * \param _max_ticks   Maximum number of ticks per frame
+ */
+void ugly::Engine::setMaxCatchUpTicks(unsigned int _max_ticks)
+{
+    if(_max_ticks == 0)
+    {
+        LOG_ERROR << "Invalid maximum catch up ticks: " << _max_ticks;
+        return;
+    }
+
+    m_max_catch_up_ticks = _max_ticks;
+}
+
+
+/**
+ * \brief Set the number of frames in flight, before initialize().
+ * The CPU records a frame while the GPU executes the previous ones.
+ *
+ * \param _count   Number of frames in flight
+ */
+void ugly::Engine::setFramesInFlight(unsigned int _count)
+{
+    if(_count == 0)
+    {
+        LOG_ERROR << "Invalid number of frames in flight: " << _count;
+        return;
     }
 
-    // Create log
-    static plog::RollingFileAppender<plog::LogFormatter> fileAppender(LOG_FILENAME.c_str(), 0, 0);
-    static plog::ConsoleAppender<plog::LogFormatter> consoleAppender;
+    m_frames_in_flight = _count;
+}
+
+
+/**
+ * \brief Get the number of simulation ticks since the start of the main loop.
+ *
+ * \return Tick count
+ */
+uint64_t ugly::Engine::getTickCount() const
+{
+    return m_tick_count;
+}
+
+
+/**
+ * \brief Initialize plog.
+ */
+void ugly::Engine::initializePLog()
+{
+    UGLY_ALLOCATION_SCOPE(AllocationTag::logging);
 
-    plog::init(plog::debug, &consoleAppender).addAppender(&fileAppender);
+    // Create log, the file and the console are written by the appender thread
+    bool file_opened = m_log_appender->start(LOG_FILENAME, true);
+    plog::init(plog::debug, m_log_appender.get());
 
     PLOG_INFO << "----- UglyEngine Log";
     PLOG_INFO << "----- Version: " << ugly::version::FULLVERSION_STRING;
+
+    if(!file_opened)
+        PLOG_ERROR << "Cannot open log file " << LOG_FILENAME << ", logging to the console only";
+
+    if(m_binary_log)
+        BinaryLog::getInstance()->open(BINARY_LOG_FILENAME);
 }
 
 
 /**
  * \brief Initialize engine.
+ * Vulkan bring-up runs on a worker thread while the main thread creates the window and
+ * initializes the input manager and the application, so Application::initialize() must not
+ * rely on Vulkan.
  * 
  * \return false if error
  */
@@ -123,41 +373,126 @@ bool ugly::Engine::initialize()
 {
     PLOG_INFO << "--- Initialize engine";
 
-    if(!glfwInit())
+    Profiler::getInstance()->setThreadName("Main");
+    m_startup_timeline->reset();
+
     {
-        PLOG_ERROR << "Failed to initialize GLFW";
-        return false;
+        StartupPhase phase(m_startup_timeline.get(), "Job system");
+        m_job_system.reset(new JobSystem());
+        if(!m_job_system->initialize())
+        {
+            LOG_ERROR << "Failed to init job system";
+            return false;
+        }
     }
 
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-
-    PLOG_INFO << "Display size: " << m_display_size.x << "*" << m_display_size.y;
-    m_window = glfwCreateWindow(m_display_size.x, m_display_size.y, m_application->getName().c_str(), NULL, NULL);
-    if(m_window == nullptr)
     {
-        PLOG_ERROR << "Failed to create GLFW window";
-        return false;
+        StartupPhase phase(m_startup_timeline.get(), "Core systems");
+        m_frame_arena.reset(new FrameArena());
+        m_system_scheduler.reset(new SystemScheduler());
+        m_world.reset(new World(m_job_system.get()));
     }
 
-    m_input_manager.reset(new InputManager());
-    if(!m_input_manager->initialize())
+    // GLFW must be initialized before Vulkan queries the window system extensions
+    if(m_headless)
     {
-        LOG_ERROR << "Failed to init imput manager";
-        return false;
+        PLOG_INFO << "Headless mode, no window";
+    }
+    else
+    {
+        StartupPhase phase(m_startup_timeline.get(), "GLFW");
+        if(!glfwInit())
+        {
+            PLOG_ERROR << "Failed to initialize GLFW";
+            return false;
+        }
     }
 
+    bool vulkan_initialized = false;
+    JobCounter vulkan_counter;
     m_vulkan_manager.reset(new VulkanManager());
-    if(!m_vulkan_manager->initialize())
+    m_vulkan_manager->setFramesInFlight(m_frames_in_flight);
+    m_job_system->run([this, &vulkan_initialized]()
+    {
+        UGLY_ALLOCATION_SCOPE(AllocationTag::vulkan);
+        StartupPhase phase(m_startup_timeline.get(), "Vulkan");
+        vulkan_initialized = m_vulkan_manager->initialize();
+    }, &vulkan_counter);
+
+    bool main_thread_initialized = initializeMainThread();
+
     {
-        LOG_ERROR << "Failed to init vulkan manager";
+        StartupPhase phase(m_startup_timeline.get(), "Wait Vulkan");
+        m_job_system->wait(vulkan_counter);
+    }
+
+    if(!main_thread_initialized)
         return false;
+
+    if(!vulkan_initialized)
+    {
+        UGLY_ALLOCATION_SCOPE(AllocationTag::vulkan);
+        if(!m_headless)
+        {
+            LOG_ERROR << "Failed to init vulkan manager";
+            return false;
+        }
+
+        // Simulation servers may have no Vulkan device at all
+        LOG_WARNING << "Vulkan is not available, running headless without GPU";
+        m_vulkan_manager->shutdown();
+        m_vulkan_manager.reset(nullptr);
     }
 
-    if(!m_application->initialize())
+    m_startup_timeline->finish();
+    LOG_INFO << "Engine started in " << m_startup_timeline->getTotalTime() / 1000 << " us";
+
+    return true;
+}
+
+
+/**
+ * \brief Initialize the parts of the engine bound to the main thread.
+ * It runs while Vulkan is initialized on a worker thread.
+ *
+ * \return false if error
+ */
+bool ugly::Engine::initializeMainThread()
+{
+    if(!m_headless)
     {
-        LOG_ERROR << "Failed to initialize application";
-        return false;
+        StartupPhase phase(m_startup_timeline.get(), "Window");
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+        PLOG_INFO << "Display size: " << m_display_size.x << "*" << m_display_size.y;
+        m_window = glfwCreateWindow(m_display_size.x, m_display_size.y, m_application->getName().c_str(), NULL, NULL);
+        if(m_window == nullptr)
+        {
+            PLOG_ERROR << "Failed to create GLFW window";
+            return false;
+        }
+    }
+
+    {
+        StartupPhase phase(m_startup_timeline.get(), "Input manager");
+        UGLY_ALLOCATION_SCOPE(AllocationTag::input);
+        m_input_manager.reset(new InputManager());
+        if(!m_input_manager->initialize())
+        {
+            LOG_ERROR << "Failed to init imput manager";
+            return false;
+        }
+    }
+
+    {
+        StartupPhase phase(m_startup_timeline.get(), "Application");
+        UGLY_ALLOCATION_SCOPE(AllocationTag::application);
+        if(!m_application->initialize())
+        {
+            LOG_ERROR << "Failed to initialize application";
+            return false;
+        }
     }
 
     return true;
@@ -171,25 +506,77 @@ void ugly::Engine::shutdown()
 {
     if(m_application.get() != nullptr)
     {
+        UGLY_ALLOCATION_SCOPE(AllocationTag::application);
         m_application->shutdown();
         m_application.reset(nullptr);
     }
 
+    if(m_system_scheduler.get() != nullptr)
+    {
+        m_system_scheduler->clear();
+        m_system_scheduler.reset(nullptr);
+    }
+
+    if(m_world.get() != nullptr)
+    {
+        m_world->clear();
+        m_world.reset(nullptr);
+    }
+
     if(m_vulkan_manager.get() != nullptr)
     {
+        UGLY_ALLOCATION_SCOPE(AllocationTag::vulkan);
         m_vulkan_manager->shutdown();
         m_vulkan_manager.reset(nullptr);
     }
 
+    m_input_latency->logReport();
+
     if(m_input_manager.get() != nullptr)
     {
+        UGLY_ALLOCATION_SCOPE(AllocationTag::input);
         m_input_manager->shutdown();
         m_input_manager.reset(nullptr);
     }
 
+    if(m_job_system.get() != nullptr)
+    {
+        m_job_system->shutdown();
+        m_job_system.reset(nullptr);
+    }
+
+    m_frame_arena.reset(nullptr);
+
+    BinaryLog::getInstance()->close();
+
     PLOG_INFO << "--- Shutdown engine";
     m_window = nullptr;
-    glfwTerminate();
+    if(!m_headless)
+        glfwTerminate();
+
+    m_log_appender->flush();
+}
+
+
+/**
+ * \brief Add an input latency sample if the presented frame processed new inputs.
+ */
+void ugly::Engine::sampleInputLatency()
+{
+    uint64_t input_time = m_input_manager->consumeInputTime();
+    if(input_time == 0)
+        return;
+
+    uint64_t present_time = InputEventQueue::now();
+    m_input_latency->addSample(std::chrono::nanoseconds(present_time - std::min(input_time, present_time)));
+
+    // Profiler timestamps are relative to its own origin
+    if(m_input_latency_marker && Profiler::isEnabled())
+    {
+        Profiler* profiler = Profiler::getInstance();
+        uint64_t offset = profiler->now() - present_time;
+        profiler->recordZone("Input latency", input_time + offset, present_time + offset);
+    }
 }
 
 
@@ -200,16 +587,118 @@ void ugly::Engine::shutdown()
  */
 bool ugly::Engine::mainLoop()
 {
+    using clock = std::chrono::steady_clock;
+
+    m_tick_count = 0;
+    auto previous_time = clock::now();
+    std::chrono::nanoseconds accumulator {0};
+    m_frame_pacer->reset();
+
     while(!m_quit)
     {
-        if(glfwWindowShouldClose(m_window))
+        UGLY_PROFILE_ZONE("Frame");
+
+        if(!m_headless && glfwWindowShouldClose(m_window))
             m_quit = true;
 
-        m_application->update();
-        m_input_manager->update();
+        // The synthetic clock of the headless mode runs exactly one tick per frame
+        auto current_time = m_headless ? previous_time + m_tick_duration : clock::now();
+        accumulator += std::chrono::duration_cast<std::chrono::nanoseconds>(current_time - previous_time);
+        previous_time = current_time;
+
+        // Run simulation at a fixed rate
+        unsigned int ticks = 0;
+        while(accumulator >= m_tick_duration && ticks < m_max_catch_up_ticks && !m_quit)
+        {
+            UGLY_PROFILE_ZONE("Tick");
+
+            {
+                // Apply the input events which happened before the end of this tick
+                UGLY_PROFILE_ZONE("Input events");
+                UGLY_ALLOCATION_SCOPE(AllocationTag::input);
+                uint64_t tick_end = UINT64_MAX;
+                if(!m_headless)
+                    tick_end = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>((current_time - accumulator + m_tick_duration).time_since_epoch()).count());
+                m_input_manager->processEvents(tick_end);
+            }
+
+            {
+                UGLY_PROFILE_ZONE("Application update");
+                UGLY_ALLOCATION_SCOPE(AllocationTag::application);
+                m_application->update();
+            }
+
+            {
+                UGLY_PROFILE_ZONE("System scheduler update");
+                m_system_scheduler->update();
+            }
+
+            {
+                UGLY_PROFILE_ZONE("Input update");
+                UGLY_ALLOCATION_SCOPE(AllocationTag::input);
+                m_input_manager->update();
+            }
+
+            accumulator -= m_tick_duration;
+            ++m_tick_count;
+            ++ticks;
+        }
+
+        // Drop the time that cannot be caught up to avoid the spiral of death
+        if(accumulator >= m_tick_duration)
+        {
+            UGLY_BLOG_DEBUG("Simulation is late, dropping {} ticks", accumulator / m_tick_duration);
+            accumulator %= m_tick_duration;
+        }
+
+        // Only blocks when the GPU is still executing the frame that used the slot
+        if(m_vulkan_manager.get() != nullptr)
+        {
+            UGLY_PROFILE_ZONE("Wait frame slot");
+            m_vulkan_manager->getFrameRing()->beginFrame();
+        }
+
+        // Render with the remaining fraction of a tick
+        {
+            UGLY_PROFILE_ZONE("Application render");
+            UGLY_ALLOCATION_SCOPE(AllocationTag::application);
+            float alpha = static_cast<float>(std::chrono::duration<double>(accumulator) / std::chrono::duration<double>(m_tick_duration));
+            m_application->render(alpha);
+        }
+
+        // Submitted as soon as it is recorded, the GPU executes it during the pacing and the next frame
+        if(m_vulkan_manager.get() != nullptr)
+        {
+            UGLY_PROFILE_ZONE("Submit");
+            m_vulkan_manager->getFrameRing()->endFrame();
+        }
+
+        // Only the present, once there is a swapchain, waits for the pacer
+        if(!m_headless)
+        {
+            UGLY_PROFILE_ZONE("Frame pacing");
+            m_frame_pacer->wait();
+        }
+
+        sampleInputLatency();
+
+        if(!m_headless)
+        {
+            UGLY_PROFILE_ZONE("Poll events");
+            UGLY_ALLOCATION_SCOPE(AllocationTag::input);
+            glfwPollEvents();
+        }
+
+        {
+            UGLY_PROFILE_ZONE("Poll devices");
+            UGLY_ALLOCATION_SCOPE(AllocationTag::input);
+            m_input_manager->pollDevices();
+        }
 
-        glfwSwapBuffers(m_window);
-        glfwPollEvents();    
+        m_frame_arena->endFrame();
+        AllocationTracker::getInstance()->endFrame();
+        if(m_vulkan_manager.get() != nullptr)
+            m_vulkan_manager->getValidationSink()->endFrame();
     }
 
     return true;
@@ -0,0 +1,196 @@
+#include "FrameArena.h"
+
+
+namespace
+{
+    /**
+     * \brief Bump cursor of a thread.
+     */
+    struct ThreadCursor
+    {
+        /*! Epoch of the block */
+        uint64_t epoch {0};
+
+        /*! Next free byte */
+        char* current {nullptr};
+
+        /*! End of the block */
+        char* end {nullptr};
+    };
+
+    /*! Cursor of the calling thread */
+    thread_local ThreadCursor t_cursor;
+
+    /*! Epoch generator, shared by all arenas so that a cursor never matches another arena */
+    std::atomic<uint64_t> g_next_epoch {1};
+
+    /*! Block header size, keeps the data aligned for any type */
+    constexpr size_t HEADER_SIZE = 64;
+}
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::FrameArena::FrameArena() :
+    m_epoch(g_next_epoch.fetch_add(1))
+{
+}
+
+
+/**
+ * \brief Destructor.
+ */
+ugly::FrameArena::~FrameArena()
+{
+    for(auto& buffer : m_buffers)
+    {
+        if(buffer.tail != nullptr)
+        {
+            buffer.tail->next = m_free_blocks;
+            m_free_blocks = buffer.head;
+        }
+    }
+
+    while(m_free_blocks != nullptr)
+    {
+        Block* next = m_free_blocks->next;
+        std::free(m_free_blocks);
+        m_free_blocks = next;
+    }
+}
+
+
+/**
+ * \brief Allocate memory for the current frame.
+ *
+ * \param _size         Size in bytes
+ * \param _alignment    Alignment, power of two
+ * \return Memory, valid until the end of the next frame
+ */
+void* ugly::FrameArena::allocate(size_t _size, size_t _alignment)
+{
+    uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+    ThreadCursor& cursor = t_cursor;
+
+    if(cursor.epoch == epoch)
+    {
+        uintptr_t address = (reinterpret_cast<uintptr_t>(cursor.current) + _alignment - 1) & ~(uintptr_t(_alignment) - 1);
+        char* pointer = reinterpret_cast<char*>(address);
+        if(pointer + _size <= cursor.end)
+        {
+            cursor.current = pointer + _size;
+            m_buffers[m_current].allocated_bytes.fetch_add(_size, std::memory_order_relaxed);
+            return pointer;
+        }
+    }
+
+    // Slow path: the block is full or belongs to another frame
+    Block* block = acquireBlock(_size + _alignment);
+    char* data = getData(block);
+    uintptr_t address = (reinterpret_cast<uintptr_t>(data) + _alignment - 1) & ~(uintptr_t(_alignment) - 1);
+    char* pointer = reinterpret_cast<char*>(address);
+
+    cursor.epoch = epoch;
+    cursor.current = pointer + _size;
+    cursor.end = data + block->size;
+    m_buffers[m_current].allocated_bytes.fetch_add(_size, std::memory_order_relaxed);
+
+    return pointer;
+}
+
+
+/**
+ * \brief End the current frame.
+ * The memory of the previous frame is recycled. It must be called while no other
+ * thread allocates.
+ */
+void ugly::FrameArena::endFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_current ^= 1;
+
+    // The new current buffer holds the blocks of two frames ago
+    Buffer& buffer = m_buffers[m_current];
+    if(buffer.tail != nullptr)
+    {
+        buffer.tail->next = m_free_blocks;
+        m_free_blocks = buffer.head;
+        buffer.head = nullptr;
+        buffer.tail = nullptr;
+    }
+    buffer.allocated_bytes.store(0, std::memory_order_relaxed);
+
+    // Invalidate the cursors of every thread
+    m_epoch.store(g_next_epoch.fetch_add(1), std::memory_order_release);
+}
+
+
+/**
+ * \brief Get the number of bytes allocated during the current frame.
+ *
+ * \return Allocated bytes
+ */
+size_t ugly::FrameArena::getAllocatedBytes() const
+{
+    return m_buffers[m_current].allocated_bytes.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get the number of bytes reserved from the system.
+ *
+ * \return Reserved bytes
+ */
+size_t ugly::FrameArena::getReservedBytes() const
+{
+    return m_reserved_bytes.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get a block for the current frame.
+ *
+ * \param _size     Minimal data size
+ * \return Block
+ */
+ugly::FrameArena::Block* ugly::FrameArena::acquireBlock(size_t _size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Block* block = nullptr;
+    if(m_free_blocks != nullptr && m_free_blocks->size >= _size)
+    {
+        block = m_free_blocks;
+        m_free_blocks = block->next;
+    }
+    else
+    {
+        size_t size = std::max(_size, BLOCK_SIZE);
+        block = static_cast<Block*>(std::malloc(HEADER_SIZE + size));
+        if(block == nullptr)
+            throw std::bad_alloc();
+        block->size = size;
+        m_reserved_bytes.fetch_add(HEADER_SIZE + size, std::memory_order_relaxed);
+    }
+
+    Buffer& buffer = m_buffers[m_current];
+    block->next = nullptr;
+    if(buffer.tail != nullptr)
+        buffer.tail->next = block;
+    else
+        buffer.head = block;
+    buffer.tail = block;
+
+    return block;
+}
+
+
+/**
+ * \brief Get the data of a block.
+ */
+char* ugly::FrameArena::getData(Block* _block)
+{
+    return reinterpret_cast<char*>(_block) + HEADER_SIZE;
+}
@@ -0,0 +1,162 @@
+#include "FramePacer.h"
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::FramePacer::FramePacer()
+{
+}
+
+
+/**
+ * \brief Set target frame time.
+ *
+ * \param _frame_time   Target frame time, 0 to disable the limiter
+ */
+void ugly::FramePacer::setTargetFrameTime(std::chrono::nanoseconds _frame_time)
+{
+    m_target_frame_time = _frame_time;
+    reset();
+}
+
+
+/**
+ * \brief Set target frame rate.
+ *
+ * \param _frame_rate   Target frames per second, 0 to disable the limiter
+ */
+void ugly::FramePacer::setTargetFrameRate(unsigned int _frame_rate)
+{
+    if(_frame_rate == 0)
+        setTargetFrameTime(std::chrono::nanoseconds(0));
+    else
+        setTargetFrameTime(std::chrono::nanoseconds(std::chrono::seconds(1)) / _frame_rate);
+}
+
+
+/**
+ * \brief Get target frame time.
+ *
+ * \return Target frame time, 0 if the limiter is disabled
+ */
+std::chrono::nanoseconds ugly::FramePacer::getTargetFrameTime() const
+{
+    return m_target_frame_time;
+}
+
+
+/**
+ * \brief Set the duration spent spinning before the deadline.
+ * It must be larger than the scheduler wake up latency.
+ *
+ * \param _spin_time    Spin duration
+ */
+void ugly::FramePacer::setSpinTime(std::chrono::nanoseconds _spin_time)
+{
+    m_spin_time = _spin_time;
+}
+
+
+/**
+ * \brief Restart pacing from now and clear statistics.
+ */
+void ugly::FramePacer::reset()
+{
+    m_started = false;
+    m_last_jitter = std::chrono::nanoseconds(0);
+    m_total_jitter = std::chrono::nanoseconds(0);
+    m_max_jitter = std::chrono::nanoseconds(0);
+    m_frame_count = 0;
+    m_missed_frame_count = 0;
+}
+
+
+/**
+ * \brief Wait for the end of the current frame.
+ */
+void ugly::FramePacer::wait()
+{
+    if(m_target_frame_time.count() <= 0)
+        return;
+
+    auto now = Clock::now();
+    if(!m_started)
+    {
+        m_deadline = now;
+        m_started = true;
+    }
+    m_deadline += m_target_frame_time;
+
+    if(now < m_deadline)
+    {
+        // Coarse sleep, then spin for the last part
+        auto remaining = m_deadline - now;
+        if(remaining > m_spin_time)
+            std::this_thread::sleep_for(remaining - m_spin_time);
+
+        while((now = Clock::now()) < m_deadline)
+            std::this_thread::yield();
+    }
+    else
+    {
+        ++m_missed_frame_count;
+    }
+
+    m_last_jitter = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_deadline);
+    m_total_jitter += m_last_jitter;
+    m_max_jitter = std::max(m_max_jitter, m_last_jitter);
+    ++m_frame_count;
+
+    // More than one frame late: restart from now instead of bursting to catch up
+    if(m_last_jitter > m_target_frame_time)
+        m_deadline = now;
+}
+
+
+/**
+ * \brief Get the jitter of the last frame.
+ * The jitter is the difference between the wake up time and the deadline.
+ *
+ * \return Last jitter
+ */
+std::chrono::nanoseconds ugly::FramePacer::getLastJitter() const
+{
+    return m_last_jitter;
+}
+
+
+/**
+ * \brief Get the mean jitter since the last reset.
+ *
+ * \return Mean jitter
+ */
+std::chrono::nanoseconds ugly::FramePacer::getMeanJitter() const
+{
+    if(m_frame_count == 0)
+        return std::chrono::nanoseconds(0);
+
+    return m_total_jitter / m_frame_count;
+}
+
+
+/**
+ * \brief Get the maximum jitter since the last reset.
+ *
+ * \return Maximum jitter
+ */
+std::chrono::nanoseconds ugly::FramePacer::getMaxJitter() const
+{
+    return m_max_jitter;
+}
+
+
+/**
+ * \brief Get the number of frames which missed their deadline since the last reset.
+ *
+ * \return Missed frame count
+ */
+uint64_t ugly::FramePacer::getMissedFrameCount() const
+{
+    return m_missed_frame_count;
+}
@@ -0,0 +1,79 @@
+#include "InputEventQueue.h"
+
+
+/**
+ * \brief Push an event, producer side.
+ *
+ * \param _event    Event
+ * \return False if the queue is full and the event dropped
+ */
+bool ugly::InputEventQueue::push(const InputEvent& _event)
+{
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if(tail - m_cached_head == CAPACITY)
+    {
+        // Refresh the consumer index only when the ring looks full
+        m_cached_head = m_head.load(std::memory_order_acquire);
+        if(tail - m_cached_head == CAPACITY)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    m_events[tail & (CAPACITY - 1)] = _event;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+
+/**
+ * \brief Get the oldest event without removing it, consumer side.
+ *
+ * \return Event, nullptr if the queue is empty
+ */
+const ugly::InputEvent* ugly::InputEventQueue::front()
+{
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    if(head == m_cached_tail)
+    {
+        // Refresh the producer index only when the ring looks empty
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        if(head == m_cached_tail)
+            return nullptr;
+    }
+
+    return &m_events[head & (CAPACITY - 1)];
+}
+
+
+/**
+ * \brief Remove the oldest event, consumer side.
+ * It must follow a front() call which returned an event.
+ */
+void ugly::InputEventQueue::pop()
+{
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+/**
+ * \brief Get the number of dropped events since the creation.
+ *
+ * \return Dropped event count
+ */
+uint64_t ugly::InputEventQueue::getDroppedCount() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get current time in the event time base.
+ *
+ * \return Steady clock time in nanoseconds
+ */
+uint64_t ugly::InputEventQueue::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
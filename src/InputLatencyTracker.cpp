@@ -0,0 +1,85 @@
+#include "InputLatencyTracker.h"
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::InputLatencyTracker::InputLatencyTracker()
+{
+    m_samples.reserve(CAPACITY);
+}
+
+
+/**
+ * \brief Add a latency sample.
+ *
+ * \param _latency  Latency
+ */
+void ugly::InputLatencyTracker::addSample(std::chrono::nanoseconds _latency)
+{
+    uint64_t microseconds = static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(_latency).count(), 0));
+    uint32_t sample = static_cast<uint32_t>(std::min<uint64_t>(microseconds, UINT32_MAX));
+
+    // Overwrite the oldest sample once full
+    if(m_samples.size() < CAPACITY)
+        m_samples.push_back(sample);
+    else
+        m_samples[m_sample_count % CAPACITY] = sample;
+
+    ++m_sample_count;
+}
+
+
+/**
+ * \brief Discard the samples.
+ */
+void ugly::InputLatencyTracker::reset()
+{
+    m_samples.clear();
+    m_sample_count = 0;
+}
+
+
+/**
+ * \brief Get the number of samples since the last reset.
+ *
+ * \return Sample count
+ */
+uint64_t ugly::InputLatencyTracker::getSampleCount() const
+{
+    return m_sample_count;
+}
+
+
+/**
+ * \brief Get a latency percentile of the kept samples.
+ *
+ * \param _percentile   Percentile in [0, 100]
+ * \return Latency, 0 if there is no sample
+ */
+std::chrono::nanoseconds ugly::InputLatencyTracker::getPercentile(double _percentile) const
+{
+    if(m_samples.empty())
+        return std::chrono::nanoseconds(0);
+
+    std::vector<uint32_t> sorted = m_samples;
+    size_t rank = static_cast<size_t>(std::clamp(_percentile, 0.0, 100.0) / 100.0 * (sorted.size() - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return std::chrono::microseconds(sorted[rank]);
+}
+
+
+/**
+ * \brief Log the p50 and p99 latencies.
+ */
+void ugly::InputLatencyTracker::logReport() const
+{
+    if(m_sample_count == 0)
+    {
+        LOG_INFO << "Input latency: no sample";
+        return;
+    }
+
+    LOG_INFO << "Input latency: " << m_sample_count << " samples, p50 " << std::chrono::duration_cast<std::chrono::microseconds>(getPercentile(50.0)).count()
+             << " us, p99 " << std::chrono::duration_cast<std::chrono::microseconds>(getPercentile(99.0)).count() << " us";
+}
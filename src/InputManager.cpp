@@ -1,6 +1,7 @@
 #include "InputManager.h"
 #include "InputButton.h"
 #include "Engine.h"
+#include "BinaryLog.h"
 
 
 /**
@@ -10,7 +11,29 @@ void glfwKeyCallback(GLFWwindow* window, int key, int scancode, int action, int
 {
     static ugly::Engine* engine = ugly::Engine::getInstance();
 
-    engine->getInputManager()->processKeyChange(key, action);
+    engine->getInputManager()->pushKeyEvent(key, action, mods);
+}
+
+
+/**
+ * \brief GLFW mouse button callback.
+ */
+void glfwMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    static ugly::Engine* engine = ugly::Engine::getInstance();
+
+    engine->getInputManager()->pushKeyEvent(ugly::InputManager::mouseButton(button), action, mods);
+}
+
+
+/**
+ * \brief GLFW scroll callback.
+ */
+void glfwScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    static ugly::Engine* engine = ugly::Engine::getInstance();
+
+    engine->getInputManager()->pushScroll(xoffset, yoffset);
 }
 
 
@@ -19,6 +42,7 @@ void glfwKeyCallback(GLFWwindow* window, int key, int scancode, int action, int
  */
 ugly::InputManager::InputManager()
 {
+    m_context_names.push_back("default");
 }
 
 
@@ -30,8 +54,14 @@ bool ugly::InputManager::initialize()
 {
     LOG_INFO << "Initialize input manager...";
     
-    // Register input callbacks
-    glfwSetKeyCallback(ugly::Engine::getInstance()->getWindow(), glfwKeyCallback);
+    // Register input callbacks, headless inputs are injected
+    GLFWwindow* window = ugly::Engine::getInstance()->getWindow();
+    if(window != nullptr)
+    {
+        glfwSetKeyCallback(window, glfwKeyCallback);
+        glfwSetMouseButtonCallback(window, glfwMouseButtonCallback);
+        glfwSetScrollCallback(window, glfwScrollCallback);
+    }
 
     return true;
 }
@@ -43,6 +73,9 @@ bool ugly::InputManager::initialize()
 void ugly::InputManager::shutdown()
 {
     LOG_INFO << "Shutdown input manager...";
+
+    stopRecording();
+    stopReplay();
 }
 
 
@@ -54,52 +87,364 @@ void ugly::InputManager::shutdown()
  */
 void ugly::InputManager::update()
 {
-    for(auto const &button_itor : m_buttons)
+    // Only the buttons changed since the last update have an action to reset
+    for(uint32_t index : m_dirty_buttons)
+        m_actions[index] = InputAction::none;
+    m_dirty_buttons.clear();
+
+    std::copy(m_current_state.begin(), m_current_state.end(), m_previous_state.begin());
+
+    // Mouse and scroll moves were used by this tick, the next one starts from zero
+    m_axis_sources[AXIS_MOUSE_X] = 0.0f;
+    m_axis_sources[AXIS_MOUSE_Y] = 0.0f;
+    m_axis_sources[AXIS_SCROLL_X] = 0.0f;
+    m_axis_sources[AXIS_SCROLL_Y] = 0.0f;
+}
+
+
+/**
+ * \brief Process a key change.
+ * 
+ * This method is mainly used by processEvents().
+ * The key state is updated and the bindings are evaluated.
+ * \param key_name  GLFW key name
+ * \param action    GLFW action
+ * \param mods      GLFW modifier bits, only the lock bits are used, the others come from the key state
+ */
+void ugly::InputManager::processKeyChange(int key_name, int action, int mods)
+{
+    if(key_name < 0 || key_name >= INPUT_CODE_COUNT)
+        return;
+
+    uint64_t bit = uint64_t(1) << (key_name % 64);
+    if(action == GLFW_REPEAT)
     {
-        auto button = (button_itor.second).get();
-        if(button->getAction() == InputAction::pressed || button->getAction() == InputAction::repeated || button->getAction() == InputAction::released)
+        // Repeat the pressed buttons bound to the key
+        for(size_t i = 0; i < m_compiled_buttons.size(); ++i)
         {
-            LOG_DEBUG << "Button: " << button_itor.first << "action is set to NONE";
-            button->setAction(InputAction::none);
+            uint32_t index = m_compiled_buttons[i];
+            bool pressed = (m_current_state[index / 64] >> (index % 64)) & 1;
+            if((m_compiled_keys[i][key_name / 64] & bit) && pressed)
+                setButtonAction(index, InputAction::repeated);
         }
+        return;
     }
+
+    if(action == GLFW_PRESS)
+        m_key_state[key_name / 64] |= bit;
+    else //(action == GLFW_RELEASE)
+        m_key_state[key_name / 64] &= ~bit;
+
+    // Derive the modifiers from the key state, so injected and replayed changes match live ones
+    m_mods = mods & ~BINDING_MODS;
+    if(isKeyDown(GLFW_KEY_LEFT_SHIFT) || isKeyDown(GLFW_KEY_RIGHT_SHIFT))
+        m_mods |= GLFW_MOD_SHIFT;
+    if(isKeyDown(GLFW_KEY_LEFT_CONTROL) || isKeyDown(GLFW_KEY_RIGHT_CONTROL))
+        m_mods |= GLFW_MOD_CONTROL;
+    if(isKeyDown(GLFW_KEY_LEFT_ALT) || isKeyDown(GLFW_KEY_RIGHT_ALT))
+        m_mods |= GLFW_MOD_ALT;
+    if(isKeyDown(GLFW_KEY_LEFT_SUPER) || isKeyDown(GLFW_KEY_RIGHT_SUPER))
+        m_mods |= GLFW_MOD_SUPER;
+
+    evaluateBindings();
 }
 
 
 /**
- * \brief Process a key change.
- * 
- * This method is mainly used by GLFW key callback.
- * If key is not bind, nothing happens.
+ * \brief Queue a timestamped key change.
+ *
+ * This method is used by GLFW key callback, it only writes the event queue.
+ * It must always be called from the same thread, the one polling the events.
  * \param key_name  GLFW key name
  * \param action    GLFW action
+ * \param mods      GLFW modifier bits
+ */
+void ugly::InputManager::pushKeyEvent(int key_name, int action, int mods)
+{
+    InputEvent event;
+    event.timestamp = InputEventQueue::now();
+    event.key_name = static_cast<int16_t>(key_name);
+    event.action = static_cast<uint8_t>(action);
+    event.mods = static_cast<uint8_t>(mods);
+    m_event_queue.push(event);
+}
+
+
+/**
+ * \brief Queue a scroll offset.
+ *
+ * This method is used by GLFW scroll callback, it only writes a counter of the polling thread
+ * which pollDevices() moves to the scroll sources.
+ * \param xoffset   Horizontal scroll offset
+ * \param yoffset   Vertical scroll offset
+ */
+void ugly::InputManager::pushScroll(double xoffset, double yoffset)
+{
+    m_scroll_offset.x += xoffset;
+    m_scroll_offset.y += yoffset;
+}
+
+
+/**
+ * \brief Inject a key change.
+ *
+ * The change is queued like a GLFW event, timestamped now, and processed by the first tick ending
+ * after it: the next tick when headless, possibly a later one when the simulation is ahead of the clock.
+ * It must be called from the thread polling the events, the main thread.
+ * \param key_name  GLFW key name
+ * \param action    GLFW action
+ */
+void ugly::InputManager::injectKeyChange(int key_name, int action)
+{
+    InputEvent event;
+    event.timestamp = InputEventQueue::now();
+    event.key_name = static_cast<int16_t>(key_name);
+    event.action = static_cast<uint8_t>(action);
+    event.mods = 0;
+    m_event_queue.push(event);
+}
+
+
+/**
+ * \brief Poll the mouse, the scroll and the gamepads.
+ *
+ * The engine calls it once per frame after the window events. Gamepad button changes are
+ * queued like key changes. Mouse and scroll moves accumulate until a tick uses them, the
+ * axes are processed at the start of each tick by processEvents().
+ */
+void ugly::InputManager::pollDevices()
+{
+    GLFWwindow* window = Engine::getInstance()->getWindow();
+    if(window != nullptr)
+    {
+        // Mouse move since the last poll, added to the moves not used by a tick yet
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
+        if(m_cursor_position_valid)
+        {
+            m_axis_sources[AXIS_MOUSE_X] += static_cast<float>(x - m_cursor_position.x);
+            m_axis_sources[AXIS_MOUSE_Y] += static_cast<float>(y - m_cursor_position.y);
+        }
+        m_cursor_position = glm::dvec2(x, y);
+        m_cursor_position_valid = true;
+
+        // One state read per connected gamepad
+        uint32_t connected_gamepads = 0;
+        uint32_t gamepad_buttons = 0;
+        for(int gamepad = 0; gamepad < GAMEPAD_COUNT; ++gamepad)
+        {
+            GLFWgamepadstate state;
+            if(!glfwJoystickIsGamepad(gamepad) || !glfwGetGamepadState(gamepad, &state))
+            {
+                if(m_connected_gamepads & (1u << gamepad))
+                    std::fill_n(&m_axis_sources[gamepadAxis(gamepad, 0)], GAMEPAD_AXIS_COUNT, 0.0f);
+                continue;
+            }
+
+            connected_gamepads |= 1u << gamepad;
+            for(int button = 0; button <= GLFW_GAMEPAD_BUTTON_LAST; ++button)
+            {
+                if(state.buttons[button] == GLFW_PRESS)
+                    gamepad_buttons |= 1u << button;
+            }
+            std::copy_n(state.axes, GAMEPAD_AXIS_COUNT, &m_axis_sources[gamepadAxis(gamepad, 0)]);
+        }
+
+        if(connected_gamepads != m_connected_gamepads)
+        {
+            LOG_INFO << "Connected gamepads: " << connected_gamepads;
+            m_connected_gamepads = connected_gamepads;
+        }
+
+        // Gamepad button changes go through the event queue, like keys
+        uint32_t changed_buttons = gamepad_buttons ^ m_gamepad_buttons;
+        for(int button = 0; changed_buttons != 0; ++button, changed_buttons >>= 1)
+        {
+            if(changed_buttons & 1)
+                pushKeyEvent(gamepadButton(button), (gamepad_buttons >> button) & 1 ? GLFW_PRESS : GLFW_RELEASE, 0);
+        }
+        m_gamepad_buttons = gamepad_buttons;
+    }
+
+    m_axis_sources[AXIS_SCROLL_X] += static_cast<float>(m_scroll_offset.x);
+    m_axis_sources[AXIS_SCROLL_Y] += static_cast<float>(m_scroll_offset.y);
+    m_scroll_offset = glm::dvec2(0.0, 0.0);
+}
+
+
+/**
+ * \brief Inject an axis source value, used instead of the devices when headless.
+ * Mouse and scroll sources accumulate until the end of the next tick.
+ * It must be called from the thread polling the events, the main thread.
+ *
+ * \param source    Axis source
+ * \param value     Value
  */
-void ugly::InputManager::processKeyChange(int key_name, int action)
+void ugly::InputManager::injectAxisValue(int source, float value)
 {
-    // Check if key is binded
-    auto key_button_mapping_itor = m_key_button_mapping.find(key_name);
-    if(key_button_mapping_itor == m_key_button_mapping.end())
+    if(source < 0 || source >= AXIS_SOURCE_COUNT)
+    {
+        LOG_ERROR << "Invalid axis source: " << source;
         return;
+    }
 
-    // Update button
-    auto button = (m_buttons[key_button_mapping_itor->second]).get();
-    if(action == GLFW_PRESS)
+    if(source < AXIS_GAMEPAD_BASE)
+        m_axis_sources[source] += value;
+    else
+        m_axis_sources[source] = value;
+}
+
+
+/**
+ * \brief Process the queued key changes which happened before a time, then the axes.
+ *
+ * The engine calls it at the start of each simulation tick with the end time of the tick,
+ * so events keep their sub-frame position when several ticks run in the same frame.
+ * \param until     Steady clock time in nanoseconds, see InputEventQueue::now()
+ */
+void ugly::InputManager::processEvents(uint64_t until)
+{
+    uint64_t tick = Engine::getInstance()->getTickCount();
+
+    if(m_recorder.get() != nullptr && m_recording_start_tick == UNKNOWN_TICK)
+        m_recording_start_tick = tick;
+
+    const InputEvent* event;
+    while((event = m_event_queue.front()) != nullptr && event->timestamp <= until)
     {
-        LOG_DEBUG << "Button: " << key_button_mapping_itor->second << " is pressed";
-        button->setState(InputState::press);
-        button->setAction(InputAction::pressed);
+        // Live changes are ignored during a replay
+        if(m_replay.get() == nullptr)
+        {
+            if(m_recorder.get() != nullptr)
+                m_recorder->record(static_cast<uint32_t>(tick - m_recording_start_tick), event->key_name, event->action, event->mods);
+
+            processKeyChange(event->key_name, event->action, event->mods);
+
+            // Events are in time order, the first one is the oldest
+            if(m_input_time == 0)
+                m_input_time = event->timestamp;
+        }
+        m_event_queue.pop();
     }
-    else if(action == GLFW_REPEAT)
+
+    if(m_replay.get() != nullptr)
     {
-        LOG_DEBUG << "Button: " << key_button_mapping_itor->second << " is repeated";
-        button->setAction(InputAction::repeated);
+        if(m_replay_start_tick == UNKNOWN_TICK)
+            m_replay_start_tick = tick;
+
+        uint32_t replay_tick = static_cast<uint32_t>(tick - m_replay_start_tick);
+        while(const InputRecord* record = m_replay->next(replay_tick))
+        {
+            if(m_recorder.get() != nullptr)
+                m_recorder->record(static_cast<uint32_t>(tick - m_recording_start_tick), record->key_name, record->action, record->mods);
+
+            processKeyChange(record->key_name, record->action, record->mods);
+        }
+
+        if(m_replay->isFinished())
+        {
+            LOG_INFO << "Input replay finished at tick " << replay_tick;
+            stopReplay();
+        }
     }
-    else //(action == GLFW_RELEASE)
+
+    uint64_t dropped = m_event_queue.getDroppedCount();
+    if(dropped != m_reported_dropped_events)
     {
-        LOG_DEBUG << "Button: " << key_button_mapping_itor->second << " is released";
-        button->setState(InputState::release);
-        button->setAction(InputAction::released);
+        LOG_WARNING << "Input event queue is full, " << dropped - m_reported_dropped_events << " events dropped";
+        m_reported_dropped_events = dropped;
     }
+
+    processAxes();
+}
+
+
+/**
+ * \brief Get and clear the time of the oldest key change processed since the last call.
+ * The engine calls it after each present to measure the input latency.
+ *
+ * \return Steady clock time in nanoseconds, 0 if no key change was processed
+ */
+uint64_t ugly::InputManager::consumeInputTime()
+{
+    uint64_t input_time = m_input_time;
+    m_input_time = 0;
+    return input_time;
+}
+
+
+/**
+ * \brief Start recording the processed key changes.
+ * Each change is written with its tick, counted from the first tick after this call.
+ *
+ * \param filename  Recording file name
+ * \return False if error
+ */
+bool ugly::InputManager::startRecording(const std::string& filename)
+{
+    std::unique_ptr<InputRecorder> recorder = std::make_unique<InputRecorder>();
+    if(!recorder->open(filename, Engine::getInstance()->getTickRate()))
+        return false;
+
+    m_recorder = std::move(recorder);
+    m_recording_start_tick = UNKNOWN_TICK;
+    return true;
+}
+
+
+/**
+ * \brief Stop recording and close the file.
+ */
+void ugly::InputManager::stopRecording()
+{
+    if(m_recorder.get() != nullptr)
+    {
+        m_recorder->close();
+        m_recorder.reset(nullptr);
+    }
+}
+
+
+/**
+ * \brief Start replaying a recording.
+ * Recorded changes go through processKeyChange() at their tick, counted from the first
+ * tick after this call. Key changes from the window are ignored during the replay.
+ *
+ * \param filename  Recording file name
+ * \return False if error
+ */
+bool ugly::InputManager::startReplay(const std::string& filename)
+{
+    std::unique_ptr<InputReplay> replay = std::make_unique<InputReplay>();
+    if(!replay->load(filename))
+        return false;
+
+    if(replay->getTickRate() != Engine::getInstance()->getTickRate())
+        LOG_WARNING << "Input recording tick rate " << replay->getTickRate() << " differs from engine tick rate " << Engine::getInstance()->getTickRate();
+
+    m_replay = std::move(replay);
+    m_replay_start_tick = UNKNOWN_TICK;
+    return true;
+}
+
+
+/**
+ * \brief Stop replaying.
+ */
+void ugly::InputManager::stopReplay()
+{
+    m_replay.reset(nullptr);
+}
+
+
+/**
+ * \brief Check if a replay is running.
+ *
+ * \return True if replaying
+ */
+bool ugly::InputManager::isReplaying() const
+{
+    return m_replay.get() != nullptr;
 }
 
 
@@ -107,86 +452,770 @@ void ugly::InputManager::processKeyChange(int key_name, int action)
  * \brief Create a button.
  * 
  * \param button_name   InputButton name
+ * \return Button handle, invalid if error
  */
-void ugly::InputManager::createButton(const std::string& button_name)
+ugly::InputButtonHandle ugly::InputManager::createButton(const std::string& button_name)
 {
     PLOG_INFO << "Create input button: " << button_name;
 
-    auto button_map_itor = m_buttons.find(button_name);
-    if( button_map_itor != m_buttons.end())
+    InputActionId action_id = makeInputActionId(button_name);
+    InputButtonHandle existing = getButtonHandle(action_id);
+    if(existing.isValid())
     {
-        PLOG_ERROR << "Trying to create a button already existing: " << button_name;
-        return;
+        if(m_button_names[existing.index] == button_name)
+            PLOG_ERROR << "Trying to create a button already existing: " << button_name;
+        else
+            PLOG_ERROR << "Button: " << button_name << " has the same identifier as button: " << m_button_names[existing.index];
+        return InputButtonHandle();
+    }
+
+    uint32_t index = static_cast<uint32_t>(m_actions.size());
+    m_actions.push_back(InputAction::none);
+    m_dirty_buttons.reserve(m_actions.size());
+    if(index % 64 == 0)
+    {
+        m_current_state.push_back(0);
+        m_previous_state.push_back(0);
+        m_evaluated_state.push_back(0);
     }
+    m_button_names.push_back(button_name);
+    m_button_ids.push_back(action_id);
+    insertButtonId(index);
 
-    m_buttons.insert(std::make_pair(button_name, std::make_unique<InputButton>()));
+    InputButtonHandle handle;
+    handle.index = index;
+    return handle;
 }
 
 
 /**
  * \brief Bind a key to a button.
+ * A key may be bound to several buttons, and a button to several keys.
  * 
  * \param key_name      GFLW key name
- * \param button_name   Button name
+ * \param button        Button handle
+ * \param mods          Modifiers which must be held, GLFW_MOD_SHIFT, GLFW_MOD_CONTROL, GLFW_MOD_ALT or GLFW_MOD_SUPER
+ * \param context       Binding context
  */
-void ugly::InputManager::bindKeyToButton(int key_name, const std::string& button_name)
+void ugly::InputManager::bindKeyToButton(int key_name, InputButtonHandle button, int mods, uint32_t context)
+{
+    bindChordToButton({key_name}, button, mods, context);
+}
+
+
+/**
+ * \brief Bind a chord of keys to a button.
+ * The button is pressed while all the keys and the modifiers are held. A binding with
+ * modifiers hides the bindings without modifiers of the same keys while it is held.
+ * 
+ * \param key_names     GFLW key names
+ * \param button        Button handle
+ * \param mods          Modifiers which must be held
+ * \param context       Binding context
+ */
+void ugly::InputManager::bindChordToButton(const std::vector<int>& key_names, InputButtonHandle button, int mods, uint32_t context)
+{
+    if(!button.isValid() || button.index >= m_actions.size())
+    {
+        LOG_ERROR << "Invalid button handle";
+        return;
+    }
+
+    if(context >= m_context_names.size())
+    {
+        LOG_ERROR << "Invalid binding context: " << context;
+        return;
+    }
+
+    if(key_names.empty() || (mods & ~BINDING_MODS) != 0)
+    {
+        LOG_ERROR << "Invalid chord for input button: " << m_button_names[button.index];
+        return;
+    }
+
+    Binding binding;
+    binding.keys.fill(0);
+    binding.mods = mods;
+    binding.context = context;
+    binding.button = button.index;
+    for(int key_name : key_names)
+    {
+        LOG_INFO << "Bind key: " <<  key_name << " (mods " << mods << ", context " << m_context_names[context] << ") to input button: " << m_button_names[button.index]; 
+
+        if(key_name < 0 || key_name >= INPUT_CODE_COUNT)
+        {
+            LOG_ERROR << "Invalid key: " << key_name;
+            return;
+        }
+
+        binding.keys[key_name / 64] |= uint64_t(1) << (key_name % 64);
+    }
+
+    m_bindings.push_back(binding);
+    compileBindings();
+}
+
+
+/**
+ * \brief Remove all the bindings of a button.
+ *
+ * \param button        Button handle
+ */
+void ugly::InputManager::unbindButton(InputButtonHandle button)
+{
+    auto end = std::remove_if(m_bindings.begin(), m_bindings.end(), [button](const Binding& _binding) { return _binding.button == button.index; });
+    if(end == m_bindings.end())
+        return;
+
+    m_bindings.erase(end, m_bindings.end());
+    compileBindings();
+}
+
+
+/**
+ * \brief Create an axis.
+ * The source value is remapped outside of the dead zone and shaped by the response curve:
+ * v = sign(x) * max(|x| - dead_zone, 0) / (1 - dead_zone), value = (1 - curve) * v + curve * v^3.
+ *
+ * \param axis_name     Axis name
+ * \param source        Axis source, AXIS_MOUSE_X, AXIS_MOUSE_Y, AXIS_SCROLL_X, AXIS_SCROLL_Y or gamepadAxis()
+ * \param dead_zone     Dead zone in [0, 1)
+ * \param curve         Cubic blend factor in [0, 1], 0 for a linear response
+ * \return Axis handle, invalid if error
+ */
+ugly::InputAxisHandle ugly::InputManager::createAxis(const std::string& axis_name, int source, float dead_zone, float curve)
+{
+    PLOG_INFO << "Create input axis: " << axis_name;
+
+    InputActionId action_id = makeInputActionId(axis_name);
+    if(getAxisHandle(action_id).isValid())
+    {
+        PLOG_ERROR << "Trying to create an axis already existing: " << axis_name;
+        return InputAxisHandle();
+    }
+
+    if(source < 0 || source >= AXIS_SOURCE_COUNT)
+    {
+        LOG_ERROR << "Invalid axis source: " << source;
+        return InputAxisHandle();
+    }
+
+    if(dead_zone < 0.0f || dead_zone >= 1.0f || curve < 0.0f || curve > 1.0f)
+    {
+        LOG_ERROR << "Invalid response for axis: " << axis_name;
+        return InputAxisHandle();
+    }
+
+    InputAxisHandle handle;
+    handle.index = static_cast<uint32_t>(m_axis_values.size());
+    m_axis_names.push_back(axis_name);
+    m_axis_ids.push_back(action_id);
+    m_axis_source_indices.push_back(source);
+    m_axis_dead_zones.push_back(dead_zone);
+    m_axis_scales.push_back(1.0f / (1.0f - dead_zone));
+    m_axis_curves.push_back(curve);
+    m_axis_raw_values.push_back(0.0f);
+    m_axis_values.push_back(0.0f);
+    return handle;
+}
+
+
+/**
+ * \brief Get an axis handle.
+ *
+ * \param action_id     Axis identifier, see makeInputActionId()
+ * \return Axis handle, invalid if not found
+ */
+ugly::InputAxisHandle ugly::InputManager::getAxisHandle(InputActionId action_id) const
+{
+    InputAxisHandle handle;
+    auto itor = std::find(m_axis_ids.begin(), m_axis_ids.end(), action_id);
+    if(itor != m_axis_ids.end())
+        handle.index = static_cast<uint32_t>(itor - m_axis_ids.begin());
+
+    return handle;
+}
+
+
+/**
+ * \brief Get an axis value.
+ *
+ * \param axis          Axis handle
+ * \return Processed value of the current tick, 0 if invalid
+ */
+float ugly::InputManager::getAxisValue(InputAxisHandle axis) const
+{
+    if(axis.index >= m_axis_values.size())
+        return 0.0f;
+
+    return m_axis_values[axis.index];
+}
+
+
+/**
+ * \brief Get the values of all the axes, indexed by handle.
+ *
+ * \return getAxisCount() values
+ */
+const float* ugly::InputManager::getAxisValues() const
+{
+    return m_axis_values.data();
+}
+
+
+/**
+ * \brief Get the number of axes.
+ *
+ * \return Axis count
+ */
+size_t ugly::InputManager::getAxisCount() const
 {
-    LOG_INFO << "Bind key: " <<  key_name << " to input button: " << button_name; 
+    return m_axis_values.size();
+}
+
+
+/**
+ * \brief Get the connected gamepads.
+ *
+ * \return Bit j is set if the joystick j is a connected gamepad
+ */
+uint32_t ugly::InputManager::getConnectedGamepads() const
+{
+    return m_connected_gamepads;
+}
+
+
+/**
+ * \brief Create a binding context.
+ * Contexts are layers: a key bound in an enabled context hides the bindings of this key
+ * in the contexts created before it. New contexts are disabled.
+ *
+ * \param context_name  Context name
+ * \return Context index, INVALID_CONTEXT if error
+ */
+uint32_t ugly::InputManager::createContext(const std::string& context_name)
+{
+    LOG_INFO << "Create input context: " << context_name;
+
+    if(std::find(m_context_names.begin(), m_context_names.end(), context_name) != m_context_names.end())
+    {
+        LOG_ERROR << "Trying to create an input context already existing: " << context_name;
+        return INVALID_CONTEXT;
+    }
+
+    if(m_context_names.size() >= MAX_CONTEXTS)
+    {
+        LOG_ERROR << "Too many input contexts";
+        return INVALID_CONTEXT;
+    }
 
-    auto key_button_mapping_itor = m_key_button_mapping.find(key_name);
-    if(key_button_mapping_itor != m_key_button_mapping.end())
+    m_context_names.push_back(context_name);
+    return static_cast<uint32_t>(m_context_names.size() - 1);
+}
+
+
+/**
+ * \brief Enable or disable a binding context.
+ * Buttons bound only in a disabled context are released.
+ *
+ * \param context       Context index
+ * \param enabled       Enable flag
+ */
+void ugly::InputManager::setContextEnabled(uint32_t context, bool enabled)
+{
+    if(context >= m_context_names.size() || context == DEFAULT_CONTEXT)
     {
-        LOG_ERROR << "Key is already bind to button: " << key_button_mapping_itor->second;
+        LOG_ERROR << "Invalid binding context: " << context;
         return;
     }
 
-    auto button_itor = m_buttons.find(button_name);
-    if(button_itor == m_buttons.end())
+    uint32_t enabled_contexts = enabled ? m_enabled_contexts | (1u << context) : m_enabled_contexts & ~(1u << context);
+    if(enabled_contexts == m_enabled_contexts)
+        return;
+
+    m_enabled_contexts = enabled_contexts;
+    compileBindings();
+}
+
+
+/**
+ * \brief Check if a binding context is enabled.
+ *
+ * \param context       Context index
+ * \return True if enabled
+ */
+bool ugly::InputManager::isContextEnabled(uint32_t context) const
+{
+    return context < MAX_CONTEXTS && (m_enabled_contexts >> context) & 1;
+}
+
+
+/**
+ * \brief Check if a key is held.
+ *
+ * \param key_name      GLFW key name
+ * \return True if held
+ */
+bool ugly::InputManager::isKeyDown(int key_name) const
+{
+    if(key_name < 0 || key_name >= INPUT_CODE_COUNT)
+        return false;
+
+    return (m_key_state[key_name / 64] >> (key_name % 64)) & 1;
+}
+
+
+/**
+ * \brief Bind a key to a button.
+ * The button is created if it does not exist.
+ * 
+ * \param key_name      GFLW key name
+ * \param button_name   Button name
+ */
+void ugly::InputManager::bindKeyToButton(int key_name, const std::string& button_name)
+{
+    InputButtonHandle button = getButtonHandle(button_name);
+    if(!button.isValid())
     {
         LOG_ERROR << "Button: " << button_name << " not found. Creating it";
-        createButton(button_name);
+        button = createButton(button_name);
+    }
+
+    bindKeyToButton(key_name, button);
+}
+
+
+/**
+ * \brief Get a button handle.
+ * Gameplay code should resolve handles once and poll with them.
+ *
+ * \param action_id     Action identifier, see makeInputActionId()
+ * \return Button handle, invalid if not found
+ */
+ugly::InputButtonHandle ugly::InputManager::getButtonHandle(InputActionId action_id) const
+{
+    InputButtonHandle handle;
+    if(m_id_table.empty())
+        return handle;
+
+    // Linear probing, the table is never more than half full
+    size_t mask = m_id_table.size() - 1;
+    for(size_t slot = action_id & mask; m_id_table[slot] != 0; slot = (slot + 1) & mask)
+    {
+        uint32_t index = m_id_table[slot] - 1;
+        if(m_button_ids[index] == action_id)
+        {
+            handle.index = index;
+            break;
+        }
     }
 
-    m_key_button_mapping[key_name] = button_name;
+    return handle;
+}
+
+
+/**
+ * \brief Get a button handle.
+ *
+ * \param button_name   InputButton name
+ * \return Button handle, invalid if not found
+ */
+ugly::InputButtonHandle ugly::InputManager::getButtonHandle(const std::string& button_name) const
+{
+    return getButtonHandle(makeInputActionId(button_name));
+}
+
+
+/**
+ * \brief Get a button name.
+ *
+ * \param button        Button handle
+ * \return Button name, empty if invalid
+ */
+const std::string& ugly::InputManager::getButtonName(InputButtonHandle button) const
+{
+    static const std::string empty;
+    if(button.index >= m_button_names.size())
+        return empty;
+
+    return m_button_names[button.index];
+}
+
+
+/**
+ * \brief Get the number of buttons.
+ *
+ * \return Button count
+ */
+size_t ugly::InputManager::getButtonCount() const
+{
+    return m_actions.size();
 }
 
 
 /**
  * \brief Get a button state.
  * 
- * \param button_name   InputButton name
- * \return InputButton state
+ * \param button        Button handle
+ * \return InputButton state, release if invalid
  */
-const ugly::InputState& ugly::InputManager::getButtonState(const std::string& button_name)
+ugly::InputState ugly::InputManager::getButtonState(InputButtonHandle button) const
 {
-    auto button_map_itor = m_buttons.find(button_name);
-    if(button_map_itor == m_buttons.end())
+    if(button.index >= m_actions.size())
+        return InputState::release;
+
+    return (m_current_state[button.index / 64] >> (button.index % 64)) & 1 ? InputState::press : InputState::release;
+}
+
+
+/**
+ * \brief Get a button action.
+ * 
+ * \param button        Button handle
+ * \return InputButton last action, none if invalid
+ */
+ugly::InputAction ugly::InputManager::getButtonAction(InputButtonHandle button) const
+{
+    if(button.index >= m_actions.size())
+        return InputAction::none;
+
+    return m_actions[button.index];
+}
+
+
+/**
+ * \brief Check if a button went from release to press since the last update.
+ *
+ * \param button        Button handle
+ * \return True if pressed
+ */
+bool ugly::InputManager::wasButtonPressed(InputButtonHandle button) const
+{
+    if(button.index >= m_actions.size())
+        return false;
+
+    size_t word = button.index / 64;
+    return ((m_current_state[word] & ~m_previous_state[word]) >> (button.index % 64)) & 1;
+}
+
+
+/**
+ * \brief Check if a button went from press to release since the last update.
+ *
+ * \param button        Button handle
+ * \return True if released
+ */
+bool ugly::InputManager::wasButtonReleased(InputButtonHandle button) const
+{
+    if(button.index >= m_actions.size())
+        return false;
+
+    size_t word = button.index / 64;
+    return ((m_previous_state[word] & ~m_current_state[word]) >> (button.index % 64)) & 1;
+}
+
+
+/**
+ * \brief Get the number of 64 bits words of the state bitsets.
+ *
+ * \return Word count
+ */
+size_t ugly::InputManager::getStateWordCount() const
+{
+    return m_current_state.size();
+}
+
+
+/**
+ * \brief Get the current state bitset, bit i is set if the button of index i is pressed.
+ *
+ * \return getStateWordCount() words
+ */
+const uint64_t* ugly::InputManager::getCurrentState() const
+{
+    return m_current_state.data();
+}
+
+
+/**
+ * \brief Get the state bitset snapshot taken by the last update.
+ *
+ * \return getStateWordCount() words
+ */
+const uint64_t* ugly::InputManager::getPreviousState() const
+{
+    return m_previous_state.data();
+}
+
+
+/**
+ * \brief Compute the pressed and released edges of all buttons since the last update.
+ *
+ * \param _pressed      getStateWordCount() words receiving the buttons which went from release to press
+ * \param _released     getStateWordCount() words receiving the buttons which went from press to release
+ */
+void ugly::InputManager::computeEdges(uint64_t* _pressed, uint64_t* _released) const
+{
+    for(size_t i = 0; i < m_current_state.size(); ++i)
     {
-        LOG_WARNING << "InputButton: " << button_name << " not found.";
-        createButton(button_name);
-        button_map_itor = m_buttons.find(button_name);
+        uint64_t changed = m_current_state[i] ^ m_previous_state[i];
+        _pressed[i] = changed & m_current_state[i];
+        _released[i] = changed & m_previous_state[i];
     }
+}
+
+
+/**
+ * \brief Get a button state.
+ * 
+ * \param action_id     Action identifier
+ * \return InputButton state, release if not found
+ */
+ugly::InputState ugly::InputManager::getButtonState(InputActionId action_id)
+{
+    InputButtonHandle button = getButtonHandle(action_id);
+    if(!button.isValid())
+        reportMissingButton(action_id);
 
-    return button_map_itor->second.get()->getState();
+    return getButtonState(button);
 }
 
 
 /**
  * \brief Get a button action.
  * 
+ * \param action_id     Action identifier
+ * \return InputButton last action, none if not found
+ */
+ugly::InputAction ugly::InputManager::getButtonAction(InputActionId action_id)
+{
+    InputButtonHandle button = getButtonHandle(action_id);
+    if(!button.isValid())
+        reportMissingButton(action_id);
+
+    return getButtonAction(button);
+}
+
+
+/**
+ * \brief Get a button state.
+ * Slow path, the name is hashed on each call.
+ * 
+ * \param button_name   InputButton name
+ * \return InputButton state, release if not found
+ */
+ugly::InputState ugly::InputManager::getButtonState(const std::string& button_name)
+{
+    InputActionId action_id = makeInputActionId(button_name);
+    InputButtonHandle button = getButtonHandle(action_id);
+    if(!button.isValid())
+        reportMissingButton(action_id, button_name);
+
+    return getButtonState(button);
+}
+
+
+/**
+ * \brief Get a button action.
+ * Slow path, the name is hashed on each call.
+ * 
  * \param button_name   InputButton name
- * \return InputButton last action
+ * \return InputButton last action, none if not found
  */
-const ugly::InputAction& ugly::InputManager::getButtonAction(const std::string& button_name)
+ugly::InputAction ugly::InputManager::getButtonAction(const std::string& button_name)
 {
-    auto button_map_itor = m_buttons.find(button_name);
-    if (button_map_itor == m_buttons.end())
+    InputActionId action_id = makeInputActionId(button_name);
+    InputButtonHandle button = getButtonHandle(action_id);
+    if(!button.isValid())
+        reportMissingButton(action_id, button_name);
+
+    return getButtonAction(button);
+}
+
+
+/**
+ * \brief Apply the dead zones and the response curves to all the axes.
+ */
+void ugly::InputManager::processAxes()
+{
+    size_t count = m_axis_values.size();
+
+    // Gather the sources, then process contiguous arrays without branches
+    for(size_t i = 0; i < count; ++i)
+        m_axis_raw_values[i] = m_axis_sources[m_axis_source_indices[i]];
+
+    const float* raw = m_axis_raw_values.data();
+    const float* dead_zones = m_axis_dead_zones.data();
+    const float* scales = m_axis_scales.data();
+    const float* curves = m_axis_curves.data();
+    float* values = m_axis_values.data();
+    for(size_t i = 0; i < count; ++i)
     {
-        LOG_WARNING << "InputButton: " << button_name << " not found.";
-        createButton(button_name);
-        button_map_itor = m_buttons.find(button_name);
+        float magnitude = std::max(std::fabs(raw[i]) - dead_zones[i], 0.0f) * scales[i];
+        float value = std::copysign(magnitude, raw[i]);
+        values[i] = value * ((1.0f - curves[i]) + curves[i] * value * value);
     }
+}
+
 
-    return button_map_itor->second.get()->getAction();
+/**
+ * \brief Compile the bindings of the enabled contexts and evaluate them.
+ */
+void ugly::InputManager::compileBindings()
+{
+    m_compiled_keys.clear();
+    m_compiled_mods.clear();
+    m_compiled_buttons.clear();
+
+    // Walk the layers from the top, keys bound in an enabled layer are hidden below it
+    KeySet hidden_keys {};
+    for(uint32_t context = static_cast<uint32_t>(m_context_names.size()); context-- > 0;)
+    {
+        if(!isContextEnabled(context))
+            continue;
+
+        KeySet context_keys {};
+        for(const Binding& binding : m_bindings)
+        {
+            if(binding.context != context)
+                continue;
+
+            uint64_t hidden = 0;
+            for(size_t w = 0; w < KEY_WORDS; ++w)
+            {
+                hidden |= binding.keys[w] & hidden_keys[w];
+                context_keys[w] |= binding.keys[w];
+            }
+            if(hidden != 0)
+                continue;
+
+            m_compiled_keys.push_back(binding.keys);
+            m_compiled_mods.push_back(binding.mods);
+            m_compiled_buttons.push_back(binding.button);
+        }
+
+        for(size_t w = 0; w < KEY_WORDS; ++w)
+            hidden_keys[w] |= context_keys[w];
+    }
+
+    m_compiled_matches.resize(m_compiled_buttons.size());
+    evaluateBindings();
+}
+
+
+/**
+ * \brief Evaluate the compiled bindings and update the button states and actions.
+ */
+void ugly::InputManager::evaluateBindings()
+{
+    size_t count = m_compiled_buttons.size();
+
+    // Bindings with all their keys and modifiers held
+    for(size_t i = 0; i < count; ++i)
+    {
+        uint64_t missing = 0;
+        for(size_t w = 0; w < KEY_WORDS; ++w)
+            missing |= m_compiled_keys[i][w] & ~m_key_state[w];
+        m_compiled_matches[i] = missing == 0 && (m_compiled_mods[i] & ~m_mods) == 0;
+    }
+
+    // Keys of the matching bindings with modifiers
+    KeySet chord_keys {};
+    for(size_t i = 0; i < count; ++i)
+    {
+        uint64_t mask = (m_compiled_matches[i] && m_compiled_mods[i] != 0) ? ~uint64_t(0) : 0;
+        for(size_t w = 0; w < KEY_WORDS; ++w)
+            chord_keys[w] |= m_compiled_keys[i][w] & mask;
+    }
+
+    // Button states, the bindings without modifiers are hidden by the matching chords
+    std::fill(m_evaluated_state.begin(), m_evaluated_state.end(), 0);
+    for(size_t i = 0; i < count; ++i)
+    {
+        uint64_t hidden = 0;
+        if(m_compiled_mods[i] == 0)
+        {
+            for(size_t w = 0; w < KEY_WORDS; ++w)
+                hidden |= m_compiled_keys[i][w] & chord_keys[w];
+        }
+
+        if(m_compiled_matches[i] && hidden == 0)
+            m_evaluated_state[m_compiled_buttons[i] / 64] |= uint64_t(1) << (m_compiled_buttons[i] % 64);
+    }
+
+    // Actions of the changed buttons
+    for(size_t w = 0; w < m_current_state.size(); ++w)
+    {
+        uint64_t changed = m_current_state[w] ^ m_evaluated_state[w];
+        while(changed != 0)
+        {
+            uint32_t bit = 0;
+            while(((changed >> bit) & 1) == 0)
+                ++bit;
+            changed &= changed - 1;
+
+            uint32_t index = static_cast<uint32_t>(w * 64 + bit);
+            setButtonAction(index, (m_evaluated_state[w] >> bit) & 1 ? InputAction::pressed : InputAction::released);
+        }
+        m_current_state[w] = m_evaluated_state[w];
+    }
+}
+
+
+/**
+ * \brief Set a button action and mark it changed.
+ *
+ * \param index     Button index
+ * \param action    Action
+ */
+void ugly::InputManager::setButtonAction(uint32_t index, InputAction action)
+{
+    // A button without action is not in the dirty list yet
+    if(m_actions[index] == InputAction::none)
+        m_dirty_buttons.push_back(index);
+
+    m_actions[index] = action;
+    UGLY_BLOG_DEBUG("Button: {} is {}", m_button_names[index], action == InputAction::pressed ? "pressed" : action == InputAction::repeated ? "repeated" : "released");
 }
 
+
+/**
+ * \brief Insert a button in the identifier table.
+ *
+ * \param index     Button index
+ */
+void ugly::InputManager::insertButtonId(uint32_t index)
+{
+    // Keep the table at most half full, rebuild it when it grows
+    if(m_actions.size() * 2 > m_id_table.size())
+    {
+        m_id_table.assign(std::max<size_t>(16, m_id_table.size() * 2), 0);
+        for(uint32_t i = 0; i < index; ++i)
+            insertButtonId(i);
+    }
+
+    size_t mask = m_id_table.size() - 1;
+    size_t slot = m_button_ids[index] & mask;
+    while(m_id_table[slot] != 0)
+        slot = (slot + 1) & mask;
+
+    m_id_table[slot] = index + 1;
+}
+
+
+/**
+ * \brief Report a lookup of an unknown button, once per identifier.
+ *
+ * \param action_id     Action identifier
+ * \param button_name   Button name if known
+ */
+void ugly::InputManager::reportMissingButton(InputActionId action_id, const std::string& button_name)
+{
+    if(!m_reported_missing_buttons.insert(action_id).second)
+        return;
+
+    if(button_name.empty())
+        LOG_WARNING << "InputButton with identifier: " << action_id << " not found.";
+    else
+        LOG_WARNING << "InputButton: " << button_name << " not found.";
+}
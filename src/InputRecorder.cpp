@@ -0,0 +1,111 @@
+#include "InputRecorder.h"
+
+
+/**
+ * \brief Destructor, close the file.
+ */
+ugly::InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+
+/**
+ * \brief Open the recording file.
+ *
+ * \param _filename     File name
+ * \param _tick_rate    Simulation tick rate
+ * \return False if error
+ */
+bool ugly::InputRecorder::open(const std::string& _filename, uint32_t _tick_rate)
+{
+    close();
+
+    m_file.open(_filename, std::ios::binary | std::ios::trunc);
+    if(!m_file.is_open())
+    {
+        LOG_ERROR << "Cannot open input recording: " << _filename;
+        return false;
+    }
+
+    InputRecordingHeader header;
+    std::copy(std::begin(InputRecordingHeader::MAGIC), std::end(InputRecordingHeader::MAGIC), header.magic);
+    header.version = InputRecordingHeader::VERSION;
+    header.tick_rate = _tick_rate;
+    header.reserved = 0;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_buffer.clear();
+    m_buffer.reserve(BUFFER_SIZE);
+    m_record_count = 0;
+
+    LOG_INFO << "Record inputs to: " << _filename;
+    return true;
+}
+
+
+/**
+ * \brief Record a key change.
+ *
+ * \param _tick         Tick since the start of the recording
+ * \param _key_name     GLFW key name
+ * \param _action       GLFW action
+ * \param _mods         GLFW modifier bits
+ */
+void ugly::InputRecorder::record(uint32_t _tick, int _key_name, int _action, int _mods)
+{
+    if(!m_file.is_open())
+        return;
+
+    InputRecord record;
+    record.tick = _tick;
+    record.key_name = static_cast<int16_t>(_key_name);
+    record.action = static_cast<uint8_t>(_action);
+    record.mods = static_cast<uint8_t>(_mods);
+    m_buffer.push_back(record);
+    ++m_record_count;
+
+    if(m_buffer.size() == BUFFER_SIZE)
+        flush();
+}
+
+
+/**
+ * \brief Write the buffered records and close the file.
+ */
+void ugly::InputRecorder::close()
+{
+    if(!m_file.is_open())
+        return;
+
+    flush();
+    m_file.close();
+    LOG_INFO << "Input recording closed, " << m_record_count << " records";
+}
+
+
+/**
+ * \brief Get the number of recorded key changes.
+ *
+ * \return Record count
+ */
+uint64_t ugly::InputRecorder::getRecordCount() const
+{
+    return m_record_count;
+}
+
+
+/**
+ * \brief Write the buffered records.
+ */
+void ugly::InputRecorder::flush()
+{
+    if(m_buffer.empty())
+        return;
+
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size() * sizeof(InputRecord));
+    if(!m_file)
+        LOG_ERROR << "Failed to write input recording";
+
+    m_buffer.clear();
+}
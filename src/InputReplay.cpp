@@ -0,0 +1,99 @@
+#include "InputReplay.h"
+
+
+/**
+ * \brief Load a recording.
+ *
+ * \param _filename     File name
+ * \return False if error
+ */
+bool ugly::InputReplay::load(const std::string& _filename)
+{
+    m_records.clear();
+    m_next = 0;
+    m_tick_rate = 0;
+
+    std::ifstream file(_filename, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+    {
+        LOG_ERROR << "Cannot open input recording: " << _filename;
+        return false;
+    }
+
+    std::streamoff size = file.tellg();
+    file.seekg(0);
+
+    InputRecordingHeader header;
+    if(size < static_cast<std::streamoff>(sizeof(header)) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        LOG_ERROR << "Input recording is too short: " << _filename;
+        return false;
+    }
+
+    if(!std::equal(std::begin(InputRecordingHeader::MAGIC), std::end(InputRecordingHeader::MAGIC), header.magic) || header.version != InputRecordingHeader::VERSION)
+    {
+        LOG_ERROR << "Invalid input recording: " << _filename;
+        return false;
+    }
+
+    size_t count = static_cast<size_t>(size - static_cast<std::streamoff>(sizeof(header))) / sizeof(InputRecord);
+    m_records.resize(count);
+    if(count > 0 && !file.read(reinterpret_cast<char*>(m_records.data()), count * sizeof(InputRecord)))
+    {
+        LOG_ERROR << "Failed to read input recording: " << _filename;
+        m_records.clear();
+        return false;
+    }
+
+    m_tick_rate = header.tick_rate;
+    LOG_INFO << "Replay inputs from: " << _filename << ", " << count << " records at " << m_tick_rate << " ticks per second";
+    return true;
+}
+
+
+/**
+ * \brief Get the next record due at a tick.
+ *
+ * \param _tick     Tick since the start of the replay
+ * \return Record, nullptr if no record is due
+ */
+const ugly::InputRecord* ugly::InputReplay::next(uint32_t _tick)
+{
+    if(m_next >= m_records.size() || m_records[m_next].tick > _tick)
+        return nullptr;
+
+    return &m_records[m_next++];
+}
+
+
+/**
+ * \brief Check if every record was replayed.
+ *
+ * \return True if finished
+ */
+bool ugly::InputReplay::isFinished() const
+{
+    return m_next >= m_records.size();
+}
+
+
+/**
+ * \brief Get the simulation tick rate of the recorded session.
+ *
+ * \return Ticks per second
+ */
+uint32_t ugly::InputReplay::getTickRate() const
+{
+    return m_tick_rate;
+}
+
+
+/**
+ * \brief Get the number of records.
+ *
+ * \return Record count
+ */
+size_t ugly::InputReplay::getRecordCount() const
+{
+    return m_records.size();
+}
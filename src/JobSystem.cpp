@@ -0,0 +1,403 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+
+namespace
+{
+    /*! Queue index of the calling thread, -1 if the thread is not part of the job system */
+    thread_local int t_queue_index = -1;
+
+    /*! Random state used to choose steal victims */
+    thread_local uint32_t t_random_state = 0x9E3779B9u;
+
+    /**
+     * \brief Xorshift random generator.
+     */
+    uint32_t nextRandom()
+    {
+        t_random_state ^= t_random_state << 13;
+        t_random_state ^= t_random_state >> 17;
+        t_random_state ^= t_random_state << 5;
+        return t_random_state;
+    }
+}
+
+
+/**
+ * \brief Fixed size Chase-Lev work stealing deque.
+ *
+ * Only the owner thread calls push() and pop(), any thread can call steal().
+ */
+class ugly::JobSystem::JobQueue
+{
+public:
+
+    /*! Queue capacity, must be a power of two */
+    static constexpr int64_t CAPACITY = 4096;
+
+    /**
+     * \brief Push a job at the bottom. Owner only.
+     *
+     * \return False if the queue is full
+     */
+    bool push(Job* _job)
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        if(bottom - top >= CAPACITY)
+            return false;
+
+        m_jobs[bottom & (CAPACITY - 1)].store(_job, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Pop a job from the bottom. Owner only.
+     *
+     * \return Job, null if empty
+     */
+    Job* pop()
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if(top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if(top == bottom)
+        {
+            // Last job: race against thieves
+            if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    /**
+     * \brief Steal a job from the top. Any thread.
+     *
+     * \return Job, null if empty or if another thread won the race
+     */
+    Job* steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if(top >= bottom)
+            return nullptr;
+
+        Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+
+        return job;
+    }
+
+private:
+
+    /*! Steal end */
+    alignas(64) std::atomic<int64_t> m_top {0};
+
+    /*! Owner end */
+    alignas(64) std::atomic<int64_t> m_bottom {0};
+
+    /*! Job ring */
+    std::atomic<Job*> m_jobs[CAPACITY] {};
+};
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::JobCounter::JobCounter()
+{
+}
+
+
+/**
+ * \brief Check if all the jobs are done.
+ *
+ * \return True if there is no unfinished job
+ */
+bool ugly::JobCounter::isDone() const
+{
+    return m_value.load(std::memory_order_acquire) == 0;
+}
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::JobSystem::JobSystem()
+{
+}
+
+
+/**
+ * \brief Destructor.
+ */
+ugly::JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+
+/**
+ * \brief Initialize the job system and start worker threads.
+ * The calling thread becomes a member of the job system.
+ *
+ * \param _worker_count Number of worker threads, 0 for one per core minus the calling thread
+ * \return False if error
+ */
+bool ugly::JobSystem::initialize(unsigned int _worker_count)
+{
+    if(m_running)
+    {
+        LOG_ERROR << "Job system is already initialized";
+        return false;
+    }
+
+    if(_worker_count == 0)
+    {
+        unsigned int core_count = std::thread::hardware_concurrency();
+        _worker_count = core_count > 1 ? core_count - 1 : 0;
+    }
+
+    LOG_INFO << "Initialize job system with " << _worker_count << " workers...";
+
+    m_queues.clear();
+    for(unsigned int i = 0; i <= _worker_count; ++i)
+        m_queues.push_back(std::make_unique<JobQueue>());
+
+    t_queue_index = 0;
+    m_running = true;
+
+    for(unsigned int i = 1; i <= _worker_count; ++i)
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+
+    return true;
+}
+
+
+/**
+ * \brief Shutdown, stop worker threads.
+ */
+void ugly::JobSystem::shutdown()
+{
+    if(!m_running)
+        return;
+
+    LOG_INFO << "Shutdown job system...";
+
+    // Drain remaining jobs so that no counter stays pending
+    while(executeNextJob())
+    {
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_running = false;
+    }
+    m_sleep_condition.notify_all();
+
+    for(auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+    m_queues.clear();
+
+    t_queue_index = -1;
+}
+
+
+/**
+ * \brief Get the number of worker threads.
+ *
+ * \return Worker thread count
+ */
+unsigned int ugly::JobSystem::getWorkerCount() const
+{
+    return static_cast<unsigned int>(m_workers.size());
+}
+
+
+/**
+ * \brief Schedule a job.
+ * Jobs scheduled from a thread that is not part of the job system are executed immediately.
+ *
+ * \param _job      Job function
+ * \param _counter  Counter incremented until the job is done, can be null
+ */
+void ugly::JobSystem::run(JobFunction _job, JobCounter* _counter)
+{
+    if(t_queue_index < 0 || !m_running)
+    {
+        _job();
+        return;
+    }
+
+    if(_counter != nullptr)
+        _counter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+    // Counted before the push, a thief may run the job and decrement before push() returns
+    m_pending_jobs.fetch_add(1);
+
+    Job* job = new Job {std::move(_job), _counter};
+    if(!m_queues[t_queue_index]->push(job))
+    {
+        // Queue is full: execute the job in place
+        m_pending_jobs.fetch_sub(1);
+        job->function();
+        if(job->counter != nullptr)
+            job->counter->m_value.fetch_sub(1, std::memory_order_release);
+        delete job;
+        return;
+    }
+
+    if(m_sleeping_workers.load() > 0)
+    {
+        // Take the lock so that a worker going to sleep cannot miss the notification
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_sleep_condition.notify_one();
+    }
+}
+
+
+/**
+ * \brief Split a range in batches executed in parallel and wait for them.
+ *
+ * \param _count        Number of elements
+ * \param _batch_size   Number of elements per job
+ * \param _function     Function called for each batch
+ */
+void ugly::JobSystem::parallelFor(uint32_t _count, uint32_t _batch_size, const RangeFunction& _function)
+{
+    if(_count == 0)
+        return;
+
+    if(_batch_size == 0)
+        _batch_size = 1;
+
+    JobCounter counter;
+    for(uint32_t begin = 0; begin < _count; begin += _batch_size)
+    {
+        uint32_t end = std::min(_count, begin + _batch_size);
+        run([&_function, begin, end]() { _function(begin, end); }, &counter);
+    }
+
+    wait(counter);
+}
+
+
+/**
+ * \brief Wait for the jobs of a counter.
+ * The calling thread executes pending jobs while waiting.
+ *
+ * \param _counter  Counter to wait
+ */
+void ugly::JobSystem::wait(const JobCounter& _counter)
+{
+    while(!_counter.isDone())
+    {
+        if(!executeNextJob())
+            std::this_thread::yield();
+    }
+}
+
+
+/**
+ * \brief Get a job from the queue of the calling thread or steal it from another queue.
+ *
+ * \return Job, null if no job is available
+ */
+ugly::JobSystem::Job* ugly::JobSystem::getJob()
+{
+    if(m_queues.empty())
+        return nullptr;
+
+    Job* job = nullptr;
+    if(t_queue_index >= 0)
+        job = m_queues[t_queue_index]->pop();
+
+    if(job == nullptr)
+    {
+        size_t queue_count = m_queues.size();
+        size_t first = nextRandom() % queue_count;
+        for(size_t i = 0; i < queue_count && job == nullptr; ++i)
+        {
+            size_t victim = (first + i) % queue_count;
+            if(static_cast<int>(victim) != t_queue_index)
+                job = m_queues[victim]->steal();
+        }
+    }
+
+    if(job != nullptr)
+        m_pending_jobs.fetch_sub(1);
+
+    return job;
+}
+
+
+/**
+ * \brief Execute a pending job.
+ *
+ * \return False if no job was available
+ */
+bool ugly::JobSystem::executeNextJob()
+{
+    Job* job = getJob();
+    if(job == nullptr)
+        return false;
+
+    job->function();
+    if(job->counter != nullptr)
+        job->counter->m_value.fetch_sub(1, std::memory_order_release);
+    delete job;
+
+    return true;
+}
+
+
+/**
+ * \brief Worker thread loop.
+ *
+ * \param _index    Queue index of the worker
+ */
+void ugly::JobSystem::workerLoop(unsigned int _index)
+{
+    t_queue_index = static_cast<int>(_index);
+    t_random_state ^= _index * 0x85EBCA6Bu;
+    Profiler::getInstance()->setThreadName("Worker " + std::to_string(_index));
+
+    unsigned int idle_loops = 0;
+    while(m_running.load(std::memory_order_relaxed))
+    {
+        if(executeNextJob())
+        {
+            idle_loops = 0;
+            continue;
+        }
+
+        // Spin a little before going to sleep
+        if(++idle_loops < 64)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleeping_workers.fetch_add(1);
+        m_sleep_condition.wait(lock, [this]() { return !m_running || m_pending_jobs.load() > 0; });
+        m_sleeping_workers.fetch_sub(1);
+        idle_loops = 0;
+    }
+}
@@ -21,9 +21,19 @@ namespace plog
 	 * \brief Record formatter.
 	 */
 	util::nstring LogFormatter::format(const Record& record)
+	{
+		return format(record.getSeverity(), record.getFunc(), record.getMessage());
+	}
+
+
+	/**
+	 * \brief Record formatter from the record fields.
+	 * It formats the copies of the records made by ugly::AsyncLogAppender.
+	 */
+	util::nstring LogFormatter::format(Severity severity, const char* func, const util::nchar* message)
 	{
 		util::nostringstream ss;
-		switch (record.getSeverity())
+		switch (severity)
 		{
 		case Severity::none:
 			ss << "NONE - ";
@@ -47,8 +57,8 @@ namespace plog
 			ss << "VERBOSE - ";
 			break;
 		}
-		ss << record.getFunc() << " - ";
-		ss << record.getMessage() << "\n"; // Produce a simple string with a log message.
+		ss << func << " - ";
+		ss << message << "\n"; // Produce a simple string with a log message.
 		return ss.str();
 	}
 
@@ -21,6 +21,12 @@ namespace plog
 		 * \brief Record formatter.
 		 */
 		static util::nstring format(const Record& record);
+
+		/**
+		 * \brief Record formatter from the record fields.
+		 * It formats the copies of the records made by ugly::AsyncLogAppender.
+		 */
+		static util::nstring format(Severity severity, const char* func, const util::nchar* message);
 	};
 
 }//namespace plog
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "Profiler.h"
+
+
+namespace
+{
+    /*! Buffer of the calling thread */
+    thread_local void* t_thread_buffer = nullptr;
+
+    /**
+     * \brief Write a JSON string, escaped.
+     */
+    void writeJsonString(std::ofstream& _file, const char* _text)
+    {
+        _file << '"';
+        for(const char* c = _text; *c != '\0'; ++c)
+        {
+            if(*c == '"' || *c == '\\')
+                _file << '\\' << *c;
+            else if(static_cast<unsigned char>(*c) < 0x20)
+                _file << ' ';
+            else
+                _file << *c;
+        }
+        _file << '"';
+    }
+
+    /**
+     * \brief Write nanoseconds as fractional microseconds, the Chrome trace unit.
+     */
+    void writeMicroseconds(std::ofstream& _file, uint64_t _nanoseconds)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%llu.%03llu", static_cast<unsigned long long>(_nanoseconds / 1000), static_cast<unsigned long long>(_nanoseconds % 1000));
+        _file << buffer;
+    }
+}
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::Profiler::Profiler() :
+    m_origin(std::chrono::steady_clock::now())
+{
+}
+
+
+/**
+ * \brief Enable or disable zone recording.
+ *
+ * \param _enabled  Enable flag
+ */
+void ugly::Profiler::setEnabled(bool _enabled)
+{
+    LOG_INFO << "Profiler enable: " << _enabled;
+    s_enabled.store(_enabled, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get current time.
+ *
+ * \return Nanoseconds since the profiler creation
+ */
+uint64_t ugly::Profiler::now() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin).count());
+}
+
+
+/**
+ * \brief Name the calling thread in traces.
+ *
+ * \param _name     Thread name
+ */
+void ugly::Profiler::setThreadName(const std::string& _name)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer->name = _name;
+}
+
+
+/**
+ * \brief Get a name pointer which stays valid for the whole program.
+ * Zones only keep a pointer to their name.
+ *
+ * \param _name     Name
+ * \return Persistent name
+ */
+const char* ugly::Profiler::internName(const std::string& _name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names.insert(_name).first->c_str();
+}
+
+
+/**
+ * \brief Record a zone for the calling thread.
+ *
+ * \param _name     Zone name, must stay valid until the trace is dumped
+ * \param _start    Start time
+ * \param _end      End time
+ */
+void ugly::Profiler::recordZone(const char* _name, uint64_t _start, uint64_t _end)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    uint64_t index = buffer->write_index.load(std::memory_order_relaxed);
+    buffer->zones[index & (BUFFER_CAPACITY - 1)] = {_name, _start, _end};
+    buffer->write_index.store(index + 1, std::memory_order_release);
+}
+
+
+/**
+ * \brief Dump the recorded zones in the Chrome trace event format.
+ *
+ * \param _filename Output file name
+ * \return False if error
+ */
+bool ugly::Profiler::dumpChromeTrace(const std::string& _filename)
+{
+    LOG_INFO << "Dump profiler trace: " << _filename;
+
+    std::ofstream file(_filename, std::ios::out | std::ios::trunc);
+    if(!file.is_open())
+    {
+        LOG_ERROR << "Cannot open trace file: " << _filename;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first_event = true;
+    std::vector<Zone> zones;
+    for(const auto& buffer : m_buffers)
+    {
+        // Copy the ring, then drop the zones the owner may have overwritten meanwhile
+        uint64_t end = buffer->write_index.load(std::memory_order_acquire);
+        uint64_t begin = std::max(buffer->first_index.load(std::memory_order_relaxed), end > BUFFER_CAPACITY ? end - BUFFER_CAPACITY : 0);
+        zones.clear();
+        for(uint64_t index = begin; index < end; ++index)
+            zones.push_back(buffer->zones[index & (BUFFER_CAPACITY - 1)]);
+
+        uint64_t new_end = buffer->write_index.load(std::memory_order_acquire);
+        size_t skipped = 0;
+        if(new_end >= BUFFER_CAPACITY && new_end - BUFFER_CAPACITY >= begin)
+            skipped = static_cast<size_t>(std::min<uint64_t>(new_end - BUFFER_CAPACITY + 1 - begin, zones.size()));
+
+        if(!first_event)
+            file << ",";
+        first_event = false;
+        file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->thread_index << ",\"args\":{\"name\":";
+        writeJsonString(file, buffer->name.c_str());
+        file << "}}";
+
+        for(size_t i = skipped; i < zones.size(); ++i)
+        {
+            const Zone& zone = zones[i];
+            file << ",\n{\"name\":";
+            writeJsonString(file, zone.name);
+            file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->thread_index << ",\"ts\":";
+            writeMicroseconds(file, zone.start);
+            file << ",\"dur\":";
+            writeMicroseconds(file, zone.end - zone.start);
+            file << "}";
+        }
+    }
+    file << "\n]}\n";
+
+    if(!file.good())
+    {
+        LOG_ERROR << "Failed to write trace file: " << _filename;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * \brief Discard the recorded zones.
+ */
+void ugly::Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(auto& buffer : m_buffers)
+        buffer->first_index.store(buffer->write_index.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Get the buffer of the calling thread, create it if needed.
+ *
+ * \return Thread buffer
+ */
+ugly::Profiler::ThreadBuffer* ugly::Profiler::getThreadBuffer()
+{
+    if(t_thread_buffer != nullptr)
+        return static_cast<ThreadBuffer*>(t_thread_buffer);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->thread_index = static_cast<uint32_t>(m_buffers.size());
+    buffer->name = "Thread " + std::to_string(buffer->thread_index);
+    t_thread_buffer = buffer.get();
+    m_buffers.push_back(std::move(buffer));
+
+    return static_cast<ThreadBuffer*>(t_thread_buffer);
+}
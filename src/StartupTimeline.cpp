@@ -0,0 +1,139 @@
+#include "StartupTimeline.h"
+#include "Profiler.h"
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::StartupTimeline::StartupTimeline()
+{
+    reset();
+}
+
+
+/**
+ * \brief Discard the phases and restart the timeline from the calling thread.
+ */
+void ugly::StartupTimeline::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_origin = std::chrono::steady_clock::now();
+    m_main_thread = std::this_thread::get_id();
+    m_phases.clear();
+    m_total_time = 0;
+}
+
+
+/**
+ * \brief Begin a phase.
+ *
+ * \param _name     Phase name, must be a literal or stay valid
+ * \return Phase index
+ */
+size_t ugly::StartupTimeline::beginPhase(const char* _name)
+{
+    Phase phase;
+    phase.name = _name;
+    phase.start = now();
+    phase.end = 0;
+    phase.main_thread = std::this_thread::get_id() == m_main_thread;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.push_back(phase);
+    return m_phases.size() - 1;
+}
+
+
+/**
+ * \brief End a phase.
+ *
+ * \param _index    Phase index returned by beginPhase()
+ */
+void ugly::StartupTimeline::endPhase(size_t _index)
+{
+    uint64_t end = now();
+    const char* name;
+    uint64_t start;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(_index >= m_phases.size())
+            return;
+
+        m_phases[_index].end = end;
+        name = m_phases[_index].name;
+        start = m_phases[_index].start;
+    }
+
+#ifndef UGLY_PROFILER_DISABLED
+    if(Profiler::isEnabled())
+    {
+        // Convert to the profiler time base
+        Profiler* profiler = Profiler::getInstance();
+        uint64_t offset = profiler->now() - now();
+        profiler->recordZone(name, start + offset, end + offset);
+    }
+#endif
+}
+
+
+/**
+ * \brief Mark the end of the startup.
+ */
+void ugly::StartupTimeline::finish()
+{
+    uint64_t total = now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_total_time = total;
+}
+
+
+/**
+ * \brief Get a copy of the recorded phases.
+ *
+ * \return Phases in begin order
+ */
+std::vector<ugly::StartupTimeline::Phase> ugly::StartupTimeline::getPhases() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_phases;
+}
+
+
+/**
+ * \brief Get the startup duration.
+ *
+ * \return Nanoseconds from reset() to finish()
+ */
+uint64_t ugly::StartupTimeline::getTotalTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_total_time;
+}
+
+
+/**
+ * \brief Log the timeline.
+ */
+void ugly::StartupTimeline::dump() const
+{
+    std::vector<Phase> phases = getPhases();
+
+    LOG_INFO << "Startup timeline: " << getTotalTime() / 1000 << " us";
+    for(const Phase& phase : phases)
+    {
+        LOG_INFO << "\t- " << phase.name << (phase.main_thread ? " [main]" : " [worker]")
+                 << " at " << phase.start / 1000 << " us, " << (phase.end >= phase.start ? phase.end - phase.start : 0) / 1000 << " us";
+    }
+}
+
+
+/**
+ * \brief Get current time.
+ *
+ * \return Nanoseconds since the timeline start
+ */
+uint64_t ugly::StartupTimeline::now() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin).count());
+}
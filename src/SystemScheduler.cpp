@@ -0,0 +1,317 @@
+#include "SystemScheduler.h"
+#include "Engine.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
+
+
+namespace
+{
+    /**
+     * \brief Check if two sorted id lists share an id.
+     */
+    bool intersects(const std::vector<uint32_t>& _a, const std::vector<uint32_t>& _b)
+    {
+        auto a = _a.begin();
+        auto b = _b.begin();
+        while(a != _a.end() && b != _b.end())
+        {
+            if(*a == *b)
+                return true;
+            if(*a < *b)
+                ++a;
+            else
+                ++b;
+        }
+        return false;
+    }
+}
+
+
+/**
+ * \brief Constructor.
+ */
+ugly::SystemScheduler::SystemScheduler()
+{
+}
+
+
+/**
+ * \brief Register a system.
+ *
+ * \param _name     System name, must be unique
+ * \param _reads    Names of the data read by the system
+ * \param _writes   Names of the data written by the system
+ * \param _function System function
+ */
+void ugly::SystemScheduler::addSystem(const std::string& _name, const std::vector<std::string>& _reads, const std::vector<std::string>& _writes, SystemFunction _function)
+{
+    LOG_INFO << "Add system: " << _name;
+
+    for(const auto& system : m_systems)
+    {
+        if(system.name == _name)
+        {
+            LOG_ERROR << "Trying to add a system already existing: " << _name;
+            return;
+        }
+    }
+
+    System system;
+    system.name = _name;
+    system.profile_name = Profiler::getInstance()->internName(_name);
+    for(const auto& data : _reads)
+        system.reads.push_back(getDataId(data));
+    for(const auto& data : _writes)
+        system.writes.push_back(getDataId(data));
+    std::sort(system.reads.begin(), system.reads.end());
+    std::sort(system.writes.begin(), system.writes.end());
+    system.function = std::move(_function);
+
+    m_systems.push_back(std::move(system));
+    m_graph_dirty = true;
+}
+
+
+/**
+ * \brief Unregister a system.
+ *
+ * \param _name     System name
+ */
+void ugly::SystemScheduler::removeSystem(const std::string& _name)
+{
+    LOG_INFO << "Remove system: " << _name;
+
+    auto system_itor = std::find_if(m_systems.begin(), m_systems.end(), [&_name](const System& system) { return system.name == _name; });
+    if(system_itor == m_systems.end())
+    {
+        LOG_ERROR << "System: " << _name << " not found";
+        return;
+    }
+
+    m_systems.erase(system_itor);
+    m_graph_dirty = true;
+}
+
+
+/**
+ * \brief Unregister all systems.
+ */
+void ugly::SystemScheduler::clear()
+{
+    m_systems.clear();
+    m_critical_path.clear();
+    m_graph_dirty = true;
+}
+
+
+/**
+ * \brief Run all systems and wait for them.
+ */
+void ugly::SystemScheduler::update()
+{
+    if(m_systems.empty())
+        return;
+
+    if(m_graph_dirty)
+        buildGraph();
+
+    for(uint32_t i = 0; i < m_systems.size(); ++i)
+        m_remaining_predecessors[i].store(static_cast<uint32_t>(m_systems[i].predecessors.size()), std::memory_order_relaxed);
+
+    m_update_start = std::chrono::steady_clock::now();
+
+    // Run the roots, each system schedules its successors when they become ready
+    JobSystem* job_system = Engine::getInstance()->getJobSystem();
+    for(uint32_t i = 0; i < m_systems.size(); ++i)
+    {
+        if(m_systems[i].predecessors.empty())
+            job_system->run([this, i]() { runSystem(i); }, &m_counter);
+    }
+    job_system->wait(m_counter);
+
+    m_frame_time = std::chrono::steady_clock::now() - m_update_start;
+    computeCriticalPath();
+}
+
+
+/**
+ * \brief Get the wall time of the last update.
+ *
+ * \return Update duration
+ */
+std::chrono::nanoseconds ugly::SystemScheduler::getFrameTime() const
+{
+    return m_frame_time;
+}
+
+
+/**
+ * \brief Get the sum of the system durations of the last update.
+ *
+ * \return Total work duration
+ */
+std::chrono::nanoseconds ugly::SystemScheduler::getWorkTime() const
+{
+    return m_work_time;
+}
+
+
+/**
+ * \brief Get the length of the critical path of the last update.
+ * It is the minimal frame time with infinite parallelism.
+ *
+ * \return Critical path duration
+ */
+std::chrono::nanoseconds ugly::SystemScheduler::getCriticalPathTime() const
+{
+    return m_critical_path_time;
+}
+
+
+/**
+ * \brief Get the systems on the critical path of the last update, in execution order.
+ *
+ * \return System names
+ */
+std::vector<std::string> ugly::SystemScheduler::getCriticalPath() const
+{
+    std::vector<std::string> names;
+    for(auto index : m_critical_path)
+        names.push_back(m_systems[index].name);
+    return names;
+}
+
+
+/**
+ * \brief Get the longest system on the critical path of the last update.
+ *
+ * \return System name, empty if there is no system
+ */
+std::string ugly::SystemScheduler::getBottleneck() const
+{
+    const System* bottleneck = nullptr;
+    for(auto index : m_critical_path)
+    {
+        if(bottleneck == nullptr || m_systems[index].duration > bottleneck->duration)
+            bottleneck = &m_systems[index];
+    }
+
+    return bottleneck != nullptr ? bottleneck->name : std::string();
+}
+
+
+/**
+ * \brief Get the id of a data name.
+ *
+ * \param _name     Data name
+ * \return Data id
+ */
+uint32_t ugly::SystemScheduler::getDataId(const std::string& _name)
+{
+    auto data_itor = m_data_ids.find(_name);
+    if(data_itor != m_data_ids.end())
+        return data_itor->second;
+
+    uint32_t id = static_cast<uint32_t>(m_data_ids.size());
+    m_data_ids[_name] = id;
+    return id;
+}
+
+
+/**
+ * \brief Build the dependency graph.
+ */
+void ugly::SystemScheduler::buildGraph()
+{
+    for(auto& system : m_systems)
+    {
+        system.predecessors.clear();
+        system.successors.clear();
+    }
+
+    // Registration order is a topological order: edges always go to later systems
+    for(uint32_t later = 0; later < m_systems.size(); ++later)
+    {
+        System& b = m_systems[later];
+        for(uint32_t earlier = 0; earlier < later; ++earlier)
+        {
+            System& a = m_systems[earlier];
+            if(intersects(a.writes, b.writes) || intersects(a.writes, b.reads) || intersects(a.reads, b.writes))
+            {
+                a.successors.push_back(later);
+                b.predecessors.push_back(earlier);
+            }
+        }
+    }
+
+    m_remaining_predecessors.reset(new std::atomic<uint32_t>[m_systems.size()]);
+    m_critical_path.clear();
+    m_graph_dirty = false;
+}
+
+
+/**
+ * \brief Execute a system and schedule its ready successors.
+ *
+ * \param _index    System index
+ */
+void ugly::SystemScheduler::runSystem(uint32_t _index)
+{
+    System& system = m_systems[_index];
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        UGLY_PROFILE_ZONE(system.profile_name);
+        UGLY_ALLOCATION_SCOPE(AllocationTag::application);
+        system.function();
+    }
+    auto end = std::chrono::steady_clock::now();
+    system.start = start - m_update_start;
+    system.duration = end - start;
+
+    // The counter is still held by this job, so it cannot reach zero before successors are scheduled
+    JobSystem* job_system = Engine::getInstance()->getJobSystem();
+    for(auto successor : system.successors)
+    {
+        if(m_remaining_predecessors[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            job_system->run([this, successor]() { runSystem(successor); }, &m_counter);
+    }
+}
+
+
+/**
+ * \brief Compute the critical path of the last update.
+ */
+void ugly::SystemScheduler::computeCriticalPath()
+{
+    // Longest path by duration, systems are already in topological order
+    FrameAllocator<int64_t> allocator(Engine::getInstance()->getFrameArena());
+    FrameVector<std::chrono::nanoseconds> finish(m_systems.size(), std::chrono::nanoseconds(0), allocator);
+    FrameVector<int64_t> previous(m_systems.size(), -1, allocator);
+    int64_t last = -1;
+
+    m_work_time = std::chrono::nanoseconds(0);
+    for(uint32_t i = 0; i < m_systems.size(); ++i)
+    {
+        std::chrono::nanoseconds ready {0};
+        for(auto predecessor : m_systems[i].predecessors)
+        {
+            if(finish[predecessor] > ready)
+            {
+                ready = finish[predecessor];
+                previous[i] = predecessor;
+            }
+        }
+        finish[i] = ready + m_systems[i].duration;
+        m_work_time += m_systems[i].duration;
+
+        if(last < 0 || finish[i] > finish[last])
+            last = i;
+    }
+
+    m_critical_path.clear();
+    m_critical_path_time = last >= 0 ? finish[last] : std::chrono::nanoseconds(0);
+    for(int64_t index = last; index >= 0; index = previous[index])
+        m_critical_path.push_back(static_cast<uint32_t>(index));
+    std::reverse(m_critical_path.begin(), m_critical_path.end());
+}
@@ -0,0 +1,480 @@
+#include "TlsfAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace
+{
+    /**
+     * \brief Index of the most significant bit, the value must not be 0.
+     */
+    uint32_t findLastSet(uint64_t _value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, _value);
+        return static_cast<uint32_t>(index);
+#else
+        return 63 - static_cast<uint32_t>(__builtin_clzll(_value));
+#endif
+    }
+
+    /**
+     * \brief Index of the least significant bit, the value must not be 0.
+     */
+    uint32_t findFirstSet(uint64_t _value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, _value);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(_value));
+#endif
+    }
+
+    /**
+     * \brief Align an offset up, the alignment is a power of two.
+     */
+    uint64_t alignUp(uint64_t _offset, uint64_t _alignment)
+    {
+        return (_offset + _alignment - 1) & ~(_alignment - 1);
+    }
+}
+
+
+/**
+ * \brief Constructor.
+ *
+ * \param _size         Managed size
+ * \param _granularity  Page size separating allocations of different kinds, power of two
+ */
+ugly::TlsfAllocator::TlsfAllocator(uint64_t _size, uint64_t _granularity) :
+    m_size(_size),
+    m_granularity(std::max<uint64_t>(_granularity, 1))
+{
+    for(auto& first_level : m_bins)
+        std::fill(std::begin(first_level), std::end(first_level), INVALID_NODE);
+
+    m_nodes.reserve(64);
+    uint32_t node = createNode();
+    m_nodes[node].size = _size;
+    insertFree(node);
+}
+
+
+/**
+ * \brief Allocate a range.
+ *
+ * \param _size         Size
+ * \param _alignment    Alignment, power of two
+ * \param _kind         Allocation kind
+ * \param _offset       Allocated offset
+ * \return Node of the allocation, INVALID_NODE if no free range fits
+ */
+uint32_t ugly::TlsfAllocator::allocate(uint64_t _size, uint64_t _alignment, uint8_t _kind, uint64_t& _offset)
+{
+    _size = std::max<uint64_t>(_size, 1);
+    _alignment = std::max<uint64_t>(_alignment, 1);
+    if(_size > m_size)
+        return INVALID_NODE;
+
+    // Round the size up to the next bin so that any range of the found bins is large enough
+    uint64_t search_size = _size;
+    if(search_size >= SL_COUNT)
+        search_size += (uint64_t(1) << (findLastSet(search_size) - SL_BITS)) - 1;
+
+    uint32_t fl, sl;
+    mapping(search_size, fl, sl);
+
+    uint32_t found = INVALID_NODE;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    while(found == INVALID_NODE && findBin(fl, sl))
+    {
+        // Alignment or granularity padding may still reject a range
+        for(uint32_t node = m_bins[fl][sl]; node != INVALID_NODE; node = m_nodes[node].next_free)
+        {
+            if(fit(node, _size, _alignment, _kind, begin, end))
+            {
+                found = node;
+                break;
+            }
+        }
+
+        if(++sl == SL_COUNT)
+        {
+            sl = 0;
+            if(++fl == FL_COUNT)
+                break;
+        }
+    }
+
+    // The bin of the exact size may hold large enough ranges too
+    if(found == INVALID_NODE)
+    {
+        mapping(_size, fl, sl);
+        for(uint32_t node = m_bins[fl][sl]; node != INVALID_NODE; node = m_nodes[node].next_free)
+        {
+            if(fit(node, _size, _alignment, _kind, begin, end))
+            {
+                found = node;
+                break;
+            }
+        }
+    }
+
+    if(found == INVALID_NODE)
+        return INVALID_NODE;
+
+    removeFree(found);
+    if(begin > m_nodes[found].offset)
+        splitFront(found, begin);
+    if(end < m_nodes[found].offset + m_nodes[found].size)
+        splitBack(found, end);
+
+    m_nodes[found].free = false;
+    m_nodes[found].kind = _kind;
+    ++m_allocation_count;
+
+    _offset = begin;
+    return found;
+}
+
+
+/**
+ * \brief Free a range.
+ *
+ * \param _node     Node returned by allocate()
+ */
+void ugly::TlsfAllocator::free(uint32_t _node)
+{
+    if(_node >= m_nodes.size() || m_nodes[_node].free)
+    {
+        LOG_ERROR << "Trying to free an invalid range";
+        return;
+    }
+
+    --m_allocation_count;
+
+    uint32_t node = _node;
+    uint32_t previous = m_nodes[node].prev_physical;
+    if(previous != INVALID_NODE && m_nodes[previous].free)
+    {
+        removeFree(previous);
+        node = mergeIntoPrevious(node);
+    }
+
+    uint32_t next = m_nodes[node].next_physical;
+    if(next != INVALID_NODE && m_nodes[next].free)
+    {
+        removeFree(next);
+        mergeIntoPrevious(next);
+    }
+
+    insertFree(node);
+}
+
+
+/**
+ * \brief Get the managed size.
+ *
+ * \return Size
+ */
+uint64_t ugly::TlsfAllocator::getSize() const
+{
+    return m_size;
+}
+
+
+/**
+ * \brief Get the free size, padding excluded.
+ *
+ * \return Free size
+ */
+uint64_t ugly::TlsfAllocator::getFreeSize() const
+{
+    return m_free_size;
+}
+
+
+/**
+ * \brief Get the size of the largest free range.
+ *
+ * \return Largest free range size
+ */
+uint64_t ugly::TlsfAllocator::getLargestFreeRange() const
+{
+    if(m_fl_bitmap == 0)
+        return 0;
+
+    // The largest range is in the highest non empty bin
+    uint32_t fl = findLastSet(m_fl_bitmap);
+    uint32_t sl = findLastSet(m_sl_bitmap[fl]);
+
+    uint64_t largest = 0;
+    for(uint32_t node = m_bins[fl][sl]; node != INVALID_NODE; node = m_nodes[node].next_free)
+        largest = std::max(largest, m_nodes[node].size);
+    return largest;
+}
+
+
+/**
+ * \brief Get the number of free ranges.
+ *
+ * \return Free range count
+ */
+uint32_t ugly::TlsfAllocator::getFreeRangeCount() const
+{
+    return m_free_range_count;
+}
+
+
+/**
+ * \brief Get the number of allocations.
+ *
+ * \return Allocation count
+ */
+uint32_t ugly::TlsfAllocator::getAllocationCount() const
+{
+    return m_allocation_count;
+}
+
+
+/**
+ * \brief Check that there is no allocation.
+ *
+ * \return True if empty
+ */
+bool ugly::TlsfAllocator::isEmpty() const
+{
+    return m_allocation_count == 0;
+}
+
+
+/**
+ * \brief Get the bin of a size.
+ */
+void ugly::TlsfAllocator::mapping(uint64_t _size, uint32_t& _fl, uint32_t& _sl)
+{
+    if(_size < SL_COUNT)
+    {
+        _fl = 0;
+        _sl = static_cast<uint32_t>(_size);
+        return;
+    }
+
+    uint32_t log2 = findLastSet(_size);
+    _fl = log2 - SL_BITS + 1;
+    _sl = static_cast<uint32_t>(_size >> (log2 - SL_BITS)) ^ SL_COUNT;
+}
+
+
+/**
+ * \brief Find the first non empty bin at or after a bin.
+ *
+ * \return false if there is none
+ */
+bool ugly::TlsfAllocator::findBin(uint32_t& _fl, uint32_t& _sl) const
+{
+    uint32_t sl_map = m_sl_bitmap[_fl] & (~0u << _sl);
+    if(sl_map == 0)
+    {
+        if(_fl + 1 >= FL_COUNT)
+            return false;
+
+        uint64_t fl_map = m_fl_bitmap & (~uint64_t(0) << (_fl + 1));
+        if(fl_map == 0)
+            return false;
+
+        _fl = findFirstSet(fl_map);
+        sl_map = m_sl_bitmap[_fl];
+    }
+
+    _sl = findFirstSet(sl_map);
+    return true;
+}
+
+
+/**
+ * \brief Check if an allocation fits in a free range.
+ *
+ * \param _node     Free range
+ * \param _begin    Allocation offset
+ * \param _end      End of the range used by the allocation, granularity padding included
+ * \return True if it fits
+ */
+bool ugly::TlsfAllocator::fit(uint32_t _node, uint64_t _size, uint64_t _alignment, uint8_t _kind, uint64_t& _begin, uint64_t& _end) const
+{
+    const Node& node = m_nodes[_node];
+    uint64_t node_end = node.offset + node.size;
+
+    _begin = alignUp(node.offset, _alignment);
+    if(m_granularity > 1 && node.prev_physical != INVALID_NODE)
+    {
+        const Node& previous = m_nodes[node.prev_physical];
+        if(!previous.free && previous.kind != _kind && samePage(previous.offset + previous.size - 1, _begin))
+            _begin = alignUp(_begin, m_granularity);
+    }
+
+    if(_begin >= node_end || node_end - _begin < _size)
+        return false;
+    _end = _begin + _size;
+
+    if(m_granularity > 1 && node.next_physical != INVALID_NODE)
+    {
+        const Node& next = m_nodes[node.next_physical];
+        if(!next.free && next.kind != _kind && samePage(_end - 1, next.offset))
+        {
+            _end = alignUp(_end, m_granularity);
+            if(_end > node_end)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * \brief Check if two offsets are on the same granularity page.
+ */
+bool ugly::TlsfAllocator::samePage(uint64_t _a, uint64_t _b) const
+{
+    return (_a & ~(m_granularity - 1)) == (_b & ~(m_granularity - 1));
+}
+
+
+/**
+ * \brief Get a node from the recycled ones or a new one.
+ */
+uint32_t ugly::TlsfAllocator::createNode()
+{
+    if(!m_recycled_nodes.empty())
+    {
+        uint32_t node = m_recycled_nodes.back();
+        m_recycled_nodes.pop_back();
+        m_nodes[node] = Node();
+        return node;
+    }
+
+    m_nodes.emplace_back();
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+
+/**
+ * \brief Insert a free range into its bin.
+ */
+void ugly::TlsfAllocator::insertFree(uint32_t _node)
+{
+    uint32_t fl, sl;
+    mapping(m_nodes[_node].size, fl, sl);
+
+    Node& node = m_nodes[_node];
+    node.free = true;
+    node.prev_free = INVALID_NODE;
+    node.next_free = m_bins[fl][sl];
+    if(node.next_free != INVALID_NODE)
+        m_nodes[node.next_free].prev_free = _node;
+    m_bins[fl][sl] = _node;
+
+    m_sl_bitmap[fl] |= 1u << sl;
+    m_fl_bitmap |= uint64_t(1) << fl;
+
+    m_free_size += node.size;
+    ++m_free_range_count;
+}
+
+
+/**
+ * \brief Remove a free range from its bin.
+ */
+void ugly::TlsfAllocator::removeFree(uint32_t _node)
+{
+    uint32_t fl, sl;
+    mapping(m_nodes[_node].size, fl, sl);
+
+    Node& node = m_nodes[_node];
+    if(node.prev_free != INVALID_NODE)
+        m_nodes[node.prev_free].next_free = node.next_free;
+    else
+        m_bins[fl][sl] = node.next_free;
+    if(node.next_free != INVALID_NODE)
+        m_nodes[node.next_free].prev_free = node.prev_free;
+    node.prev_free = INVALID_NODE;
+    node.next_free = INVALID_NODE;
+
+    if(m_bins[fl][sl] == INVALID_NODE)
+    {
+        m_sl_bitmap[fl] &= ~(1u << sl);
+        if(m_sl_bitmap[fl] == 0)
+            m_fl_bitmap &= ~(uint64_t(1) << fl);
+    }
+
+    m_free_size -= node.size;
+    --m_free_range_count;
+}
+
+
+/**
+ * \brief Split the beginning of a range into a new free range.
+ */
+void ugly::TlsfAllocator::splitFront(uint32_t _node, uint64_t _offset)
+{
+    uint32_t front = createNode();
+
+    m_nodes[front].offset = m_nodes[_node].offset;
+    m_nodes[front].size = _offset - m_nodes[_node].offset;
+    m_nodes[front].prev_physical = m_nodes[_node].prev_physical;
+    m_nodes[front].next_physical = _node;
+    if(m_nodes[front].prev_physical != INVALID_NODE)
+        m_nodes[m_nodes[front].prev_physical].next_physical = front;
+
+    m_nodes[_node].prev_physical = front;
+    m_nodes[_node].offset = _offset;
+    m_nodes[_node].size -= m_nodes[front].size;
+
+    insertFree(front);
+}
+
+
+/**
+ * \brief Split the end of a range into a new free range.
+ */
+void ugly::TlsfAllocator::splitBack(uint32_t _node, uint64_t _end)
+{
+    uint32_t back = createNode();
+
+    m_nodes[back].offset = _end;
+    m_nodes[back].size = m_nodes[_node].offset + m_nodes[_node].size - _end;
+    m_nodes[back].prev_physical = _node;
+    m_nodes[back].next_physical = m_nodes[_node].next_physical;
+    if(m_nodes[back].next_physical != INVALID_NODE)
+        m_nodes[m_nodes[back].next_physical].prev_physical = back;
+
+    m_nodes[_node].next_physical = back;
+    m_nodes[_node].size = _end - m_nodes[_node].offset;
+
+    insertFree(back);
+}
+
+
+/**
+ * \brief Merge a range into its previous range and recycle it.
+ */
+uint32_t ugly::TlsfAllocator::mergeIntoPrevious(uint32_t _node)
+{
+    uint32_t previous = m_nodes[_node].prev_physical;
+    uint32_t next = m_nodes[_node].next_physical;
+
+    m_nodes[previous].size += m_nodes[_node].size;
+    m_nodes[previous].next_physical = next;
+    if(next != INVALID_NODE)
+        m_nodes[next].prev_physical = previous;
+
+    m_recycled_nodes.push_back(_node);
+    return previous;
+}
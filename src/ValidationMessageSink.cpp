@@ -0,0 +1,183 @@
+#include "ValidationMessageSink.h"
+
+
+/**
+ * @brief Constructor.
+ */
+ugly::ValidationMessageSink::ValidationMessageSink()
+{
+}
+
+
+/**
+ * @brief Debug messenger callback, the user data is the sink.
+ *
+ * @param _severity Vulkan severity
+ * @param _type Message type
+ * @param _data Message data
+ * @param _user_data Sink
+ * @return VK_FALSE, the call is not aborted
+ */
+VKAPI_ATTR VkBool32 VKAPI_CALL ugly::ValidationMessageSink::callback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT _severity,
+    VkDebugUtilsMessageTypeFlagsEXT /*_type*/,
+    const VkDebugUtilsMessengerCallbackDataEXT* _data,
+    void* _user_data)
+{
+    if(_user_data != nullptr)
+        static_cast<ValidationMessageSink*>(_user_data)->receive(_severity, _data);
+
+    return VK_FALSE;
+}
+
+
+/**
+ * @brief Handle a message.
+ *
+ * @param _severity Vulkan severity
+ * @param _data Message data
+ */
+void ugly::ValidationMessageSink::receive(VkDebugUtilsMessageSeverityFlagBitsEXT _severity, const VkDebugUtilsMessengerCallbackDataEXT* _data)
+{
+    plog::Severity severity;
+    if(_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        severity = plog::error;
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if(_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        severity = plog::warning;
+        m_warnings.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        severity = _severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT ? plog::debug : plog::verbose;
+        m_infos.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_message_count.fetch_add(1, std::memory_order_relaxed);
+
+    auto now = std::chrono::steady_clock::now();
+    uint64_t count = 0;
+    uint64_t repeats = 0;
+    uint32_t burst = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Message& message = m_messages[getKey(_data)];
+        if(message.count == 0)
+        {
+            message.name = _data->pMessageIdName != nullptr ? _data->pMessageIdName : "";
+            message.severity = severity;
+        }
+        count = ++message.count;
+        burst = m_burst;
+
+        if(count > burst)
+        {
+            ++message.repeats;
+            if(now - message.last_log < m_interval)
+            {
+                m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            repeats = message.repeats;
+            message.repeats = 0;
+        }
+        message.last_log = now;
+    }
+
+    // Log outside of the lock, the other threads only wait for the counting
+    const char* text = _data->pMessage != nullptr ? _data->pMessage : "";
+    if(repeats > 0)
+        PLOG(severity) << "Validation layer: repeated " << repeats << " times: " << text;
+    else if(count == burst)
+        PLOG(severity) << "Validation layer: " << text << " (next occurrences are rate limited)";
+    else
+        PLOG(severity) << "Validation layer: " << text;
+}
+
+
+/**
+ * @brief Set the rate limit of each message id.
+ *
+ * @param _burst Number of occurrences logged in full
+ * @param _interval Minimal time between two summaries of the repeats
+ */
+void ugly::ValidationMessageSink::setRateLimit(uint32_t _burst, std::chrono::milliseconds _interval)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_burst = _burst;
+    m_interval = _interval;
+}
+
+
+/**
+ * @brief Close the frame statistics.
+ */
+void ugly::ValidationMessageSink::endFrame()
+{
+    m_frame_stats.errors = m_errors.exchange(0, std::memory_order_relaxed);
+    m_frame_stats.warnings = m_warnings.exchange(0, std::memory_order_relaxed);
+    m_frame_stats.infos = m_infos.exchange(0, std::memory_order_relaxed);
+    m_frame_stats.suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Get the statistics of the last frame.
+ *
+ * @return Frame statistics
+ */
+ugly::ValidationFrameStats ugly::ValidationMessageSink::getFrameStats() const
+{
+    return m_frame_stats;
+}
+
+
+/**
+ * @brief Get the total number of messages.
+ *
+ * @return Message count
+ */
+uint64_t ugly::ValidationMessageSink::getMessageCount() const
+{
+    return m_message_count.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Log the message ids with their counts.
+ */
+void ugly::ValidationMessageSink::logReport()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_messages.empty())
+        return;
+
+    std::vector<std::pair<int64_t, const Message*>> messages;
+    for(const auto& message : m_messages)
+        messages.emplace_back(message.first, &message.second);
+    std::sort(messages.begin(), messages.end(), [](const auto& a, const auto& b) { return a.second->count > b.second->count; });
+
+    LOG_INFO << "Validation messages: " << getMessageCount() << " messages, " << messages.size() << " ids";
+    for(const auto& message : messages)
+        LOG_INFO << "\t- " << message.second->name << " (" << message.first << "): " << message.second->count;
+}
+
+
+/**
+ * @brief Get the key of a message.
+ *
+ * @param _data Message data
+ * @return Message id, or a hash of the name when the layer does not provide one
+ */
+int64_t ugly::ValidationMessageSink::getKey(const VkDebugUtilsMessengerCallbackDataEXT* _data)
+{
+    if(_data->messageIdNumber != 0)
+        return _data->messageIdNumber;
+
+    // Hashes are kept out of the 32 bits id range
+    const char* name = _data->pMessageIdName != nullptr ? _data->pMessageIdName : (_data->pMessage != nullptr ? _data->pMessage : "");
+    return static_cast<int64_t>(std::hash<std::string_view>()(name) | (uint64_t(1) << 62));
+}
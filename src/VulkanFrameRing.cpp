@@ -0,0 +1,247 @@
+#include "VulkanFrameRing.h"
+
+
+/**
+ * @brief Constructor.
+ */
+ugly::VulkanFrameRing::VulkanFrameRing()
+{
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ugly::VulkanFrameRing::~VulkanFrameRing()
+{
+}
+
+
+/**
+ * @brief Create the frame slots.
+ *
+ * @param _device Logical device
+ * @param _queue Queue of the submissions
+ * @param _queue_family Family of the queue
+ * @param _frame_count Number of frames in flight
+ * @return false if error
+ */
+bool ugly::VulkanFrameRing::initialize(VkDevice _device, VkQueue _queue, uint32_t _queue_family, uint32_t _frame_count)
+{
+    m_device = _device;
+    m_queue = _queue;
+    m_current = 0;
+    m_frame_number = 0;
+    m_recording = false;
+    m_frames.resize(std::max<uint32_t>(_frame_count, 1));
+
+    LOG_INFO << "Frames in flight: " << m_frames.size();
+
+    for(VulkanFrame& frame : m_frames)
+    {
+        // No per buffer reset flag, the whole pool is reset when the slot is reused
+        VkCommandPoolCreateInfo pool_info {};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool_info.queueFamilyIndex = _queue_family;
+        if(vkCreateCommandPool(m_device, &pool_info, nullptr, &frame.command_pool) != VK_SUCCESS)
+        {
+            LOG_ERROR << "Failed to create frame command pool";
+            return false;
+        }
+
+        VkCommandBufferAllocateInfo allocate_info {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = frame.command_pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(m_device, &allocate_info, &frame.command_buffer) != VK_SUCCESS)
+        {
+            LOG_ERROR << "Failed to allocate frame command buffer";
+            return false;
+        }
+
+        // Created signaled so that the first use of the slot does not wait
+        VkFenceCreateInfo fence_info {};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        if(vkCreateFence(m_device, &fence_info, nullptr, &frame.fence) != VK_SUCCESS)
+        {
+            LOG_ERROR << "Failed to create frame fence";
+            return false;
+        }
+
+        VkSemaphoreCreateInfo semaphore_info {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if(vkCreateSemaphore(m_device, &semaphore_info, nullptr, &frame.acquire_semaphore) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device, &semaphore_info, nullptr, &frame.present_semaphore) != VK_SUCCESS)
+        {
+            LOG_ERROR << "Failed to create frame semaphores";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Wait for the frames in flight and destroy the slots.
+ */
+void ugly::VulkanFrameRing::shutdown()
+{
+    if(m_device == VK_NULL_HANDLE)
+        return;
+
+    std::vector<VkFence> fences;
+    for(const VulkanFrame& frame : m_frames)
+    {
+        if(frame.fence != VK_NULL_HANDLE)
+            fences.push_back(frame.fence);
+    }
+    if(!fences.empty())
+        vkWaitForFences(m_device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+
+    for(VulkanFrame& frame : m_frames)
+    {
+        // Destroying the pool frees its command buffer
+        if(frame.command_pool != VK_NULL_HANDLE)
+            vkDestroyCommandPool(m_device, frame.command_pool, nullptr);
+        if(frame.fence != VK_NULL_HANDLE)
+            vkDestroyFence(m_device, frame.fence, nullptr);
+        if(frame.acquire_semaphore != VK_NULL_HANDLE)
+            vkDestroySemaphore(m_device, frame.acquire_semaphore, nullptr);
+        if(frame.present_semaphore != VK_NULL_HANDLE)
+            vkDestroySemaphore(m_device, frame.present_semaphore, nullptr);
+    }
+
+    m_frames.clear();
+    m_recording = false;
+    m_device = VK_NULL_HANDLE;
+}
+
+
+/**
+ * @brief Wait for the next slot to be free, reset it and begin its command buffer.
+ *
+ * @return false if error
+ */
+bool ugly::VulkanFrameRing::beginFrame()
+{
+    if(m_frames.empty() || m_recording)
+        return false;
+
+    VulkanFrame& frame = m_frames[m_current];
+    if(frame.fence == VK_NULL_HANDLE)
+        return false;
+
+    // Only blocks when the CPU is a full ring ahead of the GPU
+    auto start = std::chrono::steady_clock::now();
+    if(vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to wait for frame fence";
+        return false;
+    }
+    m_last_wait = std::chrono::steady_clock::now() - start;
+
+    if(vkResetCommandPool(m_device, frame.command_pool, 0) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to reset frame command pool";
+        return false;
+    }
+
+    VkCommandBufferBeginInfo begin_info {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if(vkBeginCommandBuffer(frame.command_buffer, &begin_info) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to begin frame command buffer";
+        return false;
+    }
+
+    frame.frame_number = m_frame_number;
+    m_recording = true;
+    return true;
+}
+
+
+/**
+ * @brief End the command buffer of the current frame and submit it.
+ *
+ * @return false if error
+ */
+bool ugly::VulkanFrameRing::endFrame()
+{
+    if(!m_recording)
+        return false;
+    m_recording = false;
+
+    VulkanFrame& frame = m_frames[m_current];
+    if(vkEndCommandBuffer(frame.command_buffer) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to end frame command buffer";
+        return false;
+    }
+
+    // There is no swapchain yet, the submission will wait on acquire_semaphore and
+    // signal present_semaphore once images are acquired and presented
+    VkSubmitInfo submit_info {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &frame.command_buffer;
+
+    // The fence is reset just before the submit, a failed submit must signal it again or the
+    // next wait on the slot would never return
+    vkResetFences(m_device, 1, &frame.fence);
+    if(vkQueueSubmit(m_queue, 1, &submit_info, frame.fence) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to submit frame " << m_frame_number;
+
+        // Nothing will signal the fence, recreate it signaled so that the slot can be reused
+        vkDestroyFence(m_device, frame.fence, nullptr);
+        frame.fence = VK_NULL_HANDLE;
+        VkFenceCreateInfo fence_info {};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        if(vkCreateFence(m_device, &fence_info, nullptr, &frame.fence) != VK_SUCCESS)
+            LOG_ERROR << "Failed to recreate frame fence";
+        return false;
+    }
+
+    m_current = (m_current + 1) % static_cast<uint32_t>(m_frames.size());
+    ++m_frame_number;
+    return true;
+}
+
+
+/**
+ * @brief Get the current frame, valid between beginFrame() and endFrame().
+ *
+ * @return Current frame
+ */
+ugly::VulkanFrame* ugly::VulkanFrameRing::getCurrentFrame()
+{
+    return m_recording ? &m_frames[m_current] : nullptr;
+}
+
+
+/**
+ * @brief Get the number of frames in flight.
+ *
+ * @return Frame count
+ */
+uint32_t ugly::VulkanFrameRing::getFrameCount() const
+{
+    return static_cast<uint32_t>(m_frames.size());
+}
+
+
+/**
+ * @brief Get the time the last beginFrame() waited for the GPU.
+ *
+ * @return Wait duration
+ */
+std::chrono::nanoseconds ugly::VulkanFrameRing::getLastWait() const
+{
+    return m_last_wait;
+}
@@ -1,4 +1,5 @@
 #include "VulkanManager.h"
+#include "Engine.h"
 #include "config.h"
 
 
@@ -39,39 +40,29 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 
 
 /**
- * @brief Vulkan callback error.
- * 
- * @param messageSeverity 
- * @param messageType 
- * @param pCallbackData 
- * @param pUserData 
- * @return VKAPI_ATTR 
+ * @brief Constructor.
  */
-static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* pUserData) {
-
-    PLOG_ERROR << "validation layer: " << pCallbackData->pMessage;
-
-    return VK_FALSE;
+ugly::VulkanManager::VulkanManager()
+{
 }
 
 
 /**
- * @brief Constructor.
+ * @brief Destructor.
  */
-ugly::VulkanManager::VulkanManager()
+ugly::VulkanManager::~VulkanManager()
 {
 }
 
 
 /**
- * @brief Destructor.
+ * @brief Set the number of frames in flight, before the initialization.
+ * 
+ * @param _count Number of frames in flight
  */
-ugly::VulkanManager::~VulkanManager()
+void ugly::VulkanManager::setFramesInFlight(uint32_t _count)
 {
+    m_frames_in_flight = std::max<uint32_t>(_count, 1);
 }
 
 
@@ -84,24 +75,62 @@ bool ugly::VulkanManager::initialize()
 {
     LOG_INFO << "--- Initialize vulkan manager";
 
-    if(!createInstance())
+    StartupTimeline* timeline = Engine::getInstance()->getStartupTimeline();
+
     {
-        return false;
+        StartupPhase phase(timeline, "Vulkan instance");
+        if(!createInstance())
+        {
+            return false;
+        }
     }
 
-    if(!setupDebugMessenger())
     {
-        return false;
+        StartupPhase phase(timeline, "Vulkan debug messenger");
+        if(!setupDebugMessenger())
+        {
+            return false;
+        }
     }
 
-    if(!pickPhysicalDevice())
     {
-        return false;
+        StartupPhase phase(timeline, "Vulkan physical device");
+        if(!pickPhysicalDevice())
+        {
+            return false;
+        }
     }
 
-    if(!createLogicalDevice())
     {
-        return false;
+        StartupPhase phase(timeline, "Vulkan logical device");
+        if(!createLogicalDevice())
+        {
+            return false;
+        }
+    }
+
+    {
+        StartupPhase phase(timeline, "Vulkan memory allocator");
+        if(!m_memory_allocator.initialize(m_physical_device, m_device))
+        {
+            return false;
+        }
+    }
+
+    {
+        StartupPhase phase(timeline, "Vulkan pipeline cache");
+        if(!m_pipeline_cache.load(m_physical_device, m_device, PIPELINE_CACHE_FILENAME))
+        {
+            return false;
+        }
+    }
+
+    {
+        StartupPhase phase(timeline, "Vulkan frame ring");
+        if(!m_frame_ring.initialize(m_device, m_graphics_queue, m_graphics_family, m_frames_in_flight))
+        {
+            return false;
+        }
     }
     
     return true;
@@ -115,12 +144,145 @@ void ugly::VulkanManager::shutdown()
 {
     LOG_INFO << "--- Shutdown vulkan manager";
 
-    vkDestroyDevice(m_device, nullptr);
+    if(m_device != VK_NULL_HANDLE)
+    {
+        // Waits for the frames still executing on the GPU
+        m_frame_ring.shutdown();
 
-    if(m_enable_validation_layers)
+        m_pipeline_cache.save();
+        m_pipeline_cache.logReport();
+        m_pipeline_cache.destroy();
+
+        m_memory_allocator.logStats();
+        m_memory_allocator.shutdown();
+
+        vkDestroyDevice(m_device, nullptr);
+        m_device = VK_NULL_HANDLE;
+    }
+
+    if(m_callback != VK_NULL_HANDLE)
+    {
         DestroyDebugUtilsMessengerEXT(m_instance, m_callback, nullptr);
+        m_callback = VK_NULL_HANDLE;
+    }
+
+    if(m_instance != VK_NULL_HANDLE)
+    {
+        vkDestroyInstance(m_instance, nullptr);
+        m_instance = VK_NULL_HANDLE;
+    }
+
+    m_validation_sink.logReport();
+}
+
+
+/**
+ * @brief Get the validation message sink.
+ * 
+ * @return Validation message sink
+ */
+ugly::ValidationMessageSink* ugly::VulkanManager::getValidationSink()
+{
+    return &m_validation_sink;
+}
+
+
+/**
+ * @brief Get the device memory allocator.
+ * 
+ * @return Device memory allocator
+ */
+ugly::VulkanMemoryAllocator* ugly::VulkanManager::getMemoryAllocator()
+{
+    return &m_memory_allocator;
+}
+
+
+/**
+ * @brief Get the pipeline cache.
+ * 
+ * @return Pipeline cache
+ */
+ugly::VulkanPipelineCache* ugly::VulkanManager::getPipelineCache()
+{
+    return &m_pipeline_cache;
+}
+
+
+/**
+ * @brief Get the frames in flight ring.
+ * 
+ * @return Frame ring
+ */
+ugly::VulkanFrameRing* ugly::VulkanManager::getFrameRing()
+{
+    return &m_frame_ring;
+}
+
+
+/**
+ * @brief Get a queue.
+ * Several types may return the same queue, submissions must then be serialized.
+ * 
+ * @param _type Queue type
+ * @return Queue
+ */
+VkQueue ugly::VulkanManager::getQueue(VulkanQueueType _type) const
+{
+    switch(_type)
+    {
+    case VulkanQueueType::compute:
+        return m_compute_queue;
+    case VulkanQueueType::transfer:
+        return m_transfer_queue;
+    default:
+        return m_graphics_queue;
+    }
+}
+
 
-    vkDestroyInstance(m_instance, nullptr);
+/**
+ * @brief Get the family of a queue.
+ * 
+ * @param _type Queue type
+ * @return Queue family index
+ */
+uint32_t ugly::VulkanManager::getQueueFamily(VulkanQueueType _type) const
+{
+    switch(_type)
+    {
+    case VulkanQueueType::compute:
+        return m_compute_family;
+    case VulkanQueueType::transfer:
+        return m_transfer_family;
+    default:
+        return m_graphics_family;
+    }
+}
+
+
+/**
+ * @brief Check if a queue is not the graphics queue.
+ * 
+ * @param _type Queue type
+ * @return true if the queue runs in parallel with the graphics queue
+ */
+bool ugly::VulkanManager::hasDedicatedQueue(VulkanQueueType _type) const
+{
+    return getQueue(_type) != m_graphics_queue;
+}
+
+
+/**
+ * @brief Get the ownership transfer of an exclusive resource between two queues.
+ * 
+ * @param _src Queue releasing the resource
+ * @param _dst Queue acquiring the resource
+ * @return Ownership transfer
+ */
+ugly::VulkanOwnershipTransfer ugly::VulkanManager::getOwnershipTransfer(VulkanQueueType _src, VulkanQueueType _dst) const
+{
+    return VulkanOwnershipTransfer(getQueueFamily(_src), getQueueFamily(_dst));
 }
 
 
@@ -168,14 +330,18 @@ bool ugly::VulkanManager::createInstance()
         create_info.pNext = nullptr;
     }
 
-    uint32_t extension_count = 0;
-    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
-    std::vector<VkExtensionProperties> extensions_available(extension_count);
-    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions_available.data());
-    LOG_INFO << "Available extensions :";
-    for (const auto& extension : extensions_available) 
+    // Only enumerate the available extensions when verbose logs are enabled
+    IF_LOG(plog::verbose)
     {
-        LOG_INFO << '\t - ' << extension.extensionName;
+        uint32_t extension_count = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+        std::vector<VkExtensionProperties> extensions_available(extension_count);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions_available.data());
+        LOG_VERBOSE << "Available extensions :";
+        for (const auto& extension : extensions_available) 
+        {
+            LOG_VERBOSE << "\t- " << extension.extensionName;
+        }
     }
 
     if(vkCreateInstance(&create_info, nullptr, &m_instance))
@@ -231,11 +397,17 @@ bool ugly::VulkanManager::checkValidationLayerSupport()
  */
 std::vector<const char*> ugly::VulkanManager::getRequiredExtensions()
 {
-    uint32_t glfw_extension_count = 0;
-    const char** glfw_extensions;
-    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
+    // No window system extension without a window
+    if(!Engine::getInstance()->isHeadless())
+    {
+        uint32_t glfw_extension_count = 0;
+        const char** glfw_extensions;
+        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+
+        extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+    }
 
     if (m_enable_validation_layers) 
     {
@@ -255,14 +427,18 @@ void ugly::VulkanManager::populateDebugMessengerCreateInfo(VkDebugUtilsMessenger
 {
     _create_info = {};
     _create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    _create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    // Verbose messages are too many to be useful, info messages are logged as debug
+    _create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
     _create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    _create_info.pfnUserCallback = debugCallback;
+    _create_info.pfnUserCallback = ValidationMessageSink::callback;
+    _create_info.pUserData = &m_validation_sink;
 }
 
 
 /**
- * @brief .
+ * @brief Setup debug messenger.
+ * 
+ * @return false if error 
  */
 bool ugly::VulkanManager::setupDebugMessenger()
 {
@@ -270,11 +446,6 @@ bool ugly::VulkanManager::setupDebugMessenger()
         return true;
 
     VkDebugUtilsMessengerCreateInfoEXT create_info{};
-    create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-    create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    create_info.pfnUserCallback = debugCallback;
-    create_info.pUserData = nullptr; // Optionnel
     populateDebugMessengerCreateInfo(create_info);
     if (CreateDebugUtilsMessengerEXT(m_instance, &create_info, nullptr, &m_callback) != VK_SUCCESS) 
     {
@@ -359,12 +530,36 @@ ugly::VulkanManager::QueueFamilyIndices ugly::VulkanManager::findQueueFamilies(V
     {
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) 
         {
-            indices.graphicsFamily = i;
+            if (!indices.graphicsFamily.has_value())
+            {
+                indices.graphicsFamily = i;
+            }
+        }
+        else if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)
+        {
+            if (!indices.computeFamily.has_value())
+            {
+                indices.computeFamily = i;
+            }
+        }
+        else if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
+        {
+            // Transfer only family, usually a DMA engine
+            if (!indices.transferFamily.has_value())
+            {
+                indices.transferFamily = i;
+            }
         }
 
         i++;
     }
 
+    // Compute queues support transfers too
+    if (!indices.transferFamily.has_value())
+    {
+        indices.transferFamily = indices.computeFamily;
+    }
+
     return indices;
 }
 
@@ -378,19 +573,47 @@ bool ugly::VulkanManager::createLogicalDevice()
 {
     QueueFamilyIndices indices = findQueueFamilies(m_physical_device);
 
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, queue_families.data());
+
+    // One queue per family, the transfer queue gets its own queue of a shared compute family when possible
+    float queue_priorities[] = {1.0f, 1.0f};
+    uint32_t transfer_queue_index = 0;
+    std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+
     VkDeviceQueueCreateInfo queue_create_info{};
     queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queue_create_info.queueFamilyIndex = indices.graphicsFamily.value();
     queue_create_info.queueCount = 1;
-    float queue_priority = 1.0f;
-    queue_create_info.pQueuePriorities = &queue_priority;
+    queue_create_info.pQueuePriorities = queue_priorities;
+    queue_create_infos.push_back(queue_create_info);
+
+    if (indices.computeFamily.has_value())
+    {
+        queue_create_info.queueFamilyIndex = indices.computeFamily.value();
+        if (indices.transferFamily == indices.computeFamily && queue_families[indices.computeFamily.value()].queueCount > 1)
+        {
+            queue_create_info.queueCount = 2;
+            transfer_queue_index = 1;
+        }
+        queue_create_infos.push_back(queue_create_info);
+    }
+
+    if (indices.transferFamily.has_value() && indices.transferFamily != indices.computeFamily)
+    {
+        queue_create_info.queueFamilyIndex = indices.transferFamily.value();
+        queue_create_info.queueCount = 1;
+        queue_create_infos.push_back(queue_create_info);
+    }
 
     VkPhysicalDeviceFeatures device_features{};
 
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    create_info.pQueueCreateInfos = &queue_create_info;
-    create_info.queueCreateInfoCount = 1;
+    create_info.pQueueCreateInfos = queue_create_infos.data();
+    create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
 
     create_info.pEnabledFeatures = &device_features;
     create_info.enabledExtensionCount = 0;
@@ -410,7 +633,28 @@ bool ugly::VulkanManager::createLogicalDevice()
         return false;
     }
 
-    vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphics_queue);
+    m_graphics_family = indices.graphicsFamily.value();
+    vkGetDeviceQueue(m_device, m_graphics_family, 0, &m_graphics_queue);
+
+    m_compute_family = m_graphics_family;
+    m_compute_queue = m_graphics_queue;
+    if (indices.computeFamily.has_value())
+    {
+        m_compute_family = indices.computeFamily.value();
+        vkGetDeviceQueue(m_device, m_compute_family, 0, &m_compute_queue);
+    }
+
+    m_transfer_family = m_graphics_family;
+    m_transfer_queue = m_graphics_queue;
+    if (indices.transferFamily.has_value())
+    {
+        m_transfer_family = indices.transferFamily.value();
+        vkGetDeviceQueue(m_device, m_transfer_family, transfer_queue_index, &m_transfer_queue);
+    }
+
+    LOG_INFO << "Queue families: graphics " << m_graphics_family
+        << ", compute " << m_compute_family << (hasDedicatedQueue(VulkanQueueType::compute) ? "" : " (graphics queue)")
+        << ", transfer " << m_transfer_family << (hasDedicatedQueue(VulkanQueueType::transfer) ? "" : " (graphics queue)");
 
     return true;
 }
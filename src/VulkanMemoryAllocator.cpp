@@ -0,0 +1,830 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <climits>
+
+
+namespace
+{
+    /**
+     * @brief Align a size up, the alignment is a power of two.
+     */
+    VkDeviceSize alignUp(VkDeviceSize _size, VkDeviceSize _alignment)
+    {
+        return (_size + _alignment - 1) & ~(_alignment - 1);
+    }
+}
+
+
+/**
+ * @brief Constructor.
+ */
+ugly::VulkanMemoryAllocator::VulkanMemoryAllocator()
+{
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ugly::VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+}
+
+
+/**
+ * @brief Initialize.
+ *
+ * @param _physical_device Physical device
+ * @param _device Logical device
+ * @param _block_size Size of the blocks
+ * @return false if error
+ */
+bool ugly::VulkanMemoryAllocator::initialize(VkPhysicalDevice _physical_device, VkDevice _device, VkDeviceSize _block_size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_physical_device = _physical_device;
+    m_device = _device;
+    m_block_size = _block_size;
+
+    vkGetPhysicalDeviceMemoryProperties(m_physical_device, &m_memory_properties);
+    if(m_memory_properties.memoryTypeCount == 0)
+    {
+        LOG_ERROR << "No device memory type";
+        return false;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_physical_device, &properties);
+    m_granularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+    m_non_coherent_atom_size = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    m_max_allocation_count = properties.limits.maxMemoryAllocationCount;
+
+    LOG_INFO << "Device memory: " << m_memory_properties.memoryTypeCount << " types, " << m_memory_properties.memoryHeapCount << " heaps";
+    for(uint32_t i = 0; i < m_memory_properties.memoryTypeCount; ++i)
+    {
+        const VkMemoryType& type = m_memory_properties.memoryTypes[i];
+        LOG_DEBUG << "\t- Type " << i << ": heap " << type.heapIndex << " (" << (m_memory_properties.memoryHeaps[type.heapIndex].size >> 20) << " MiB), flags " << type.propertyFlags;
+    }
+    LOG_DEBUG << "bufferImageGranularity: " << m_granularity << ", nonCoherentAtomSize: " << m_non_coherent_atom_size << ", maxMemoryAllocationCount: " << m_max_allocation_count;
+
+    return true;
+}
+
+
+/**
+ * @brief Shutdown, free all the device memory.
+ */
+void ugly::VulkanMemoryAllocator::shutdown()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_allocation_count > 0)
+        LOG_WARNING << m_allocation_count << " device memory allocations were not freed";
+
+    for(uint32_t i = 0; i < m_blocks.size(); ++i)
+    {
+        if(m_blocks[i].memory != VK_NULL_HANDLE)
+            destroyBlock(i);
+    }
+
+    m_blocks.clear();
+    m_free_blocks.clear();
+    for(auto& blocks : m_general_blocks)
+        blocks.clear();
+    for(auto& arena : m_linear_arenas)
+        arena = LinearArena();
+    m_pools.clear();
+    m_allocation_count = 0;
+    m_used_bytes = 0;
+    m_device = VK_NULL_HANDLE;
+}
+
+
+/**
+ * @brief Find the best memory type for a usage.
+ *
+ * @param _type_bits Allowed memory types, from VkMemoryRequirements
+ * @param _usage Usage
+ * @return Memory type index, UINT32_MAX if none is allowed
+ */
+uint32_t ugly::VulkanMemoryAllocator::findMemoryType(uint32_t _type_bits, VulkanMemoryUsage _usage) const
+{
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags avoided = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    switch(_usage)
+    {
+    case VulkanMemoryUsage::gpu_only:
+        preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        avoided |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        break;
+    case VulkanMemoryUsage::upload:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        avoided |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    case VulkanMemoryUsage::readback:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    }
+
+    // A preferred flag counts more than an avoided one
+    uint32_t best_type = UINT32_MAX;
+    int best_score = INT_MIN;
+    for(uint32_t i = 0; i < m_memory_properties.memoryTypeCount; ++i)
+    {
+        VkMemoryPropertyFlags flags = m_memory_properties.memoryTypes[i].propertyFlags;
+        if((_type_bits & (1u << i)) == 0 || (flags & required) != required)
+            continue;
+
+        int score = 0;
+        for(uint32_t bit = 1; bit != 0; bit <<= 1)
+        {
+            if((flags & preferred & bit) != 0)
+                score += 2;
+            if((flags & avoided & bit) != 0)
+                score -= 1;
+        }
+
+        if(score > best_score)
+        {
+            best_score = score;
+            best_type = i;
+        }
+    }
+
+    return best_type;
+}
+
+
+/**
+ * @brief Allocate memory in a block, or dedicated memory for large resources.
+ *
+ * @param _requirements Memory requirements
+ * @param _usage Usage
+ * @param _kind Resource kind
+ * @param _allocation Allocation
+ * @return false if error
+ */
+bool ugly::VulkanMemoryAllocator::allocate(const VkMemoryRequirements& _requirements, VulkanMemoryUsage _usage, VulkanResourceKind _kind, VulkanAllocation& _allocation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t memory_type = findMemoryType(_requirements.memoryTypeBits, _usage);
+    if(memory_type == UINT32_MAX)
+    {
+        LOG_ERROR << "No memory type for the memory requirements " << _requirements.memoryTypeBits;
+        return false;
+    }
+
+    VkDeviceSize alignment, size;
+    getAlignedSize(memory_type, _requirements, alignment, size);
+
+    if(size > m_block_size / 2)
+    {
+        uint32_t block = createBlock(memory_type, size, false);
+        if(block == UINT32_MAX)
+            return false;
+
+        setAllocation(_allocation, VulkanAllocationStrategy::dedicated, block, 0, size);
+    }
+    else
+    {
+        uint32_t node = TlsfAllocator::INVALID_NODE;
+        uint32_t block = UINT32_MAX;
+        VkDeviceSize offset = 0;
+        for(uint32_t candidate : m_general_blocks[memory_type])
+        {
+            node = m_blocks[candidate].tlsf->allocate(size, alignment, static_cast<uint8_t>(_kind), offset);
+            if(node != TlsfAllocator::INVALID_NODE)
+            {
+                block = candidate;
+                break;
+            }
+        }
+
+        if(node == TlsfAllocator::INVALID_NODE)
+        {
+            block = createBlock(memory_type, m_block_size, true);
+            if(block == UINT32_MAX)
+                return false;
+            node = m_blocks[block].tlsf->allocate(size, alignment, static_cast<uint8_t>(_kind), offset);
+            if(node == TlsfAllocator::INVALID_NODE)
+            {
+                // Should not happen in an empty block, but never hand out an invalid node
+                LOG_ERROR << "Cannot allocate " << size << " bytes aligned to " << alignment << " in a " << m_block_size << " bytes block";
+                destroyBlock(block);
+                return false;
+            }
+        }
+
+        setAllocation(_allocation, VulkanAllocationStrategy::general, block, offset, size);
+        _allocation.node = node;
+    }
+
+    ++m_allocation_count;
+    m_used_bytes += size;
+    return true;
+}
+
+
+/**
+ * @brief Allocate transient memory, released by resetLinear().
+ *
+ * @param _requirements Memory requirements
+ * @param _usage Usage
+ * @param _kind Resource kind
+ * @param _allocation Allocation
+ * @return false if error
+ */
+bool ugly::VulkanMemoryAllocator::allocateLinear(const VkMemoryRequirements& _requirements, VulkanMemoryUsage _usage, VulkanResourceKind _kind, VulkanAllocation& _allocation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t memory_type = findMemoryType(_requirements.memoryTypeBits, _usage);
+    if(memory_type == UINT32_MAX)
+    {
+        LOG_ERROR << "No memory type for the memory requirements " << _requirements.memoryTypeBits;
+        return false;
+    }
+
+    VkDeviceSize alignment, size;
+    getAlignedSize(memory_type, _requirements, alignment, size);
+
+    LinearArena& arena = m_linear_arenas[memory_type];
+    while(true)
+    {
+        if(arena.current < arena.chunks.size())
+        {
+            uint32_t chunk = arena.chunks[arena.current];
+
+            // Bump allocations are in address order so only the previous one can share a page
+            VkDeviceSize offset = alignUp(arena.offset, alignment);
+            if(arena.offset > 0 && arena.last_kind != _kind)
+                offset = alignUp(offset, m_granularity);
+
+            if(offset + size <= m_blocks[chunk].size)
+            {
+                arena.offset = offset + size;
+                arena.last_kind = _kind;
+                arena.used += size;
+                setAllocation(_allocation, VulkanAllocationStrategy::linear, chunk, offset, size);
+                return true;
+            }
+
+            ++arena.current;
+            arena.offset = 0;
+        }
+        else
+        {
+            uint32_t chunk = createBlock(memory_type, std::max(m_block_size, size), false);
+            if(chunk == UINT32_MAX)
+                return false;
+            arena.chunks.push_back(chunk);
+        }
+    }
+}
+
+
+/**
+ * @brief Release all the linear allocations, their memory is kept for the next ones.
+ */
+void ugly::VulkanMemoryAllocator::resetLinear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for(auto& arena : m_linear_arenas)
+    {
+        arena.current = 0;
+        arena.offset = 0;
+        arena.used = 0;
+    }
+}
+
+
+/**
+ * @brief Create a pool of same size resources.
+ *
+ * @param _requirements Memory requirements of one resource
+ * @param _usage Usage
+ * @param _chunk_count Resources per device memory chunk
+ * @return Pool index, UINT32_MAX if error
+ */
+uint32_t ugly::VulkanMemoryAllocator::createPool(const VkMemoryRequirements& _requirements, VulkanMemoryUsage _usage, uint32_t _chunk_count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t memory_type = findMemoryType(_requirements.memoryTypeBits, _usage);
+    if(memory_type == UINT32_MAX)
+    {
+        LOG_ERROR << "No memory type for the memory requirements " << _requirements.memoryTypeBits;
+        return UINT32_MAX;
+    }
+
+    Pool pool;
+    VkDeviceSize alignment;
+    pool.memory_type = memory_type;
+    getAlignedSize(memory_type, _requirements, alignment, pool.size);
+    pool.stride = alignUp(pool.size, alignment);
+    pool.chunk_count = std::max<uint32_t>(_chunk_count, 1);
+
+    // Reuse the slot of a destroyed pool
+    for(uint32_t i = 0; i < m_pools.size(); ++i)
+    {
+        if(m_pools[i].memory_type == UINT32_MAX)
+        {
+            m_pools[i] = std::move(pool);
+            return i;
+        }
+    }
+
+    m_pools.push_back(std::move(pool));
+    return static_cast<uint32_t>(m_pools.size() - 1);
+}
+
+
+/**
+ * @brief Destroy a pool and its memory, its allocations must be freed.
+ *
+ * @param _pool Pool index
+ */
+void ugly::VulkanMemoryAllocator::destroyPool(uint32_t _pool)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(_pool >= m_pools.size() || m_pools[_pool].memory_type == UINT32_MAX)
+    {
+        LOG_ERROR << "Trying to destroy an invalid memory pool";
+        return;
+    }
+
+    Pool& pool = m_pools[_pool];
+    if(pool.allocation_count > 0)
+    {
+        LOG_WARNING << pool.allocation_count << " allocations of a destroyed memory pool were not freed";
+        m_allocation_count -= pool.allocation_count;
+        m_used_bytes -= pool.allocation_count * pool.size;
+    }
+
+    for(uint32_t chunk : pool.chunks)
+        destroyBlock(chunk);
+    pool = Pool();
+}
+
+
+/**
+ * @brief Allocate a slot of a pool.
+ *
+ * @param _pool Pool index
+ * @param _allocation Allocation
+ * @return false if error
+ */
+bool ugly::VulkanMemoryAllocator::allocateFromPool(uint32_t _pool, VulkanAllocation& _allocation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(_pool >= m_pools.size() || m_pools[_pool].memory_type == UINT32_MAX)
+    {
+        LOG_ERROR << "Trying to allocate from an invalid memory pool";
+        return false;
+    }
+
+    Pool& pool = m_pools[_pool];
+    if(pool.free_slots.empty())
+    {
+        uint32_t chunk = createBlock(pool.memory_type, pool.stride * pool.chunk_count, false);
+        if(chunk == UINT32_MAX)
+            return false;
+
+        // Pushed in reverse order so that the slots are used in address order
+        uint32_t first_slot = static_cast<uint32_t>(pool.chunks.size()) * pool.chunk_count;
+        pool.chunks.push_back(chunk);
+        for(uint32_t i = pool.chunk_count; i > 0; --i)
+            pool.free_slots.push_back(first_slot + i - 1);
+    }
+
+    uint32_t slot = pool.free_slots.back();
+    pool.free_slots.pop_back();
+    ++pool.allocation_count;
+
+    setAllocation(_allocation, VulkanAllocationStrategy::pool, pool.chunks[slot / pool.chunk_count], (slot % pool.chunk_count) * pool.stride, pool.size);
+    _allocation.node = slot;
+    _allocation.pool = _pool;
+
+    ++m_allocation_count;
+    m_used_bytes += pool.size;
+    return true;
+}
+
+
+/**
+ * @brief Free an allocation, linear allocations are only released by resetLinear().
+ *
+ * @param _allocation Allocation, reset
+ */
+void ugly::VulkanMemoryAllocator::free(VulkanAllocation& _allocation)
+{
+    if(!_allocation.isValid())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    switch(_allocation.strategy)
+    {
+    case VulkanAllocationStrategy::general:
+    {
+        TlsfAllocator* tlsf = m_blocks[_allocation.block].tlsf.get();
+        tlsf->free(_allocation.node);
+
+        // Keep one empty block per memory type to absorb allocation spikes
+        if(tlsf->isEmpty())
+        {
+            uint32_t empty_count = 0;
+            for(uint32_t block : m_general_blocks[_allocation.memory_type])
+            {
+                if(m_blocks[block].tlsf->isEmpty())
+                    ++empty_count;
+            }
+            if(empty_count > 1)
+                destroyBlock(_allocation.block);
+        }
+        break;
+    }
+    case VulkanAllocationStrategy::dedicated:
+        destroyBlock(_allocation.block);
+        break;
+    case VulkanAllocationStrategy::linear:
+        _allocation = VulkanAllocation();
+        return;
+    case VulkanAllocationStrategy::pool:
+    {
+        Pool& pool = m_pools[_allocation.pool];
+        pool.free_slots.push_back(_allocation.node);
+        --pool.allocation_count;
+        break;
+    }
+    }
+
+    --m_allocation_count;
+    m_used_bytes -= _allocation.size;
+    _allocation = VulkanAllocation();
+}
+
+
+/**
+ * @brief Flush host writes of a non coherent allocation.
+ *
+ * @param _allocation Allocation
+ */
+void ugly::VulkanMemoryAllocator::flush(const VulkanAllocation& _allocation)
+{
+    if(!_allocation.isValid() || !isNonCoherent(_allocation.memory_type))
+        return;
+
+    VkMappedMemoryRange range = getMappedRange(_allocation);
+    if(vkFlushMappedMemoryRanges(m_device, 1, &range) != VK_SUCCESS)
+        LOG_ERROR << "Failed to flush mapped memory";
+}
+
+
+/**
+ * @brief Invalidate a non coherent allocation before host reads.
+ *
+ * @param _allocation Allocation
+ */
+void ugly::VulkanMemoryAllocator::invalidate(const VulkanAllocation& _allocation)
+{
+    if(!_allocation.isValid() || !isNonCoherent(_allocation.memory_type))
+        return;
+
+    VkMappedMemoryRange range = getMappedRange(_allocation);
+    if(vkInvalidateMappedMemoryRanges(m_device, 1, &range) != VK_SUCCESS)
+        LOG_ERROR << "Failed to invalidate mapped memory";
+}
+
+
+/**
+ * @brief Create a buffer and bind it to a new allocation.
+ *
+ * @param _create_info Buffer create info
+ * @param _usage Usage
+ * @param _buffer Buffer
+ * @param _allocation Allocation
+ * @return false if error
+ */
+bool ugly::VulkanMemoryAllocator::createBuffer(const VkBufferCreateInfo& _create_info, VulkanMemoryUsage _usage, VkBuffer& _buffer, VulkanAllocation& _allocation)
+{
+    if(vkCreateBuffer(m_device, &_create_info, nullptr, &_buffer) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to create buffer";
+        _buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, _buffer, &requirements);
+    if(!allocate(requirements, _usage, VulkanResourceKind::linear, _allocation))
+    {
+        destroyBuffer(_buffer, _allocation);
+        return false;
+    }
+
+    if(vkBindBufferMemory(m_device, _buffer, _allocation.memory, _allocation.offset) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to bind buffer memory";
+        destroyBuffer(_buffer, _allocation);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Destroy a buffer and free its allocation.
+ *
+ * @param _buffer Buffer
+ * @param _allocation Allocation
+ */
+void ugly::VulkanMemoryAllocator::destroyBuffer(VkBuffer& _buffer, VulkanAllocation& _allocation)
+{
+    if(_buffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(m_device, _buffer, nullptr);
+        _buffer = VK_NULL_HANDLE;
+    }
+    free(_allocation);
+}
+
+
+/**
+ * @brief Create an image and bind it to a new allocation.
+ *
+ * @param _create_info Image create info
+ * @param _usage Usage
+ * @param _image Image
+ * @param _allocation Allocation
+ * @return false if error
+ */
+bool ugly::VulkanMemoryAllocator::createImage(const VkImageCreateInfo& _create_info, VulkanMemoryUsage _usage, VkImage& _image, VulkanAllocation& _allocation)
+{
+    if(vkCreateImage(m_device, &_create_info, nullptr, &_image) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to create image";
+        _image = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, _image, &requirements);
+    VulkanResourceKind kind = _create_info.tiling == VK_IMAGE_TILING_OPTIMAL ? VulkanResourceKind::optimal : VulkanResourceKind::linear;
+    if(!allocate(requirements, _usage, kind, _allocation))
+    {
+        destroyImage(_image, _allocation);
+        return false;
+    }
+
+    if(vkBindImageMemory(m_device, _image, _allocation.memory, _allocation.offset) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to bind image memory";
+        destroyImage(_image, _allocation);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Destroy an image and free its allocation.
+ *
+ * @param _image Image
+ * @param _allocation Allocation
+ */
+void ugly::VulkanMemoryAllocator::destroyImage(VkImage& _image, VulkanAllocation& _allocation)
+{
+    if(_image != VK_NULL_HANDLE)
+    {
+        vkDestroyImage(m_device, _image, nullptr);
+        _image = VK_NULL_HANDLE;
+    }
+    free(_allocation);
+}
+
+
+/**
+ * @brief Get the memory statistics.
+ *
+ * @return Statistics
+ */
+ugly::VulkanMemoryStats ugly::VulkanMemoryAllocator::getStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    VulkanMemoryStats stats;
+    stats.device_allocation_count = m_device_allocation_count;
+    stats.allocation_count = m_allocation_count;
+    stats.used_bytes = m_used_bytes;
+
+    for(const Block& block : m_blocks)
+    {
+        if(block.memory == VK_NULL_HANDLE)
+            continue;
+
+        ++stats.block_count;
+        stats.block_bytes += block.size;
+        if(block.tlsf)
+        {
+            stats.free_bytes += block.tlsf->getFreeSize();
+            stats.free_range_count += block.tlsf->getFreeRangeCount();
+            stats.largest_free_range = std::max(stats.largest_free_range, block.tlsf->getLargestFreeRange());
+        }
+    }
+
+    for(const LinearArena& arena : m_linear_arenas)
+        stats.used_bytes += arena.used;
+
+    if(stats.free_bytes > 0)
+        stats.fragmentation = 1.f - static_cast<float>(static_cast<double>(stats.largest_free_range) / static_cast<double>(stats.free_bytes));
+
+    return stats;
+}
+
+
+/**
+ * @brief Log the memory statistics.
+ */
+void ugly::VulkanMemoryAllocator::logStats()
+{
+    VulkanMemoryStats stats = getStats();
+
+    LOG_INFO << "Device memory: " << stats.block_count << " blocks, " << stats.device_allocation_count << "/" << m_max_allocation_count << " device allocations, " << stats.allocation_count << " allocations";
+    LOG_INFO << "\t- Used: " << stats.used_bytes << " / " << stats.block_bytes << " bytes";
+    LOG_INFO << "\t- Free: " << stats.free_bytes << " bytes in " << stats.free_range_count << " ranges, largest " << stats.largest_free_range << " bytes";
+    LOG_INFO << "\t- Fragmentation: " << stats.fragmentation * 100.f << "%";
+}
+
+
+/**
+ * @brief Get the page size separating linear and optimal resources.
+ *
+ * @return bufferImageGranularity
+ */
+VkDeviceSize ugly::VulkanMemoryAllocator::getGranularity() const
+{
+    return m_granularity;
+}
+
+
+/**
+ * @brief Allocate a device memory block.
+ *
+ * @param _memory_type Memory type index
+ * @param _size Size
+ * @param _general Create a TLSF allocator for the block
+ * @return Block index, UINT32_MAX if error
+ */
+uint32_t ugly::VulkanMemoryAllocator::createBlock(uint32_t _memory_type, VkDeviceSize _size, bool _general)
+{
+    if(m_device_allocation_count >= m_max_allocation_count)
+    {
+        LOG_ERROR << "maxMemoryAllocationCount reached (" << m_max_allocation_count << ")";
+        return UINT32_MAX;
+    }
+
+    VkMemoryAllocateInfo allocate_info {};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = _size;
+    allocate_info.memoryTypeIndex = _memory_type;
+
+    VkDeviceMemory memory;
+    if(vkAllocateMemory(m_device, &allocate_info, nullptr, &memory) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to allocate " << _size << " bytes of memory type " << _memory_type;
+        return UINT32_MAX;
+    }
+
+    void* mapped = nullptr;
+    if((m_memory_properties.memoryTypes[_memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 &&
+        vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to map memory of type " << _memory_type;
+        vkFreeMemory(m_device, memory, nullptr);
+        return UINT32_MAX;
+    }
+
+    uint32_t index;
+    if(!m_free_blocks.empty())
+    {
+        index = m_free_blocks.back();
+        m_free_blocks.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(m_blocks.size());
+        m_blocks.emplace_back();
+    }
+
+    Block& block = m_blocks[index];
+    block.memory = memory;
+    block.size = _size;
+    block.memory_type = _memory_type;
+    block.mapped = static_cast<uint8_t*>(mapped);
+    if(_general)
+    {
+        block.tlsf = std::make_unique<TlsfAllocator>(_size, m_granularity);
+        m_general_blocks[_memory_type].push_back(index);
+    }
+
+    ++m_device_allocation_count;
+    return index;
+}
+
+
+/**
+ * @brief Free a device memory block.
+ *
+ * @param _block Block index
+ */
+void ugly::VulkanMemoryAllocator::destroyBlock(uint32_t _block)
+{
+    Block& block = m_blocks[_block];
+    if(block.tlsf)
+    {
+        auto& blocks = m_general_blocks[block.memory_type];
+        blocks.erase(std::find(blocks.begin(), blocks.end(), _block));
+    }
+
+    if(block.mapped != nullptr)
+        vkUnmapMemory(m_device, block.memory);
+    vkFreeMemory(m_device, block.memory, nullptr);
+
+    block = Block();
+    m_free_blocks.push_back(_block);
+    --m_device_allocation_count;
+}
+
+
+/**
+ * @brief Get the alignment and size of an allocation in a memory type.
+ *
+ * @param _memory_type Memory type index
+ * @param _requirements Memory requirements
+ * @param _alignment Alignment
+ * @param _size Size
+ */
+void ugly::VulkanMemoryAllocator::getAlignedSize(uint32_t _memory_type, const VkMemoryRequirements& _requirements, VkDeviceSize& _alignment, VkDeviceSize& _size) const
+{
+    _alignment = std::max<VkDeviceSize>(_requirements.alignment, 1);
+    _size = std::max<VkDeviceSize>(_requirements.size, 1);
+
+    // Flushed ranges are rounded to the atom size, they must not reach a neighbor allocation
+    if(isNonCoherent(_memory_type))
+    {
+        _alignment = std::max(_alignment, m_non_coherent_atom_size);
+        _size = alignUp(_size, m_non_coherent_atom_size);
+    }
+}
+
+
+/**
+ * @brief Fill an allocation from a block range.
+ */
+void ugly::VulkanMemoryAllocator::setAllocation(VulkanAllocation& _allocation, VulkanAllocationStrategy _strategy, uint32_t _block, VkDeviceSize _offset, VkDeviceSize _size)
+{
+    const Block& block = m_blocks[_block];
+
+    _allocation = VulkanAllocation();
+    _allocation.memory = block.memory;
+    _allocation.offset = _offset;
+    _allocation.size = _size;
+    _allocation.mapped = block.mapped != nullptr ? block.mapped + _offset : nullptr;
+    _allocation.memory_type = block.memory_type;
+    _allocation.strategy = _strategy;
+    _allocation.block = _block;
+}
+
+
+/**
+ * @brief Get the non coherent atom range of an allocation.
+ */
+VkMappedMemoryRange ugly::VulkanMemoryAllocator::getMappedRange(const VulkanAllocation& _allocation) const
+{
+    VkMappedMemoryRange range {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = _allocation.memory;
+    range.offset = _allocation.offset & ~(m_non_coherent_atom_size - 1);
+    range.size = alignUp(_allocation.offset + _allocation.size - range.offset, m_non_coherent_atom_size);
+    return range;
+}
+
+
+/**
+ * @brief Check if a memory type is host visible but not coherent.
+ */
+bool ugly::VulkanMemoryAllocator::isNonCoherent(uint32_t _memory_type) const
+{
+    VkMemoryPropertyFlags flags = m_memory_properties.memoryTypes[_memory_type].propertyFlags;
+    return (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 && (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0;
+}
@@ -0,0 +1,158 @@
+#include "VulkanOwnershipTransfer.h"
+
+
+/**
+ * @brief Constructor.
+ *
+ * @param _src_family Queue family releasing the resource
+ * @param _dst_family Queue family acquiring the resource
+ */
+ugly::VulkanOwnershipTransfer::VulkanOwnershipTransfer(uint32_t _src_family, uint32_t _dst_family) :
+    m_src_family(_src_family),
+    m_dst_family(_dst_family)
+{
+}
+
+
+/**
+ * @brief Check if the families differ, a release and an acquire are needed.
+ *
+ * @return true if the ownership changes
+ */
+bool ugly::VulkanOwnershipTransfer::isRequired() const
+{
+    return m_src_family != m_dst_family;
+}
+
+
+/**
+ * @brief Record the release of a buffer range on the source queue.
+ *
+ * @param _command_buffer Command buffer of the source queue
+ * @param _buffer Buffer
+ * @param _offset Range offset
+ * @param _size Range size, VK_WHOLE_SIZE for the end of the buffer
+ * @param _src Last use on the source queue
+ * @param _dst First use on the destination queue
+ */
+void ugly::VulkanOwnershipTransfer::releaseBuffer(VkCommandBuffer _command_buffer, VkBuffer _buffer, VkDeviceSize _offset, VkDeviceSize _size, const VulkanAccess& _src, const VulkanAccess& _dst) const
+{
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = _buffer;
+    barrier.offset = _offset;
+    barrier.size = _size;
+    barrier.srcAccessMask = _src.access;
+
+    if(!isRequired())
+    {
+        // Same family, a regular barrier
+        barrier.dstAccessMask = _dst.access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        vkCmdPipelineBarrier(_command_buffer, _src.stage, _dst.stage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        return;
+    }
+
+    // Destination accesses are ignored by a release, the acquire makes the memory visible
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = m_src_family;
+    barrier.dstQueueFamilyIndex = m_dst_family;
+    vkCmdPipelineBarrier(_command_buffer, _src.stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+
+/**
+ * @brief Record the acquire of a buffer range on the destination queue.
+ *
+ * @param _command_buffer Command buffer of the destination queue
+ * @param _buffer Buffer
+ * @param _offset Range offset
+ * @param _size Range size, VK_WHOLE_SIZE for the end of the buffer
+ * @param _src Last use on the source queue
+ * @param _dst First use on the destination queue
+ */
+void ugly::VulkanOwnershipTransfer::acquireBuffer(VkCommandBuffer _command_buffer, VkBuffer _buffer, VkDeviceSize _offset, VkDeviceSize _size, const VulkanAccess& /*_src*/, const VulkanAccess& _dst) const
+{
+    if(!isRequired())
+        return;
+
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = _buffer;
+    barrier.offset = _offset;
+    barrier.size = _size;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = _dst.access;
+    barrier.srcQueueFamilyIndex = m_src_family;
+    barrier.dstQueueFamilyIndex = m_dst_family;
+    vkCmdPipelineBarrier(_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _dst.stage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+
+/**
+ * @brief Record the release of an image on the source queue.
+ *
+ * @param _command_buffer Command buffer of the source queue
+ * @param _image Image
+ * @param _range Subresource range
+ * @param _old_layout Layout on the source queue
+ * @param _new_layout Layout on the destination queue
+ * @param _src Last use on the source queue
+ * @param _dst First use on the destination queue
+ */
+void ugly::VulkanOwnershipTransfer::releaseImage(VkCommandBuffer _command_buffer, VkImage _image, const VkImageSubresourceRange& _range, VkImageLayout _old_layout, VkImageLayout _new_layout, const VulkanAccess& _src, const VulkanAccess& _dst) const
+{
+    VkImageMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = _image;
+    barrier.subresourceRange = _range;
+    barrier.oldLayout = _old_layout;
+    barrier.newLayout = _new_layout;
+    barrier.srcAccessMask = _src.access;
+
+    if(!isRequired())
+    {
+        barrier.dstAccessMask = _dst.access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        vkCmdPipelineBarrier(_command_buffer, _src.stage, _dst.stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        return;
+    }
+
+    // The layout transition is recorded on both sides and executed once
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = m_src_family;
+    barrier.dstQueueFamilyIndex = m_dst_family;
+    vkCmdPipelineBarrier(_command_buffer, _src.stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+
+/**
+ * @brief Record the acquire of an image on the destination queue.
+ *
+ * @param _command_buffer Command buffer of the destination queue
+ * @param _image Image
+ * @param _range Subresource range
+ * @param _old_layout Layout on the source queue
+ * @param _new_layout Layout on the destination queue
+ * @param _src Last use on the source queue
+ * @param _dst First use on the destination queue
+ */
+void ugly::VulkanOwnershipTransfer::acquireImage(VkCommandBuffer _command_buffer, VkImage _image, const VkImageSubresourceRange& _range, VkImageLayout _old_layout, VkImageLayout _new_layout, const VulkanAccess& /*_src*/, const VulkanAccess& _dst) const
+{
+    if(!isRequired())
+        return;
+
+    VkImageMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = _image;
+    barrier.subresourceRange = _range;
+    barrier.oldLayout = _old_layout;
+    barrier.newLayout = _new_layout;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = _dst.access;
+    barrier.srcQueueFamilyIndex = m_src_family;
+    barrier.dstQueueFamilyIndex = m_dst_family;
+    vkCmdPipelineBarrier(_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _dst.stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
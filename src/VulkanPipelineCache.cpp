@@ -0,0 +1,338 @@
+#include "VulkanPipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    /*! Size of VkPipelineCacheHeaderVersionOne */
+    const size_t PIPELINE_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+    /**
+     * @brief Hash of cache data.
+     */
+    size_t hashData(const std::vector<uint8_t>& _data)
+    {
+        return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(_data.data()), _data.size()));
+    }
+
+    /**
+     * @brief Duration in milliseconds.
+     */
+    double toMilliseconds(std::chrono::nanoseconds _duration)
+    {
+        return std::chrono::duration<double, std::milli>(_duration).count();
+    }
+}
+
+
+/**
+ * @brief Constructor.
+ */
+ugly::VulkanPipelineCache::VulkanPipelineCache()
+{
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ugly::VulkanPipelineCache::~VulkanPipelineCache()
+{
+}
+
+
+/**
+ * @brief Create the pipeline cache from the file if it is valid for the device.
+ *
+ * @param _physical_device Physical device
+ * @param _device Logical device
+ * @param _filename Cache file
+ * @return false if the pipeline cache cannot be created
+ */
+bool ugly::VulkanPipelineCache::load(VkPhysicalDevice _physical_device, VkDevice _device, const std::string& _filename)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_device = _device;
+    m_filename = _filename;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_physical_device, &properties);
+
+    std::vector<uint8_t> data;
+    std::string reason;
+    std::ifstream file(_filename, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+    {
+        reason = "no cache file";
+    }
+    else
+    {
+        std::streamoff size = file.tellg();
+        file.seekg(0);
+        data.resize(static_cast<size_t>(std::max<std::streamoff>(size, 0)));
+        if(!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+        {
+            reason = "read error";
+            data.clear();
+        }
+        else if(data.empty())
+        {
+            reason = "empty cache file";
+        }
+    }
+
+    if(!data.empty() && !validateHeader(data, properties, reason))
+        data.clear();
+
+    VkPipelineCacheCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    create_info.initialDataSize = data.size();
+    create_info.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(m_device, &create_info, nullptr, &m_cache);
+    if(result != VK_SUCCESS && !data.empty())
+    {
+        // The header is valid but the driver may still refuse the content
+        reason = "rejected by the driver";
+        data.clear();
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = nullptr;
+        result = vkCreatePipelineCache(m_device, &create_info, nullptr, &m_cache);
+    }
+
+    if(result != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to create pipeline cache";
+        m_cache = VK_NULL_HANDLE;
+        return false;
+    }
+
+    m_warm = !data.empty();
+    m_loaded_size = data.size();
+    m_loaded_hash = hashData(data);
+    m_load_time = std::chrono::steady_clock::now() - start;
+
+    if(m_warm)
+        LOG_INFO << "Pipeline cache hit: " << m_loaded_size << " bytes loaded in " << toMilliseconds(m_load_time) << " ms";
+    else
+        LOG_INFO << "Pipeline cache miss (" << reason << "), empty cache created in " << toMilliseconds(m_load_time) << " ms";
+
+    return true;
+}
+
+
+/**
+ * @brief Write the pipeline cache to the file if it changed since the load.
+ *
+ * @return false if error
+ */
+bool ugly::VulkanPipelineCache::save()
+{
+    if(m_cache == VK_NULL_HANDLE)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t size = 0;
+    if(vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to get the pipeline cache size";
+        return false;
+    }
+
+    std::vector<uint8_t> data(size);
+    if(size > 0 && vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS)
+    {
+        LOG_ERROR << "Failed to get the pipeline cache data";
+        return false;
+    }
+    data.resize(size);
+
+    size_t hash = hashData(data);
+    if(size == m_loaded_size && hash == m_loaded_hash)
+    {
+        LOG_DEBUG << "Pipeline cache unchanged, not saved";
+        return true;
+    }
+
+    if(!writeFileAtomically(m_filename, data))
+        return false;
+
+    m_loaded_size = size;
+    m_loaded_hash = hash;
+
+    LOG_INFO << "Pipeline cache saved: " << size << " bytes in " << toMilliseconds(std::chrono::steady_clock::now() - start) << " ms";
+    return true;
+}
+
+
+/**
+ * @brief Destroy the pipeline cache.
+ */
+void ugly::VulkanPipelineCache::destroy()
+{
+    if(m_cache != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+        m_cache = VK_NULL_HANDLE;
+    }
+}
+
+
+/**
+ * @brief Get the pipeline cache, to pass to the pipeline creations.
+ *
+ * @return Pipeline cache
+ */
+VkPipelineCache ugly::VulkanPipelineCache::getCache() const
+{
+    return m_cache;
+}
+
+
+/**
+ * @brief Check if the cache was loaded from a valid file.
+ *
+ * @return true on a cache hit
+ */
+bool ugly::VulkanPipelineCache::isWarm() const
+{
+    return m_warm;
+}
+
+
+/**
+ * @brief Record the duration of a pipeline creation using the cache.
+ *
+ * @param _duration Creation duration
+ */
+void ugly::VulkanPipelineCache::recordPipelineCreation(std::chrono::nanoseconds _duration)
+{
+    m_pipeline_count.fetch_add(1, std::memory_order_relaxed);
+    m_creation_time.fetch_add(_duration.count(), std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Log the load and pipeline creation timings.
+ */
+void ugly::VulkanPipelineCache::logReport()
+{
+    uint32_t count = m_pipeline_count.load(std::memory_order_relaxed);
+    if(count == 0)
+        return;
+
+    std::chrono::nanoseconds creation_time(m_creation_time.load(std::memory_order_relaxed));
+    LOG_INFO << "Pipeline creation with a " << (m_warm ? "warm" : "cold") << " cache: " << count << " pipelines in "
+        << toMilliseconds(creation_time) << " ms, " << toMilliseconds(creation_time / count) << " ms per pipeline";
+}
+
+
+/**
+ * @brief Check that cache data was written by the device.
+ *
+ * @param _data Cache data
+ * @param _properties Physical device properties
+ * @param _reason Reason of the rejection
+ * @return true if valid
+ */
+bool ugly::VulkanPipelineCache::validateHeader(const std::vector<uint8_t>& _data, const VkPhysicalDeviceProperties& _properties, std::string& _reason)
+{
+    if(_data.size() < PIPELINE_CACHE_HEADER_SIZE)
+    {
+        _reason = "truncated header";
+        return false;
+    }
+
+    // VkPipelineCacheHeaderVersionOne, read field by field as the data may be unaligned
+    uint32_t header_size, header_version, vendor_id, device_id;
+    memcpy(&header_size, _data.data(), sizeof(uint32_t));
+    memcpy(&header_version, _data.data() + 4, sizeof(uint32_t));
+    memcpy(&vendor_id, _data.data() + 8, sizeof(uint32_t));
+    memcpy(&device_id, _data.data() + 12, sizeof(uint32_t));
+
+    if(header_size < PIPELINE_CACHE_HEADER_SIZE || header_size > _data.size())
+    {
+        _reason = "invalid header size";
+        return false;
+    }
+
+    if(header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    {
+        _reason = "unsupported header version " + std::to_string(header_version);
+        return false;
+    }
+
+    if(vendor_id != _properties.vendorID || device_id != _properties.deviceID)
+    {
+        _reason = "written by another device";
+        return false;
+    }
+
+    if(memcmp(_data.data() + 16, _properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        _reason = "written by another driver version";
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Write a file through a temporary file and a rename.
+ *
+ * @param _filename File
+ * @param _data Content
+ * @return false if error
+ */
+bool ugly::VulkanPipelineCache::writeFileAtomically(const std::string& _filename, const std::vector<uint8_t>& _data)
+{
+    std::string temporary = _filename + ".tmp";
+
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == nullptr)
+    {
+        LOG_ERROR << "Cannot open pipeline cache file: " << temporary;
+        return false;
+    }
+
+    bool written = fwrite(_data.data(), 1, _data.size(), file) == _data.size() && fflush(file) == 0;
+#ifndef _WIN32
+    // The content must reach the disk before the rename makes it visible
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = fclose(file) == 0 && written;
+
+    if(!written)
+    {
+        LOG_ERROR << "Failed to write pipeline cache file: " << temporary;
+        remove(temporary.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    bool renamed = MoveFileExA(temporary.c_str(), _filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool renamed = rename(temporary.c_str(), _filename.c_str()) == 0;
+#endif
+    if(!renamed)
+    {
+        LOG_ERROR << "Failed to replace pipeline cache file: " << _filename;
+        remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,379 @@
+#include "World.h"
+
+
+namespace
+{
+    /**
+     * \brief Component type description.
+     */
+    struct ComponentInfo
+    {
+        size_t size;
+        size_t alignment;
+    };
+
+    /*! Registered component types */
+    std::vector<ComponentInfo>& getComponentInfos()
+    {
+        static std::vector<ComponentInfo> infos;
+        return infos;
+    }
+
+    /*! Component registration mutex */
+    std::mutex& getComponentMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    /**
+     * \brief Round up to a multiple of an alignment.
+     */
+    size_t alignUp(size_t _value, size_t _alignment)
+    {
+        return (_value + _alignment - 1) / _alignment * _alignment;
+    }
+}
+
+
+/**
+ * \brief Constructor.
+ *
+ * \param _job_system  Job system used by parallel queries, null to run them on the calling thread
+ */
+ugly::World::World(JobSystem* _job_system) :
+    m_job_system(_job_system)
+{
+}
+
+
+/**
+ * \brief Destructor.
+ */
+ugly::World::~World()
+{
+}
+
+
+/**
+ * \brief Create an entity without component.
+ *
+ * \return Entity
+ */
+ugly::Entity ugly::World::createEntity()
+{
+    Entity entity;
+    if(!m_free_slots.empty())
+    {
+        entity.index = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    else
+    {
+        entity.index = static_cast<uint32_t>(m_records.size());
+        m_records.emplace_back();
+    }
+    entity.generation = m_records[entity.index].generation;
+
+    insertEntity(getArchetype(0), entity);
+    ++m_entity_count;
+
+    return entity;
+}
+
+
+/**
+ * \brief Destroy an entity and its components.
+ *
+ * \param _entity   Entity
+ */
+void ugly::World::destroyEntity(Entity _entity)
+{
+    EntityRecord* record = getRecord(_entity);
+    if(record == nullptr)
+    {
+        LOG_WARNING << "Trying to destroy a dead entity: " << _entity.index;
+        return;
+    }
+
+    removeRow(*record);
+    record->archetype = nullptr;
+    ++record->generation;
+    m_free_slots.push_back(_entity.index);
+    --m_entity_count;
+}
+
+
+/**
+ * \brief Check if an entity is alive.
+ *
+ * \param _entity   Entity
+ * \return True if alive
+ */
+bool ugly::World::isAlive(Entity _entity) const
+{
+    return getRecord(_entity) != nullptr;
+}
+
+
+/**
+ * \brief Get the number of alive entities.
+ *
+ * \return Entity count
+ */
+uint32_t ugly::World::getEntityCount() const
+{
+    return m_entity_count;
+}
+
+
+/**
+ * \brief Destroy all entities.
+ */
+void ugly::World::clear()
+{
+    for(uint32_t index = 0; index < m_records.size(); ++index)
+    {
+        EntityRecord& record = m_records[index];
+        if(record.archetype != nullptr)
+        {
+            record.archetype = nullptr;
+            ++record.generation;
+            m_free_slots.push_back(index);
+        }
+    }
+
+    for(Archetype* archetype : m_archetype_list)
+        archetype->chunks.clear();
+
+    m_entity_count = 0;
+}
+
+
+/**
+ * \brief Register a component type.
+ *
+ * \param _size         Component size
+ * \param _alignment    Component alignment
+ * \return Component type id
+ */
+uint32_t ugly::World::registerComponentType(size_t _size, size_t _alignment)
+{
+    std::lock_guard<std::mutex> lock(getComponentMutex());
+
+    auto& infos = getComponentInfos();
+    if(infos.size() >= MAX_COMPONENT_TYPES)
+    {
+        LOG_FATAL << "Too many component types, maximum is " << MAX_COMPONENT_TYPES;
+        std::abort();
+    }
+
+    infos.push_back({_size, _alignment});
+    return static_cast<uint32_t>(infos.size() - 1);
+}
+
+
+/**
+ * \brief Get the size of a component type.
+ *
+ * \param _type Component type id
+ * \return Component size
+ */
+size_t ugly::World::getComponentSize(uint32_t _type)
+{
+    std::lock_guard<std::mutex> lock(getComponentMutex());
+    return getComponentInfos()[_type].size;
+}
+
+
+/**
+ * \brief Get the alignment of a component type.
+ *
+ * \param _type Component type id
+ * \return Component alignment
+ */
+size_t ugly::World::getComponentAlignment(uint32_t _type)
+{
+    std::lock_guard<std::mutex> lock(getComponentMutex());
+    return getComponentInfos()[_type].alignment;
+}
+
+
+/**
+ * \brief Get or create the archetype of a component mask.
+ *
+ * \param _mask Component mask
+ * \return Archetype
+ */
+ugly::World::Archetype* ugly::World::getArchetype(uint64_t _mask)
+{
+    auto archetype_itor = m_archetypes.find(_mask);
+    if(archetype_itor != m_archetypes.end())
+        return archetype_itor->second.get();
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->mask = _mask;
+    size_t row_size = sizeof(Entity);
+    for(uint32_t type = 0; type < MAX_COMPONENT_TYPES; ++type)
+    {
+        if(_mask & (uint64_t(1) << type))
+        {
+            archetype->types.push_back(type);
+            archetype->sizes[type] = static_cast<uint32_t>(getComponentSize(type));
+            row_size += archetype->sizes[type];
+        }
+    }
+
+    // Find the largest capacity whose arrays, aligned for SIMD, fit in a chunk
+    uint32_t capacity = static_cast<uint32_t>(CHUNK_SIZE / row_size);
+    for(; capacity > 0; --capacity)
+    {
+        size_t offset = alignUp(capacity * sizeof(Entity), 16);
+        for(auto type : archetype->types)
+        {
+            offset = alignUp(offset, std::max<size_t>(getComponentAlignment(type), 16));
+            archetype->offsets[type] = static_cast<uint32_t>(offset);
+            offset += capacity * archetype->sizes[type];
+        }
+
+        if(offset <= CHUNK_SIZE)
+            break;
+    }
+
+    if(capacity == 0)
+    {
+        LOG_FATAL << "Archetype does not fit in a chunk, row size: " << row_size;
+        std::abort();
+    }
+    archetype->chunk_capacity = capacity;
+
+    LOG_DEBUG << "Create archetype with " << archetype->types.size() << " components, " << capacity << " entities per chunk";
+
+    Archetype* result = archetype.get();
+    m_archetypes[_mask] = std::move(archetype);
+    m_archetype_list.push_back(result);
+    return result;
+}
+
+
+/**
+ * \brief Get the record of an alive entity.
+ *
+ * \param _entity   Entity
+ * \return Record, null if the entity is not alive
+ */
+ugly::World::EntityRecord* ugly::World::getRecord(Entity _entity)
+{
+    if(_entity.index >= m_records.size())
+        return nullptr;
+
+    EntityRecord& record = m_records[_entity.index];
+    if(record.archetype == nullptr || record.generation != _entity.generation)
+        return nullptr;
+
+    return &record;
+}
+
+
+/**
+ * \brief Get the record of an alive entity.
+ *
+ * \param _entity   Entity
+ * \return Record, null if the entity is not alive
+ */
+const ugly::World::EntityRecord* ugly::World::getRecord(Entity _entity) const
+{
+    return const_cast<World*>(this)->getRecord(_entity);
+}
+
+
+/**
+ * \brief Append an entity to an archetype, components are left uninitialized.
+ *
+ * \param _archetype    Archetype
+ * \param _entity       Entity
+ */
+void ugly::World::insertEntity(Archetype* _archetype, Entity _entity)
+{
+    if(_archetype->chunks.empty() || _archetype->chunks.back()->count == _archetype->chunk_capacity)
+        _archetype->chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+
+    Chunk& chunk = *_archetype->chunks.back();
+    uint32_t row = chunk.count++;
+    _archetype->getEntities(chunk)[row] = _entity;
+
+    EntityRecord& record = m_records[_entity.index];
+    record.archetype = _archetype;
+    record.chunk = static_cast<uint32_t>(_archetype->chunks.size() - 1);
+    record.row = row;
+}
+
+
+/**
+ * \brief Remove the row of an entity, the last row of the archetype takes its place.
+ *
+ * \param _record   Record of the entity
+ */
+void ugly::World::removeRow(EntityRecord& _record)
+{
+    Archetype* archetype = _record.archetype;
+    Chunk& chunk = *archetype->chunks[_record.chunk];
+    Chunk& last_chunk = *archetype->chunks.back();
+    uint32_t last_row = last_chunk.count - 1;
+
+    if(&chunk != &last_chunk || _record.row != last_row)
+    {
+        Entity moved = archetype->getEntities(last_chunk)[last_row];
+        archetype->getEntities(chunk)[_record.row] = moved;
+        for(auto type : archetype->types)
+        {
+            size_t size = archetype->sizes[type];
+            std::memcpy(chunk.data + archetype->offsets[type] + _record.row * size, last_chunk.data + archetype->offsets[type] + last_row * size, size);
+        }
+
+        EntityRecord& moved_record = m_records[moved.index];
+        moved_record.chunk = _record.chunk;
+        moved_record.row = _record.row;
+    }
+
+    // Keep chunks packed, release the empty one
+    if(--last_chunk.count == 0)
+        archetype->chunks.pop_back();
+}
+
+
+/**
+ * \brief Move an entity to another archetype, keeping the shared components.
+ *
+ * \param _entity       Entity
+ * \param _archetype    Destination archetype
+ */
+void ugly::World::moveEntity(Entity _entity, Archetype* _archetype)
+{
+    EntityRecord old_record = m_records[_entity.index];
+    insertEntity(_archetype, _entity);
+
+    const EntityRecord& new_record = m_records[_entity.index];
+    for(auto type : _archetype->types)
+    {
+        if(old_record.archetype->mask & (uint64_t(1) << type))
+            std::memcpy(getComponentData(new_record, type), getComponentData(old_record, type), _archetype->sizes[type]);
+    }
+
+    // The removal may move another entity, never the moved one which is already in its new archetype
+    removeRow(old_record);
+}
+
+
+/**
+ * \brief Get the address of a component of the entity of a record.
+ *
+ * \param _record   Record
+ * \param _type     Component type id
+ * \return Component address
+ */
+unsigned char* ugly::World::getComponentData(const EntityRecord& _record, uint32_t _type) const
+{
+    Chunk& chunk = *_record.archetype->chunks[_record.chunk];
+    return chunk.data + _record.archetype->offsets[_type] + _record.row * _record.archetype->sizes[_type];
+}
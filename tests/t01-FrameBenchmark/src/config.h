@@ -0,0 +1,25 @@
+#pragma once
+
+namespace ugly
+{
+	namespace application
+	{
+		static const std::string NAME = "t01-FrameBenchmark"; 
+	}
+
+	/**
+	 * \brief Version namespace.
+	 */
+	namespace version
+	{
+		//Standard Version Type
+		static const long MAJOR = 1;
+		static const long MINOR = 0;
+		static const long BUILD = 0;
+
+		//Miscellaneous Version Types
+		static const char FULLVERSION_STRING[] = "1.0.0";
+
+	}//namespace version
+
+}//namespace ugly
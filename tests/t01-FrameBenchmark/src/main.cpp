@@ -0,0 +1,517 @@
+#include "UglyEngine.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#ifndef UGLY_ALLOCATION_TRACKING
+/*! Number of heap allocations since the program start */
+static std::atomic<uint64_t> g_allocation_count {0};
+
+void* operator new(std::size_t size)
+{
+	g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if(void* pointer = std::malloc(size == 0 ? 1 : size))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+#endif
+
+
+namespace benchmark
+{
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * \brief Benchmark options.
+	 */
+	struct Options
+	{
+		/*! Number of measured frames */
+		uint64_t frames {1000};
+
+		/*! Input script file, empty for the built-in script */
+		std::string script;
+
+		/*! Report file */
+		std::string output {"benchmark.json"};
+
+		/*! Baseline report file, empty to skip the comparison */
+		std::string baseline;
+
+		/*! Allowed regression over the baseline, in percent */
+		double tolerance {10.0};
+
+		/*! Run with a window instead of headless */
+		bool window {false};
+
+		/*! Log the startup timeline */
+		bool startup_timeline {false};
+
+		/*! Input recording file to write, empty to skip the recording */
+		std::string record;
+
+		/*! Input recording file to replay instead of the script, empty for the script */
+		std::string replay;
+	};
+
+	/**
+	 * \brief Scripted input event.
+	 */
+	struct ScriptEvent
+	{
+		/*! Frame of the event */
+		uint64_t frame;
+
+		/*! GLFW key name */
+		int key_name;
+
+		/*! GLFW action */
+		int action;
+	};
+
+	/**
+	 * \brief Benchmark results.
+	 */
+	struct Results
+	{
+		/*! Startup duration in milliseconds */
+		double startup_ms {0.0};
+
+		/*! Frame time percentiles in microseconds */
+		double frame_p50_us {0.0};
+		double frame_p95_us {0.0};
+		double frame_p99_us {0.0};
+		double frame_max_us {0.0};
+
+		/*! Heap allocations per frame */
+		double allocations_per_frame_mean {0.0};
+		double allocations_per_frame_max {0.0};
+
+		/*! Ticks with a pressed button, identical between a recording and its replay */
+		uint64_t pressed_ticks {0};
+
+		/*! Input to present latency percentiles in microseconds */
+		double input_latency_p50_us {0.0};
+		double input_latency_p99_us {0.0};
+
+		/*! Allocation tracker results, only with UGLY_ALLOCATION_TRACKING */
+		uint64_t tag_allocations[static_cast<size_t>(ugly::AllocationTag::count)] {};
+		int64_t peak_live_bytes {0};
+		uint64_t flagged_frames {0};
+	};
+
+
+	/**
+	 * \brief Get the number of heap allocations since the program start.
+	 *
+	 * \return Allocation count
+	 */
+	uint64_t getAllocationCount()
+	{
+#ifdef UGLY_ALLOCATION_TRACKING
+		uint64_t count = 0;
+		for(size_t tag = 0; tag < static_cast<size_t>(ugly::AllocationTag::count); ++tag)
+			count += ugly::AllocationTracker::getInstance()->getTotalStats(static_cast<ugly::AllocationTag>(tag)).allocations;
+		return count;
+#else
+		return g_allocation_count.load(std::memory_order_relaxed);
+#endif
+	}
+
+
+	/**
+	 * \brief Load an input script.
+	 *
+	 * Each line is "<frame> <key> <press|repeat|release>", '#' starts a comment.
+	 */
+	bool loadScript(const std::string& _filename, std::vector<ScriptEvent>& _events)
+	{
+		std::ifstream file(_filename);
+		if(!file.is_open())
+		{
+			fprintf(stderr, "Cannot open script: %s\n", _filename.c_str());
+			return false;
+		}
+
+		std::string line;
+		while(std::getline(file, line))
+		{
+			if(line.empty() || line[0] == '#')
+				continue;
+
+			std::istringstream stream(line);
+			ScriptEvent event {};
+			std::string action;
+			if(!(stream >> event.frame >> event.key_name >> action))
+			{
+				fprintf(stderr, "Invalid script line: %s\n", line.c_str());
+				return false;
+			}
+
+			if(action == "press")
+				event.action = GLFW_PRESS;
+			else if(action == "repeat")
+				event.action = GLFW_REPEAT;
+			else if(action == "release")
+				event.action = GLFW_RELEASE;
+			else
+			{
+				fprintf(stderr, "Invalid script action: %s\n", action.c_str());
+				return false;
+			}
+			_events.push_back(event);
+		}
+
+		std::stable_sort(_events.begin(), _events.end(), [](const ScriptEvent& a, const ScriptEvent& b) { return a.frame < b.frame; });
+		return true;
+	}
+
+	/**
+	 * \brief Built-in script: movement keys pressed and released in a loop.
+	 */
+	std::vector<ScriptEvent> defaultScript(uint64_t _frames)
+	{
+		const int keys[] = {GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_SPACE};
+		std::vector<ScriptEvent> events;
+		for(uint64_t frame = 0; frame < _frames; frame += 8)
+		{
+			int key_name = keys[(frame / 8) % 5];
+			events.push_back({frame, key_name, GLFW_PRESS});
+			events.push_back({frame + 4, key_name, GLFW_RELEASE});
+		}
+		return events;
+	}
+
+	/**
+	 * \brief Get a percentile of sorted values.
+	 */
+	double percentile(const std::vector<double>& _sorted, double _percentile)
+	{
+		if(_sorted.empty())
+			return 0.0;
+
+		size_t index = static_cast<size_t>(_percentile / 100.0 * (_sorted.size() - 1) + 0.5);
+		return _sorted[std::min(index, _sorted.size() - 1)];
+	}
+
+	/**
+	 * \brief Read a number from a flat JSON report.
+	 */
+	bool readValue(const std::string& _json, const std::string& _key, double& _value)
+	{
+		auto position = _json.find("\"" + _key + "\"");
+		if(position == std::string::npos)
+			return false;
+
+		position = _json.find(':', position);
+		if(position == std::string::npos)
+			return false;
+
+		_value = std::strtod(_json.c_str() + position + 1, nullptr);
+		return true;
+	}
+
+
+	/**
+	 * \brief Application driven by an input script.
+	 */
+	class BenchmarkApplication : public ugly::Application
+	{
+	public:
+
+		BenchmarkApplication(const Options& _options, std::vector<ScriptEvent> _script, Clock::time_point _start, Results& _results) :
+			m_options(_options),
+			m_script(std::move(_script)),
+			m_start(_start),
+			m_results(_results)
+		{
+			m_name = "t01-FrameBenchmark";
+			m_frame_times.reserve(static_cast<size_t>(_options.frames));
+			m_frame_allocations.reserve(static_cast<size_t>(_options.frames));
+		}
+
+		bool initialize() override
+		{
+			if(!ugly::Application::initialize())
+				return false;
+
+			const char* buttons[] = {"forward", "left", "backward", "right", "jump"};
+			const int keys[] = {GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_SPACE};
+			for(int i = 0; i < 5; ++i)
+			{
+				m_buttons[i] = ugly::Engine::getInstance()->getInputManager()->createButton(buttons[i]);
+				ugly::Engine::getInstance()->getInputManager()->bindKeyToButton(keys[i], m_buttons[i]);
+			}
+
+			if(!m_options.record.empty() && !ugly::Engine::getInstance()->getInputManager()->startRecording(m_options.record))
+				return false;
+
+			if(!m_options.replay.empty())
+			{
+				if(!ugly::Engine::getInstance()->getInputManager()->startReplay(m_options.replay))
+					return false;
+				m_script.clear();
+			}
+
+			return true;
+		}
+
+		void shutdown() override
+		{
+			computeResults();
+			ugly::Application::shutdown();
+		}
+
+		void update() override
+		{
+			// Poll the actions like gameplay code does
+			ugly::InputManager* input_manager = ugly::Engine::getInstance()->getInputManager();
+			for(ugly::InputButtonHandle button : m_buttons)
+			{
+				if(input_manager->getButtonState(button) == ugly::InputState::press)
+					++m_pressed_ticks;
+			}
+
+			ugly::Application::update();
+		}
+
+		void render(float _alpha) override
+		{
+			auto now = Clock::now();
+			uint64_t allocations = getAllocationCount();
+
+			if(m_frame == 0)
+			{
+				if(m_options.startup_timeline)
+					ugly::Engine::getInstance()->getStartupTimeline()->dump();
+				m_results.startup_ms = std::chrono::duration<double, std::milli>(now - m_start).count();
+			}
+			else
+			{
+				m_frame_times.push_back(std::chrono::duration<double, std::micro>(now - m_last_frame).count());
+				m_frame_allocations.push_back(static_cast<double>(allocations - m_last_allocations));
+			}
+
+			// Inject the events of the next frame, they are processed at the start of the next tick
+			while(m_next_event < m_script.size() && m_script[m_next_event].frame <= m_frame)
+			{
+				const ScriptEvent& event = m_script[m_next_event++];
+				ugly::Engine::getInstance()->getInputManager()->injectKeyChange(event.key_name, event.action);
+			}
+
+			// A replay runs until its last recorded change
+			bool replay_finished = !m_options.replay.empty() && !ugly::Engine::getInstance()->getInputManager()->isReplaying();
+			if(++m_frame > m_options.frames || replay_finished)
+				ugly::Engine::getInstance()->quit();
+
+			m_last_frame = now;
+			m_last_allocations = allocations;
+		}
+
+	private:
+
+		void computeResults()
+		{
+			std::sort(m_frame_times.begin(), m_frame_times.end());
+			m_results.frame_p50_us = percentile(m_frame_times, 50.0);
+			m_results.frame_p95_us = percentile(m_frame_times, 95.0);
+			m_results.frame_p99_us = percentile(m_frame_times, 99.0);
+			m_results.frame_max_us = m_frame_times.empty() ? 0.0 : m_frame_times.back();
+
+			for(double allocations : m_frame_allocations)
+			{
+				m_results.allocations_per_frame_mean += allocations;
+				m_results.allocations_per_frame_max = std::max(m_results.allocations_per_frame_max, allocations);
+			}
+			if(!m_frame_allocations.empty())
+				m_results.allocations_per_frame_mean /= m_frame_allocations.size();
+
+			m_results.pressed_ticks = m_pressed_ticks;
+
+			ugly::InputLatencyTracker* input_latency = ugly::Engine::getInstance()->getInputLatency();
+			m_results.input_latency_p50_us = std::chrono::duration<double, std::micro>(input_latency->getPercentile(50.0)).count();
+			m_results.input_latency_p99_us = std::chrono::duration<double, std::micro>(input_latency->getPercentile(99.0)).count();
+
+			ugly::AllocationTracker* tracker = ugly::AllocationTracker::getInstance();
+			for(size_t tag = 0; tag < static_cast<size_t>(ugly::AllocationTag::count); ++tag)
+				m_results.tag_allocations[tag] = tracker->getTotalStats(static_cast<ugly::AllocationTag>(tag)).allocations;
+			m_results.peak_live_bytes = tracker->getPeakLiveBytes();
+			m_results.flagged_frames = tracker->getFlaggedFrameCount();
+		}
+
+		Options m_options;
+		std::vector<ScriptEvent> m_script;
+		size_t m_next_event {0};
+		Clock::time_point m_start;
+		Clock::time_point m_last_frame;
+		uint64_t m_last_allocations {0};
+		uint64_t m_frame {0};
+		uint64_t m_pressed_ticks {0};
+		ugly::InputButtonHandle m_buttons[5];
+		std::vector<double> m_frame_times;
+		std::vector<double> m_frame_allocations;
+		Results& m_results;
+	};
+
+
+	/**
+	 * \brief Write the report.
+	 */
+	bool writeReport(const std::string& _filename, const Options& _options, const Results& _results)
+	{
+		std::ofstream file(_filename, std::ios::out | std::ios::trunc);
+		if(!file.is_open())
+		{
+			fprintf(stderr, "Cannot open report: %s\n", _filename.c_str());
+			return false;
+		}
+
+		file << "{\n";
+		file << "    \"frames\": " << _options.frames << ",\n";
+		file << "    \"startup_ms\": " << _results.startup_ms << ",\n";
+		file << "    \"frame_p50_us\": " << _results.frame_p50_us << ",\n";
+		file << "    \"frame_p95_us\": " << _results.frame_p95_us << ",\n";
+		file << "    \"frame_p99_us\": " << _results.frame_p99_us << ",\n";
+		file << "    \"frame_max_us\": " << _results.frame_max_us << ",\n";
+		file << "    \"allocations_per_frame_mean\": " << _results.allocations_per_frame_mean << ",\n";
+		file << "    \"allocations_per_frame_max\": " << _results.allocations_per_frame_max << ",\n";
+		file << "    \"pressed_ticks\": " << _results.pressed_ticks << ",\n";
+		file << "    \"input_latency_p50_us\": " << _results.input_latency_p50_us << ",\n";
+		file << "    \"input_latency_p99_us\": " << _results.input_latency_p99_us;
+		if(ugly::AllocationTracker::isEnabled())
+		{
+			for(size_t tag = 0; tag < static_cast<size_t>(ugly::AllocationTag::count); ++tag)
+				file << ",\n    \"allocations_" << ugly::AllocationTracker::getTagName(static_cast<ugly::AllocationTag>(tag)) << "\": " << _results.tag_allocations[tag];
+			file << ",\n    \"peak_live_bytes\": " << _results.peak_live_bytes;
+			file << ",\n    \"steady_state_allocating_frames\": " << _results.flagged_frames;
+		}
+		file << "\n";
+		file << "}\n";
+
+		return file.good();
+	}
+
+	/**
+	 * \brief Compare the results with a baseline report.
+	 *
+	 * \return False if a result regressed past the tolerance
+	 */
+	bool compareBaseline(const std::string& _filename, double _tolerance, const Results& _results)
+	{
+		std::ifstream file(_filename);
+		if(!file.is_open())
+		{
+			fprintf(stderr, "Cannot open baseline: %s\n", _filename.c_str());
+			return false;
+		}
+		std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		const std::pair<const char*, double> values[] = {
+			{"startup_ms", _results.startup_ms},
+			{"frame_p50_us", _results.frame_p50_us},
+			{"frame_p95_us", _results.frame_p95_us},
+			{"frame_p99_us", _results.frame_p99_us},
+			{"allocations_per_frame_mean", _results.allocations_per_frame_mean},
+		};
+
+		bool success = true;
+		for(const auto& value : values)
+		{
+			double baseline = 0.0;
+			if(!readValue(json, value.first, baseline))
+				continue;
+
+			double limit = baseline * (1.0 + _tolerance / 100.0);
+			bool regressed = value.second > limit;
+			printf("%-28s %12.3f baseline %12.3f %s\n", value.first, value.second, baseline, regressed ? "REGRESSION" : "ok");
+			success = success && !regressed;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Parse command line.
+	 */
+	bool parseOptions(int argc, char** argv, Options& _options)
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+			bool has_value = i + 1 < argc;
+			if(argument == "--frames" && has_value)
+				_options.frames = std::strtoull(argv[++i], nullptr, 10);
+			else if(argument == "--script" && has_value)
+				_options.script = argv[++i];
+			else if(argument == "--output" && has_value)
+				_options.output = argv[++i];
+			else if(argument == "--baseline" && has_value)
+				_options.baseline = argv[++i];
+			else if(argument == "--tolerance" && has_value)
+				_options.tolerance = std::strtod(argv[++i], nullptr);
+			else if(argument == "--window")
+				_options.window = true;
+			else if(argument == "--startup-timeline")
+				_options.startup_timeline = true;
+			else if(argument == "--record" && has_value)
+				_options.record = argv[++i];
+			else if(argument == "--replay" && has_value)
+				_options.replay = argv[++i];
+			else
+			{
+				fprintf(stderr, "Usage: %s [--frames N] [--script FILE] [--output FILE] [--baseline FILE] [--tolerance PERCENT] [--window] [--startup-timeline] [--record FILE] [--replay FILE]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+
+}//namespace benchmark
+
+
+int main(int argc, char** argv)
+{
+	auto start = benchmark::Clock::now();
+
+	benchmark::Options options;
+	if(!benchmark::parseOptions(argc, argv, options))
+		return 1;
+
+	std::vector<benchmark::ScriptEvent> script;
+	if(options.script.empty())
+		script = benchmark::defaultScript(options.frames);
+	else if(!benchmark::loadScript(options.script, script))
+		return 1;
+
+	ugly::Engine* engine = ugly::Engine::getInstance();
+	engine->setHeadless(!options.window);
+
+	// The engine destroys the application, it writes its results at shutdown
+	benchmark::Results results;
+	int result = engine->run(new benchmark::BenchmarkApplication(options, std::move(script), start, results));
+	if(result != 0)
+		return result;
+
+	printf("startup %.3f ms, frame p50 %.3f us, p95 %.3f us, p99 %.3f us, max %.3f us, allocations per frame %.2f\n",
+		results.startup_ms, results.frame_p50_us, results.frame_p95_us, results.frame_p99_us, results.frame_max_us, results.allocations_per_frame_mean);
+
+	if(!benchmark::writeReport(options.output, options, results))
+		return 2;
+
+	if(!options.baseline.empty() && !benchmark::compareBaseline(options.baseline, options.tolerance, results))
+		return 3;
+
+	return 0;
+}
@@ -0,0 +1,225 @@
+#include "UglyEngine.h"
+
+#include <cstdio>
+#include <random>
+
+
+namespace stress
+{
+	/**
+	 * \brief Live allocation of the stress test.
+	 */
+	struct Entry
+	{
+		/*! Allocation */
+		ugly::VulkanAllocation allocation;
+
+		/*! Required alignment */
+		VkDeviceSize alignment;
+
+		/*! Resource kind */
+		ugly::VulkanResourceKind kind;
+	};
+
+
+	/**
+	 * \brief Check that the live allocations are aligned, do not overlap and keep
+	 * linear and optimal resources on different granularity pages.
+	 *
+	 * \return false if error
+	 */
+	bool checkAllocations(std::vector<Entry> _entries, VkDeviceSize _granularity)
+	{
+		std::sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b)
+		{
+			if(a.allocation.memory != b.allocation.memory)
+				return a.allocation.memory < b.allocation.memory;
+			return a.allocation.offset < b.allocation.offset;
+		});
+
+		for(size_t i = 0; i < _entries.size(); ++i)
+		{
+			const ugly::VulkanAllocation& allocation = _entries[i].allocation;
+			if(allocation.offset % _entries[i].alignment != 0)
+			{
+				fprintf(stderr, "Misaligned allocation: offset %llu, alignment %llu\n",
+					static_cast<unsigned long long>(allocation.offset), static_cast<unsigned long long>(_entries[i].alignment));
+				return false;
+			}
+
+			if(i == 0 || _entries[i - 1].allocation.memory != allocation.memory)
+				continue;
+
+			const ugly::VulkanAllocation& previous = _entries[i - 1].allocation;
+			VkDeviceSize previous_end = previous.offset + previous.size;
+			if(previous_end > allocation.offset)
+			{
+				fprintf(stderr, "Overlapping allocations at offset %llu\n", static_cast<unsigned long long>(allocation.offset));
+				return false;
+			}
+
+			if(_entries[i - 1].kind != _entries[i].kind && (previous_end - 1) / _granularity == allocation.offset / _granularity)
+			{
+				fprintf(stderr, "Linear and optimal allocations share a page at offset %llu\n", static_cast<unsigned long long>(allocation.offset));
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	/**
+	 * \brief Allocate and free random buffers and images, then check the statistics.
+	 *
+	 * \return false if error
+	 */
+	bool run(ugly::VulkanMemoryAllocator* _allocator, VkDeviceSize _granularity)
+	{
+		std::mt19937 random(42);
+		std::vector<Entry> entries;
+
+		for(uint32_t i = 0; i < 20000; ++i)
+		{
+			if(entries.empty() || random() % 100 < 55)
+			{
+				Entry entry;
+				entry.kind = random() % 2 == 0 ? ugly::VulkanResourceKind::linear : ugly::VulkanResourceKind::optimal;
+				entry.alignment = VkDeviceSize(1) << (random() % 12);
+
+				VkMemoryRequirements requirements;
+				requirements.size = 1 + random() % (random() % 64 == 0 ? (4 << 20) : (64 << 10));
+				requirements.alignment = entry.alignment;
+				requirements.memoryTypeBits = UINT32_MAX;
+
+				auto usage = static_cast<ugly::VulkanMemoryUsage>(random() % 3);
+				if(!_allocator->allocate(requirements, usage, entry.kind, entry.allocation))
+					return false;
+
+				// Host visible memory must be writable over the whole range
+				if(entry.allocation.mapped != nullptr)
+				{
+					memset(entry.allocation.mapped, 0xAB, entry.allocation.size);
+					_allocator->flush(entry.allocation);
+				}
+				entries.push_back(entry);
+			}
+			else
+			{
+				size_t index = random() % entries.size();
+				_allocator->free(entries[index].allocation);
+				entries[index] = entries.back();
+				entries.pop_back();
+			}
+
+			if(i % 1000 == 0 && !checkAllocations(entries, _granularity))
+				return false;
+		}
+
+		_allocator->logStats();
+		ugly::VulkanMemoryStats stats = _allocator->getStats();
+		printf("%u allocations in %u blocks, used %llu / %llu bytes, %u free ranges, fragmentation %.1f%%\n",
+			stats.allocation_count, stats.block_count, static_cast<unsigned long long>(stats.used_bytes),
+			static_cast<unsigned long long>(stats.block_bytes), stats.free_range_count, stats.fragmentation * 100.f);
+
+		// Transient allocations of a few frames
+		for(uint32_t frame = 0; frame < 3; ++frame)
+		{
+			for(uint32_t i = 0; i < 256; ++i)
+			{
+				ugly::VulkanAllocation allocation;
+				VkMemoryRequirements requirements {VkDeviceSize(256 + i * 64), 256, UINT32_MAX};
+				if(!_allocator->allocateLinear(requirements, ugly::VulkanMemoryUsage::upload, ugly::VulkanResourceKind::linear, allocation))
+					return false;
+			}
+			_allocator->resetLinear();
+		}
+
+		// Same size resources
+		VkMemoryRequirements pool_requirements {64 << 10, 4096, UINT32_MAX};
+		uint32_t pool = _allocator->createPool(pool_requirements, ugly::VulkanMemoryUsage::gpu_only, 32);
+		if(pool == UINT32_MAX)
+			return false;
+
+		std::vector<ugly::VulkanAllocation> pool_allocations(100);
+		for(auto& allocation : pool_allocations)
+		{
+			if(!_allocator->allocateFromPool(pool, allocation))
+				return false;
+		}
+		for(auto& allocation : pool_allocations)
+			_allocator->free(allocation);
+		_allocator->destroyPool(pool);
+
+		for(auto& entry : entries)
+			_allocator->free(entry.allocation);
+
+		stats = _allocator->getStats();
+		if(stats.allocation_count != 0 || stats.used_bytes != 0)
+		{
+			fprintf(stderr, "%u allocations left after freeing everything\n", stats.allocation_count);
+			return false;
+		}
+
+		return true;
+	}
+
+
+	/**
+	 * \brief Application running the stress test then quitting.
+	 */
+	class StressApplication : public ugly::Application
+	{
+	public:
+
+		StressApplication(int& _result) :
+			m_result(_result)
+		{
+		}
+
+		void update() override
+		{
+			ugly::Application::update();
+			if(m_done)
+				return;
+			m_done = true;
+
+			ugly::VulkanManager* vulkan_manager = ugly::Engine::getInstance()->getVulkanManager();
+			if(vulkan_manager == nullptr)
+			{
+				fprintf(stderr, "Vulkan is not available\n");
+				m_result = 1;
+			}
+			else
+			{
+				ugly::VulkanMemoryAllocator* allocator = vulkan_manager->getMemoryAllocator();
+				m_result = run(allocator, allocator->getGranularity()) ? 0 : 1;
+			}
+
+			ugly::Engine::getInstance()->quit();
+		}
+
+	private:
+
+		/*! Test result */
+		int& m_result;
+
+		/*! The test ran */
+		bool m_done {false};
+	};
+
+}//namespace stress
+
+
+int main()
+{
+	ugly::Engine* engine = ugly::Engine::getInstance();
+	engine->setHeadless(true);
+
+	int result = 1;
+	if(engine->run(new stress::StressApplication(result)) != 0)
+		return 1;
+
+	printf(result == 0 ? "Memory allocator test passed\n" : "Memory allocator test failed\n");
+	return result;
+}
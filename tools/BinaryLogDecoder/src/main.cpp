@@ -0,0 +1,203 @@
+#include "BinaryLogFormat.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace decoder
+{
+	/**
+	 * \brief Call site read from a site definition record.
+	 */
+	struct Site
+	{
+		uint32_t severity {0};
+		std::string func;
+		std::string file;
+		uint32_t line {0};
+		std::string format;
+	};
+
+
+	/**
+	 * \brief Get the severity prefix, as written by the text log.
+	 */
+	const char* getSeverityName(uint32_t _severity)
+	{
+		static const char* names[] = {"NONE", "FATAL", "ERROR", "WARNING", "INFO", "DEBUG", "VERBOSE"};
+		return _severity < sizeof(names) / sizeof(names[0]) ? names[_severity] : "UNKNOWN";
+	}
+
+
+	/**
+	 * \brief Read a null terminated string of a record.
+	 */
+	bool readString(const uint8_t*& _data, const uint8_t* _end, std::string& _string)
+	{
+		const uint8_t* terminator = static_cast<const uint8_t*>(memchr(_data, 0, _end - _data));
+		if(terminator == nullptr)
+			return false;
+
+		_string.assign(reinterpret_cast<const char*>(_data), terminator - _data);
+		_data = terminator + 1;
+		return true;
+	}
+
+
+	/**
+	 * \brief Expand a binary log.
+	 */
+	bool decode(const std::vector<uint8_t>& _log, FILE* _output, bool _locations)
+	{
+		ugly::BinaryLogHeader header;
+		if(_log.size() < sizeof(header))
+		{
+			fprintf(stderr, "File too small\n");
+			return false;
+		}
+
+		memcpy(&header, _log.data(), sizeof(header));
+		if(memcmp(header.magic, ugly::BinaryLogHeader::MAGIC, sizeof(header.magic)) != 0 || header.version != ugly::BinaryLogHeader::VERSION)
+		{
+			fprintf(stderr, "Not a binary log, or unsupported version\n");
+			return false;
+		}
+
+		std::unordered_map<uint32_t, Site> sites;
+		std::string message;
+		uint64_t entries = 0;
+		uint64_t malformed = 0;
+
+		size_t offset = sizeof(header);
+		while(offset + sizeof(ugly::BinaryLogRecordHeader) <= _log.size())
+		{
+			ugly::BinaryLogRecordHeader record;
+			memcpy(&record, _log.data() + offset, sizeof(record));
+
+			// The end of the file is zeroed
+			if(record.size == 0)
+				break;
+			if(record.size < sizeof(record) || offset + record.size > _log.size())
+			{
+				fprintf(stderr, "Truncated record at offset %zu\n", offset);
+				break;
+			}
+
+			const uint8_t* data = _log.data() + offset + sizeof(record);
+			const uint8_t* end = _log.data() + offset + record.size;
+			offset += record.size;
+
+			if(record.site == ugly::BinaryLogRecordHeader::SITE_DEFINITION)
+			{
+				ugly::BinaryLogSiteDefinition definition;
+				if(static_cast<size_t>(end - data) < sizeof(definition))
+				{
+					++malformed;
+					continue;
+				}
+				memcpy(&definition, data, sizeof(definition));
+				data += sizeof(definition);
+
+				Site site;
+				site.severity = definition.severity;
+				site.line = definition.line;
+				if(!readString(data, end, site.func) || !readString(data, end, site.file) || !readString(data, end, site.format))
+				{
+					++malformed;
+					continue;
+				}
+				sites[definition.id] = std::move(site);
+				continue;
+			}
+
+			auto site_itor = sites.find(record.site);
+			uint64_t timestamp;
+			if(site_itor == sites.end() || static_cast<size_t>(end - data) < sizeof(timestamp))
+			{
+				++malformed;
+				continue;
+			}
+			memcpy(&timestamp, data, sizeof(timestamp));
+			data += sizeof(timestamp);
+
+			const Site& site = site_itor->second;
+			if(!ugly::decodeBinaryLogMessage(site.format.c_str(), data, end - data, message))
+				++malformed;
+
+			double seconds = static_cast<double>(timestamp - header.origin) / 1e9;
+			if(_locations)
+				fprintf(_output, "%.6f %s - %s - %s (%s:%u)\n", seconds, getSeverityName(site.severity), site.func.c_str(), message.c_str(), site.file.c_str(), site.line);
+			else
+				fprintf(_output, "%.6f %s - %s - %s\n", seconds, getSeverityName(site.severity), site.func.c_str(), message.c_str());
+			++entries;
+		}
+
+		fprintf(stderr, "%llu entries, %zu sites, %llu malformed records\n", static_cast<unsigned long long>(entries), sites.size(), static_cast<unsigned long long>(malformed));
+		return true;
+	}
+
+}//namespace decoder
+
+
+/**
+ * \brief Main function.
+ * Usage: UglyLogDecoder FILE [--output FILE] [--locations]
+ */
+int main(int argc, char** argv)
+{
+	std::string input;
+	std::string output;
+	bool locations = false;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if(argument == "--output" && i + 1 < argc)
+			output = argv[++i];
+		else if(argument == "--locations")
+			locations = true;
+		else if(input.empty() && argument[0] != '-')
+			input = argument;
+		else
+		{
+			fprintf(stderr, "Usage: %s FILE [--output FILE] [--locations]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(input.empty())
+	{
+		fprintf(stderr, "Usage: %s FILE [--output FILE] [--locations]\n", argv[0]);
+		return 1;
+	}
+
+	std::ifstream file(input, std::ios::in | std::ios::binary);
+	if(!file.is_open())
+	{
+		fprintf(stderr, "Cannot open binary log: %s\n", input.c_str());
+		return 1;
+	}
+	std::vector<uint8_t> log((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	FILE* text = stdout;
+	if(!output.empty())
+	{
+		text = fopen(output.c_str(), "w");
+		if(text == nullptr)
+		{
+			fprintf(stderr, "Cannot open output: %s\n", output.c_str());
+			return 1;
+		}
+	}
+
+	bool result = decoder::decode(log, text, locations);
+
+	if(text != stdout)
+		fclose(text);
+
+	return result ? 0 : 1;
+}